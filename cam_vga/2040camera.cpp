@@ -25,13 +25,31 @@
  * 
  * RESOURCES USED
  *  - PIO state machines 0, 1, and 2 on PIO instance 0
- *  - DMA channels 0 and 1
+ *  - DMA channels 0 and 1 (VGA scanout) and 2 (blitter, BLIT_DMA_CHAN in vga_graphics.c)
+ *  - UART0_IRQ for serial output and command frames (pt_cornell_rp2040_v1.h)
+ *  - with EVENT_TRACE, DMA_IRQ_0 (irq_set_exclusive_handler, on channel 0 completion)
+ *  - USB CDC for frame streaming and edge export only (host/camstream, host/camedges),
+ *    stdio is on the uart
  *  
  */
 
 // These files are in C but this is in C++ so need extern
 extern "C"{
     #include "vga_graphics.h"
+    #include "overlay.h"
+    #include "cmd_protocol.h"
+    #include "frame_stream.h"
+    #include "edge_export.h"
+    #include "vectorize.h"
+    #include "blob.h"
+    #include "motion.h"
+    #include "background.h"
+    #include "histogram.h"
+    #include "local_threshold.h"
+    #include "morph.h"
+    #include "frame_timing.h"
+    #include "frame_source.h"
+    #include "trace.h"
     #include <stdio.h>
     #include <stdlib.h>
     #include <string.h>
@@ -48,10 +66,44 @@ extern "C"{
 #include <cstdlib>
 #include "stdio.h"
 #include "pico/mutex.h"
+#include "tusb.h"
 
-// Include protothreads
+// Include protothreads, with per-thread profiling (0 compiles it out)
+#define PT_STATS 1
+// Per-phase timing of camera frames (0 compiles it out)
+#define FRAME_TIMING 1
+// Event trace of thread calls, captures, DMA and commands, dumped by 'T'
+// for host/trace2json (0 compiles it out)
+#define EVENT_TRACE 1
+// Also trace every blitter DMA row copy (fills the ring in a frame)
+#define TRACE_BLITS 0
+#if EVENT_TRACE
+trace_log trace_buf;
+#define TRACE(id, arg) traceRecord(&trace_buf, get_core_num(), 0, timer_hw->timerawl, (id), (arg))
+#define TRACE_IRQ(id, arg) traceRecord(&trace_buf, get_core_num(), 1, timer_hw->timerawl, (id), (arg))
+#define PT_TRACE_CALL(core, num, returned) \
+    traceRecord(&trace_buf, (core), 0, timer_hw->timerawl, (returned) ? TR_THREAD_RETURN : TR_THREAD_CALL, (num))
+#else
+#define TRACE(id, arg)
+#define TRACE_IRQ(id, arg)
+#endif
 #include "pt_cornell_rp2040_v1.h"
 
+#include "pixel_pipeline.hpp"
+
+//Scheduler release period of the serial thread (usec)
+#define SERIAL_PERIOD_US 10000
+//Scheduler release period of the camera thread (usec) by frame source:
+//frames start on this beat. A call runs a whole frame without yielding,
+//so keep each a little above the p99 total of the 'z' report for its
+//source; a frame that finishes after its next release counts as an
+//overrun ('p', 'z'). Live frames are bound by the byte at a time FIFO
+//drain: host/camsim models 1.57 s of capture and drain at 4 MHz SPI,
+//before any of the row processing.
+#define CAMERA_PERIOD_LIVE_US 2000000
+#define CAMERA_PERIOD_SYNTHETIC_US 500000
+int camera_thread;
+
 const uint8_t CS = 5;
 ArduCAM myCAM( OV5642, CS );
 
@@ -73,10 +125,601 @@ volatile int consecutive_threshold = 7;
 //The minimum number of pixels between two solid pixels in edge detection, required to save memory
 volatile int dithering_number = 3;
 
-//Previous 3 rows (used for edge detection)
-volatile bool prev_3_rows[3][640];
+//How B/W mode decides which pixels are white
+#define BW_DARK 0           //all color bits 0
+#define BW_BACKGROUND 1     //differs from the learned background
+#define BW_AUTO_THRESHOLD 2 //at or below a threshold picked from the last frame
+#define BW_LOCAL_THRESHOLD 3 //darker than the mean of the pixels around
+#define BW_METHODS 4
+volatile int bw_method = BW_DARK;
+
+//Previous 3 rows (used for lookback edge detection)
+pipeline::lookback lookback_rows;
 //The array that stores the locations of detected edges
-volatile short edge_locations[2][22000];
+//(only the first MAX_EDGES entries were ever drawn or cleared)
+#define MAX_EDGES 10000
+volatile short edge_locations[2][MAX_EDGES] __attribute__((aligned(4)));
+
+//One packed row of the displayed image (2 pixels per byte), written to
+//the screen with writeRowIfChanged once the row is complete
+unsigned char row_buffer[320] __attribute__((aligned(4)));
+//Rows written/skipped in the last displayed frame
+unsigned int last_rows_written = 0;
+unsigned int last_rows_skipped = 0;
+//Time spent reading out and processing the last frame (usec)
+unsigned int last_readout_us = 0;
+
+//Per-pixel work of each mode, fused into one row kernel per mode at
+//compile time (pixel_pipeline.hpp). The camera thread picks the kernel
+//once per frame from the mode settings, so the pixel loop has no mode
+//branches or volatile loads.
+pipeline::context pipe_ctx;
+//One row of FIFO bytes, in the order the sensor sends them
+uint8_t raw_row[640] __attribute__((aligned(4)));
+
+//Where the camera thread gets its frames (frame_source.h): the camera,
+//the camera with its test pattern on, or one of the synthetic patterns,
+//which need no sensor and show how fast processing and display go on
+//their own. Picked at the start of every frame.
+#define SOURCE_LIVE 0
+#define SOURCE_SENSOR_PATTERN 1
+#define SOURCE_SYNTHETIC 2      //first synthetic pattern, SRC_PATTERNS of them
+#define SOURCES (SOURCE_SYNTHETIC + SRC_PATTERNS)
+volatile int source_sel = SOURCE_LIVE;
+frame_source live_source;
+frame_source synthetic_source;
+
+//Live source: capture into the ArduCAM FIFO and wait for it to finish
+static void live_start(frame_source *s){
+    myCAM.flush_fifo();         //Clears out the previous capture
+    myCAM.clear_fifo_flag();    //Clears the flag that an image is completed
+    myCAM.start_capture();      //Start capture
+    while(myCAM.get_bit(ARDUCHIP_TRIG, CAP_DONE_MASK) == 0){}
+}
+
+static uint32_t live_length(frame_source *s){
+    return myCAM.read_fifo_length();
+}
+
+//The FIFO a byte at a time
+static void live_read(frame_source *s, uint8_t *buf, uint32_t len){
+    for(uint32_t j = 0; j < len; j++){
+        buf[j] = myCAM.read_fifo();
+    }
+}
+
+static frame_source *current_source(){
+    if(source_sel < SOURCE_SYNTHETIC){
+        return &live_source;
+    }
+    synthetic_source.pattern = source_sel - SOURCE_SYNTHETIC;
+    return &synthetic_source;
+}
+
+//Status line drawn in the overlay plane, so camera frames don't erase it
+#define HUD_WIDTH 128
+#define HUD_HEIGHT 8
+unsigned char hud_mask[HUD_HEIGHT][HUD_WIDTH/8];
+int hud_overlay = -1;
+
+//Show the current display mode on the HUD
+void update_mode_hud(){
+    overlayClear(hud_overlay);
+    if(color_enabled){
+        overlayDrawString(hud_overlay, 0, 0, "COLOR");
+    }
+    else if(edge_detection_en == 2){
+        overlayDrawString(hud_overlay, 0, 0, "EDGE: LOOKBACK");
+    }
+    else if(edge_detection_en == 1){
+        overlayDrawString(hud_overlay, 0, 0, "EDGE: SIMPLE");
+    }
+    else{
+        overlayDrawString(hud_overlay, 0, 0, "B/W");
+    }
+}
+
+#if FRAME_TIMING
+//Where the camera thread's time goes: each phase of a frame is stamped
+//with the microsecond timer, and the last FT_FRAMES frames are kept for
+//'z' to report. Frame rate, ms per phase and edges are drawn in the
+//bottom left corner (averaged, redrawn every TIMING_HUD_INTERVAL frames).
+frame_timing frame_times;
+#define FT_BEGIN() ftBeginFrame(&frame_times, timer_hw->timerawl)
+#define FT_MARK(phase) ftMark(&frame_times, (phase), timer_hw->timerawl)
+#define FT_END(edges) ftEndFrame(&frame_times, timer_hw->timerawl, (edges))
+#define TIMING_HUD_WIDTH 216
+#define TIMING_HUD_INTERVAL 8
+volatile int timing_hud_enabled = 0;
+unsigned char timing_mask[2*HUD_HEIGHT][TIMING_HUD_WIDTH/8];
+int timing_overlay = -1;
+
+//Averages over the ring, in ms rounded
+static unsigned int timing_ms(int phase){
+    ft_summary s;
+    if(!ftSummarize(&frame_times, phase, &s)) return 0;
+    return (s.avg + 500) / 1000;
+}
+
+static void update_timing_hud(){
+    char line[TIMING_HUD_WIDTH/6 + 1];
+    ft_summary period;
+    unsigned int fps10 = ftSummarize(&frame_times, FT_PERIOD, &period) && period.avg ? 10000000 / period.avg : 0;
+    const ft_record *last = &frame_times.ring[(frame_times.frames - 1) % FT_FRAMES];
+    overlayClear(timing_overlay);
+    snprintf(line, sizeof(line), "%u.%u fps %u ms edges %u", fps10 / 10, fps10 % 10, timing_ms(FT_TOTAL), (unsigned)last->edges);
+    overlayDrawString(timing_overlay, 0, 0, line);
+    snprintf(line, sizeof(line), "cap%u ln%u rd%u cv%u ed%u dr%u cl%u o%u", timing_ms(FT_CAPTURE), timing_ms(FT_LENGTH),
+             timing_ms(FT_DRAIN), timing_ms(FT_CONVERT), timing_ms(FT_EDGES), timing_ms(FT_REDRAW),
+             timing_ms(FT_CLEAR), timing_ms(FT_OTHER));
+    overlayDrawString(timing_overlay, 0, HUD_HEIGHT, line);
+}
+#else
+#define FT_BEGIN()
+#define FT_MARK(phase)
+#define FT_END(edges)
+#endif
+
+//Frame streaming to a host over USB CDC. Packets are queued in a ring
+//and moved into the USB FIFO as room frees up, capture never waits on
+//the host; rows that don't fit are sent in a later frame.
+#define STREAM_KEYFRAME_INTERVAL 30
+#define STREAM_RING_SIZE 4096       //power of 2
+volatile int streaming_enabled = 0;
+fs_encoder stream_encoder;
+uint8_t stream_ring[STREAM_RING_SIZE];
+unsigned int stream_head = 0, stream_tail = 0;
+
+//Move queued stream bytes into the USB CDC FIFO without waiting. They go
+//through the stdio_usb driver, which takes its mutex against the
+//background tud_task, a chunk at most the free FIFO space so the write
+//never blocks. printf is kept off USB (main), so nothing else lands
+//between the packets.
+static void stream_pump(){
+    while(stream_tail != stream_head){
+        uint32_t avail = tud_cdc_write_available();
+        if(avail == 0) break;
+        //contiguous bytes up to the head or the end of the ring
+        uint32_t n = ((stream_head > stream_tail) ? stream_head : STREAM_RING_SIZE) - stream_tail;
+        if(n > avail) n = avail;
+        stdio_usb.out_chars((const char *)&stream_ring[stream_tail], n);
+        stream_tail = (stream_tail + n) & (STREAM_RING_SIZE-1);
+    }
+}
+
+//fs_sink: queue a whole packet, or nothing if there is no room or no host
+static int stream_queue(const uint8_t *buf, int len){
+    int free = STREAM_RING_SIZE - 1 - ((stream_head - stream_tail) & (STREAM_RING_SIZE-1));
+    if(!tud_cdc_connected() || len > free) return 0;
+    for(int i = 0; i < len; i++){
+        stream_ring[(stream_head + i) & (STREAM_RING_SIZE-1)] = buf[i];
+    }
+    stream_head = (stream_head + len) & (STREAM_RING_SIZE-1);
+    return 1;
+}
+
+//Edge points of the last detected frame, encoded and sent over the same
+//USB stream while the next frame is being detected (host/camedges)
+volatile int edge_export_enabled = 0;
+edge_exporter edge_export;
+
+//Edge vectoriser: links the drawn edge pixels into polylines ordered for
+//a plotter, draws them back in place of the points (pen-up moves in blue)
+//and exports them instead of the points
+#define VEC_MIN_PIXELS 8        //shorter contours are noise
+#define VEC_EPSILON 2           //Douglas-Peucker tolerance (pixels)
+#define VEC_WINDOW 32           //2-opt look ahead (paths)
+#define VEC_PASSES 4
+volatile int vectorize_enabled = 0;
+unsigned int vec_paths = 0, vec_points = 0, vec_travel_before = 0, vec_travel_after = 0, vec_time_us = 0;
+
+//Working storage, laid over edge_locations: once the points are drawn
+//(and encoded for export) they are not needed until the next frame
+typedef struct {
+    vec_point contour[3000];
+    vec_point points[4000];
+    uint32_t stack[1000];
+    vec_path paths[1000];
+} vec_workspace;
+static_assert(sizeof(vec_workspace) <= sizeof(edge_locations), "vectoriser workspace must fit in edge_locations");
+
+static int vec_get(void *ctx, short x, short y){
+    return readPixel(x, y) == WHITE;
+}
+
+static void vec_clear(void *ctx, short x, short y){
+    drawPixel(x, y, BLACK);
+}
+
+static void vectorize_edges(int num_edges){
+    uint32_t start = time_us_32();
+    //Close the gaps dithering leaves between points on a row, so edges
+    //are 8-connected for the tracer
+    for(int i = 1; i < num_edges; i++){
+        short y = edge_locations[1][i];
+        short x0 = edge_locations[0][i-1], x1 = edge_locations[0][i];
+        if(y == edge_locations[1][i-1] && abs(x1 - x0) <= dithering_number + 1){
+            drawHLine(x0 < x1 ? x0 : x1, y, abs(x1 - x0) + 1, WHITE);
+        }
+    }
+
+    vec_workspace *ws = (vec_workspace *)edge_locations;
+    vec_image image = {vec_get, vec_clear, NULL, 640, 480};
+    vec_result result = {ws->contour, 3000, ws->stack, 1000, ws->points, 4000, ws->paths, 1000};
+    vecTrace(&image, &result, VEC_MIN_PIXELS, VEC_EPSILON);
+    vecOrder(&result, VEC_WINDOW, VEC_PASSES);
+
+    //Draw the pen-up moves, then the paths over them
+    vec_point pen = {0, 0};
+    for(int i = 0; i < result.n_paths; i++){
+        vec_path *p = &result.paths[i];
+        vec_point first = ws->points[p->reversed ? p->start + p->count - 1 : p->start];
+        drawLine(pen.x, pen.y, first.x, first.y, BLUE);
+        pen = ws->points[p->reversed ? p->start : p->start + p->count - 1];
+    }
+    for(int i = 0; i < result.n_paths; i++){
+        vec_path *p = &result.paths[i];
+        for(int k = 1; k < p->count; k++){
+            drawLine(ws->points[p->start + k - 1].x, ws->points[p->start + k - 1].y,
+                     ws->points[p->start + k].x, ws->points[p->start + k].y, WHITE);
+        }
+        if(p->count == 1){
+            drawPixel(ws->points[p->start].x, ws->points[p->start].y, WHITE);
+        }
+    }
+
+    if(edge_export_enabled && edgeExportClaim(&edge_export)){
+        uint32_t len;
+        int fit = vecEncodePaths(&result, edge_export.buf, EDGE_EXPORT_BYTES, &len);
+        edgeExportCommit(&edge_export, FS_PKT_PATH_FRAME, fit, len);
+        edgeExportPump(&edge_export);
+        stream_pump();
+    }
+
+    vec_paths = result.n_paths;
+    vec_points = result.n_points;
+    vec_travel_before = result.travel_before;
+    vec_travel_after = result.travel_after;
+    vec_time_us = time_us_32() - start;
+}
+
+//Morphology (morph.h) on the B/W mask, and on the dark pixels of the
+//lookback edge detector before it looks for edges. Each stage holds rows
+//back by one; the rows still held at the end of the frame are flushed.
+volatile int morph_op = MORPH_OFF;
+volatile int morph_shape = MORPH_SQUARE;
+volatile int morph_iterations = 1;
+morph_filter morph;
+
+//Blob detection (B/W mode): the white pixels of each row are labelled
+//into connected components as the row is read out, and the blobs of the
+//last frame are boxed on screen
+#define BLOB_MIN_AREA 20
+volatile int blobs_enabled = 0;
+blob_labeler blob_labels;
+//White pixels of the row being read (dark ones for lookback edges), bit
+//(x&7) of byte x>>3 (for blobs, lookback edges, the local threshold and
+//morphology, which reads it as 32 bit words)
+uint8_t mask_row[640/8] __attribute__((aligned(4)));
+
+//Box each blob of the last frame, with a cross on its centroid. The
+//rows drawn on are dirty, so the next frame rewrites them.
+static void draw_blobs(){
+    for(int i = 0; i < blob_labels.n_blobs; i++){
+        blob_stats *b = &blob_labels.blobs[i];
+        short cx = b->sum_x / b->area, cy = b->sum_y / b->area;
+        drawRect(b->x0, b->y0, b->x1 - b->x0 + 1, b->y1 - b->y0 + 1, RED);
+        drawHLine(cx - 3, cy, 7, GREEN);
+        drawVLine(cx, cy - 3, 7, GREEN);
+    }
+}
+
+//One line of blob statistics: area, box, centroid and central moments
+static void format_blob(int i, char *buf, int len){
+    blob_stats *b = &blob_labels.blobs[i];
+    float cx = (float)b->sum_x / b->area, cy = (float)b->sum_y / b->area;
+    float mu20 = (float)b->sum_xx / b->area - cx*cx;
+    float mu02 = (float)b->sum_yy / b->area - cy*cy;
+    float mu11 = (float)b->sum_xy / b->area - cx*cy;
+    snprintf(buf, len, "blob %d: area %u box %d,%d-%d,%d c %.1f,%.1f mu %.1f %.1f %.1f\n\r",
+             i, (unsigned)b->area, b->x0, b->y0, b->x1, b->y1, cx, cy, mu20, mu02, mu11);
+}
+
+//Motion detection (color and B/W modes): each frame is shrunk to a luma
+//thumbnail while it is read out and compared block by block with the
+//last one. Mode 2 also stops redrawing the screen while the scene is
+//still; the first frame with motion is then shown one frame late.
+#define MOTION_THRESHOLD 6      //mean difference per thumbnail pixel
+#define MOTION_MIN_BLOCKS 2
+#define MOTION_HOLD 10          //still frames before motion ends
+volatile int motion_mode = 0;
+motion_detector motion;
+//"MOTION" in the top right corner while motion is in progress
+#define MOTION_HUD_WIDTH 40
+unsigned char motion_mask[HUD_HEIGHT][MOTION_HUD_WIDTH/8];
+int motion_overlay = -1;
+
+//Background subtraction (B/W mode, BW_BACKGROUND): white pixels are the
+//ones that differ from a background learned per 8x8 cell. The cells live
+//in edge_locations, which is unused outside the edge modes; the model is
+//learned again whenever the method is switched back on.
+#define BG_ALPHA_SHIFT 4        //background follows changes over ~16 frames
+#define BG_K 10                 //2.5 standard deviations
+#define BG_MIN_DIFF 12
+bg_model background;
+static_assert(sizeof(bg_cell)*BG_W*BG_H <= sizeof(edge_locations), "background cells must fit in edge_locations");
+
+//Luma histogram of every non-edge frame (the raw FIFO byte). At the end
+//of the frame it picks the threshold BW_AUTO_THRESHOLD uses on the next.
+#define HIST_INITIAL_THRESHOLD 63
+histogram luma_hist;
+
+//Local threshold (B/W mode, BW_LOCAL_THRESHOLD): a pixel is white when it
+//is darker than the mean of a window over it and the rows read before it.
+//The window's rows are kept in edge_locations, like the background model
+//(only one B/W method runs at a time).
+#define LT_WINDOW 16            //rows
+#define LT_RADIUS 12            //columns either side
+#define LT_PERCENT 15
+local_threshold local_thr;
+static_assert(LT_WINDOW*LT_WIDTH <= sizeof(edge_locations), "local threshold rows must fit in edge_locations");
+
+//Offer one finished screen row to the stream
+static inline void stream_row(short y){
+    fsStreamRow(&stream_encoder, y, &vga_data_array[y*(FS_ROW_BYTES)]);
+    stream_pump();
+}
+
+//Finished a displayed row, write it if it changed and draw the overlay
+//on top of it. The overlay is part of what the row is expected to hold,
+//so it doesn't make the row dirty. Then stream it and label its blobs.
+static void show_row(short y, int redraw, int streaming, int blobs){
+    if(redraw && writeRowIfChanged(y, row_buffer)){
+        overlayCompositeRow(y);
+        clearDirtyRows(y, y);
+    }
+    if(streaming){
+        stream_row(y);
+    }
+    if(blobs){
+        blobRow(&blob_labels, y, mask_row, 640);
+    }
+}
+
+//Show a row that came out of the morphology filter
+static void show_morph_row(int redraw, int streaming, int blobs){
+    memcpy(mask_row, morph.out, sizeof(mask_row));
+    pipeline::maskToRow(pipe_ctx);
+    show_row(morph.out_y, redraw, streaming, blobs);
+}
+
+//Row kernel for the mode settings at the start of a frame
+template <class Modes>
+static pipeline::row_kernel select_bw_kernel(){
+    switch(bw_method){
+        case BW_BACKGROUND: return Modes::bw_background::row;
+        case BW_AUTO_THRESHOLD: return Modes::bw_auto::row;
+        case BW_LOCAL_THRESHOLD: return Modes::bw_local::row;
+        default: return Modes::bw_dark::row;
+    }
+}
+
+static pipeline::row_kernel select_kernel(int motion_on){
+    if(edge_detection_en == 1){
+        return pipeline::edge_simple_mode::row;
+    }
+    if(edge_detection_en == 2){
+        return pipeline::edge_lookback_mode::row;
+    }
+    if(color_enabled){
+        return motion_on ? pipeline::modes<pipeline::tap_motion>::color::row : pipeline::modes<pipeline::stage>::color::row;
+    }
+    return motion_on ? select_bw_kernel<pipeline::modes<pipeline::tap_motion> >() : select_bw_kernel<pipeline::modes<pipeline::stage> >();
+}
+
+//Camera settings by the number typed in the menu (or sent in a command frame)
+const uint8_t contrast_levels[9] = {Contrast4, Contrast3, Contrast2, Contrast1, Contrast0,
+                                    Contrast_1, Contrast_2, Contrast_3, Contrast_4};
+const uint8_t brightness_levels[9] = {Brightness4, Brightness3, Brightness2, Brightness1, Brightness0,
+                                      Brightness_1, Brightness_2, Brightness_3, Brightness_4};
+const uint8_t mirror_flip_modes[4] = {MIRROR, FLIP, MIRROR_FLIP, Normal};
+//Manual_day makes the image much more noisy and brighter,
+//Manual_cloudy is very noisy with mushed together colors
+const uint8_t light_modes[6] = {Advanced_AWB, Simple_AWB, Manual_day, Manual_A, Manual_cwf, Manual_cloudy};
+const uint8_t test_patterns[4] = {Color_bar, Color_square, BW_square, DLI};
+//Last test pattern picked, turned on again by SOURCE_SENSOR_PATTERN
+volatile int test_pattern_sel = 0;
+
+//OV5642_Test_Pattern has no way back to the camera image
+static void sensor_pattern_off(){
+    if(test_patterns[test_pattern_sel] == DLI){
+        myCAM.wrSensorReg16_8(0x4741, 0x00);
+    }
+    else{
+        myCAM.wrSensorReg16_8(0x503d, 0x00);
+    }
+}
+
+//Apply one setting, shared by the text menu and binary command frames
+//Returns CMD_OK, or CMD_ERR_OPCODE/CMD_ERR_ARG without changing anything
+int apply_setting(uint8_t opcode, uint8_t arg){
+    switch(opcode){
+        case CMD_SET_MODE:
+            if(arg > CMD_MODE_EDGE_LOOKBACK) return CMD_ERR_ARG;
+            color_enabled = (arg == CMD_MODE_COLOR);
+            if(arg == CMD_MODE_EDGE_SIMPLE){
+                edge_detection_en = 1;
+                consecutive_threshold = 4;
+            }
+            else if(arg == CMD_MODE_EDGE_LOOKBACK){
+                edge_detection_en = 2;
+                consecutive_threshold = 7;
+            }
+            else{
+                edge_detection_en = 0;
+            }
+            break;
+        case CMD_SET_THRESHOLD:
+            consecutive_threshold = arg;
+            break;
+        case CMD_SET_DITHER:
+            dithering_number = arg;
+            break;
+        case CMD_SET_CONTRAST:
+            if(arg >= sizeof(contrast_levels)) return CMD_ERR_ARG;
+            myCAM.OV5642_set_Contrast(contrast_levels[arg]);
+            break;
+        case CMD_SET_BRIGHTNESS:
+            if(arg >= sizeof(brightness_levels)) return CMD_ERR_ARG;
+            myCAM.OV5642_set_Brightness(brightness_levels[arg]);
+            break;
+        case CMD_SET_MIRROR_FLIP:
+            if(arg >= sizeof(mirror_flip_modes)) return CMD_ERR_ARG;
+            myCAM.OV5642_set_Mirror_Flip(mirror_flip_modes[arg]);
+            break;
+        case CMD_SET_LIGHT_MODE:
+            if(arg >= sizeof(light_modes)) return CMD_ERR_ARG;
+            myCAM.OV5642_set_Light_Mode(light_modes[arg]);
+            break;
+        case CMD_SET_TEST_PATTERN:
+            if(arg >= sizeof(test_patterns)) return CMD_ERR_ARG;
+            myCAM.OV5642_Test_Pattern(test_patterns[arg]);
+            test_pattern_sel = arg;
+            break;
+        case CMD_SET_SOURCE:
+            if(arg >= SOURCES) return CMD_ERR_ARG;
+            if(arg == SOURCE_SENSOR_PATTERN && source_sel != SOURCE_SENSOR_PATTERN){
+                myCAM.OV5642_Test_Pattern(test_patterns[test_pattern_sel]);
+            }
+            else if(arg != SOURCE_SENSOR_PATTERN && source_sel == SOURCE_SENSOR_PATTERN){
+                sensor_pattern_off();
+            }
+            source_sel = arg;
+            pt_thread_list[camera_thread].period = pt_thread_list[camera_thread].deadline =
+                (arg < SOURCE_SYNTHETIC) ? CAMERA_PERIOD_LIVE_US : CAMERA_PERIOD_SYNTHETIC_US;
+            break;
+        case CMD_SET_STREAM:
+            if(arg > 1) return CMD_ERR_ARG;
+            //start over with a full frame
+            if(arg && !streaming_enabled) fsInvalidate(&stream_encoder);
+            streaming_enabled = arg;
+            break;
+        case CMD_SET_EDGE_EXPORT:
+            if(arg > 1) return CMD_ERR_ARG;
+            edge_export_enabled = arg;
+            break;
+        case CMD_SET_VECTORIZE:
+            if(arg > 1) return CMD_ERR_ARG;
+            vectorize_enabled = arg;
+            break;
+        case CMD_SET_BLOBS:
+            if(arg > 1) return CMD_ERR_ARG;
+            blobs_enabled = arg;
+            break;
+        case CMD_SET_MOTION:
+            if(arg > 2) return CMD_ERR_ARG;
+            //start over with a fresh reference
+            if(arg && !motion_mode) motionReset(&motion);
+            if(!arg) overlaySetVisible(motion_overlay, 0);
+            motion_mode = arg;
+            break;
+        case CMD_SET_BW_METHOD:
+            if(arg >= BW_METHODS) return CMD_ERR_ARG;
+            bw_method = arg;
+            break;
+        case CMD_SET_AUTO_THRESHOLD:
+            if(arg > 99) return CMD_ERR_ARG;
+            luma_hist.percentile = arg;
+            break;
+        case CMD_SET_LOCAL_THRESHOLD:
+            if(arg > 99) return CMD_ERR_ARG;
+            local_thr.percent = arg;
+            break;
+        case CMD_SET_MORPH:
+            if(arg >= MORPH_OPS) return CMD_ERR_ARG;
+            morph_op = arg;
+            morphInit(&morph, morph_op, morph_shape, morph_iterations);
+            break;
+        case CMD_SET_MORPH_SHAPE:
+            if(arg >= MORPH_SHAPES) return CMD_ERR_ARG;
+            morph_shape = arg;
+            morphInit(&morph, morph_op, morph_shape, morph_iterations);
+            break;
+        case CMD_SET_MORPH_ITERATIONS:
+            if(arg < 1 || arg > MORPH_MAX_ITERATIONS) return CMD_ERR_ARG;
+            morph_iterations = arg;
+            morphInit(&morph, morph_op, morph_shape, morph_iterations);
+            break;
+#if FRAME_TIMING
+        case CMD_SET_TIMING_HUD:
+            if(arg > 1) return CMD_ERR_ARG;
+            timing_hud_enabled = arg;
+            overlaySetVisible(timing_overlay, arg);
+            break;
+#endif
+        case CMD_PING:
+            break;
+        default:
+            return CMD_ERR_OPCODE;
+    }
+    return CMD_OK;
+}
+
+//Binary command frames, picked out of the uart stream by the receive
+//interrupt and queued for protothread_command
+#define CMD_QUEUE_LEN 4     //power of 2
+typedef struct {
+    uint8_t seq;
+    uint8_t len;
+    uint8_t payload[CMD_MAX_PAYLOAD];
+} cmd_frame;
+cmd_parser cmd_rx_parser;
+cmd_frame cmd_queue[CMD_QUEUE_LEN];
+volatile unsigned int cmd_queue_head = 0, cmd_queue_tail = 0;
+volatile unsigned int cmd_frames_bad = 0;       //crc or framing errors
+volatile unsigned int cmd_frames_dropped = 0;   //valid frames lost because the queue was full
+
+//Runs in the uart interrupt for every received byte. A frame cut short
+//is dropped after CMD_FRAME_GAP_US, so it cannot swallow the keys and
+//frames that come after it
+static int cmd_rx_hook(char ch){
+    int result = cmdParserFeedAt(&cmd_rx_parser, (uint8_t)ch, timer_hw->timerawl);
+    if(result == CMD_PARSE_FRAME){
+        TRACE_IRQ(TR_CMD_FRAME, cmd_rx_parser.seq);
+        if(cmd_queue_head - cmd_queue_tail < CMD_QUEUE_LEN){
+            cmd_frame *f = &cmd_queue[cmd_queue_head & (CMD_QUEUE_LEN-1)];
+            f->seq = cmd_rx_parser.seq;
+            f->len = cmd_rx_parser.len;
+            memcpy(f->payload, cmd_rx_parser.payload, f->len);
+            cmd_queue_head++;
+        }
+        else{
+            cmd_frames_dropped++;
+        }
+    }
+    else if(result == CMD_PARSE_ERROR){
+        cmd_frames_bad++;
+    }
+    return result != CMD_PARSE_IDLE;
+}
+
+#if EVENT_TRACE
+//Names of the threads in the order main adds them, for the trace dump
+static const char *const trace_thread_names[] = {"serial", "command", "camera"};
+
+//VGA DMA channel 0 finished sending the screen, it is restarted by channel 1
+static void scanout_irq(void){
+    static uint16_t scanouts = 0;
+    dma_hw->ints0 = 1u << 0;
+    TRACE_IRQ(TR_SCANOUT, ++scanouts);
+}
+
+#if TRACE_BLITS
+static void trace_blit(int words){
+    TRACE(TR_BLIT, words);
+}
+#endif
+#endif
 
 pio_spi_inst_t spi = {
     .pio = pio0,
@@ -95,6 +738,13 @@ static PT_THREAD (protothread_serial(struct pt *pt))
   PT_BEGIN(pt);
   // stores user input
   static char user_input ;
+  // thread index for printing scheduler statistics
+  static int stats_thread ;
+#if EVENT_TRACE
+  // ring and event being dumped
+  static int trace_ring_num, trace_n ;
+  static uint32_t trace_pos ;
+#endif
   // wait for 0.1 sec
   PT_YIELD_usec(1000000) ;
   // announce the threader version
@@ -113,12 +763,18 @@ static PT_THREAD (protothread_serial(struct pt *pt))
       serial_read ;
       // convert input string to number
       sscanf(pt_serial_in_buffer,"%c", &user_input) ;
+      TRACE(TR_MENU, user_input);
+
+    // Menu for a human at a terminal, automated rigs send binary command
+    // frames instead (cmd_protocol.h, host/camctl), handled by protothread_command
 
     // m : toggle color mode
     // c : contrast
     // b : brightness
     // l : lightness
     // f : flipping
+    // S : frame source: the camera, its test pattern, or a synthetic pattern to time
+    //     processing and display without the sensor (compare with 'z')
 
     //EDGE DETECTION COMMANDS
     // n : change threshold for edge detection
@@ -126,45 +782,75 @@ static PT_THREAD (protothread_serial(struct pt *pt))
     // d : adjust dithering in edge detection, will allow for you to determine how many pixels there are in between 2 solid pixels
     // s : simple edge detection toggle on
     // r : Disable edge detection, show raw image on screen
+
+    //STATS COMMANDS
+    // w : print rows written/skipped in the last frame
+    // p : print per-thread scheduler statistics
+    // T : dump the event trace (host/trace2json turns it into a Chrome trace)
+    // u : print serial overflow and bad command frame counters
+    // z : print min/avg/p99 time of each phase of the camera's frames, and its overruns
+    // q : toggle the frame rate and timing HUD
+
+    //STREAMING COMMANDS
+    // v : toggle frame streaming over USB and print its counters
+    // x : toggle edge point export over USB and print its counters
+    // g : toggle the edge vectoriser and print its last result
+
+    //BLOB COMMANDS (B/W mode)
+    // o : toggle blob detection and print the last frame's blobs
+
+    //MOTION COMMANDS (color and B/W modes)
+    // k : cycle motion detection off/on/on skipping still frames and print its state
+
+    //B/W COMMANDS
+    // a : cycle the B/W method (dark pixels, background subtraction, auto threshold,
+    //     local threshold) and print its state
+    // h : print the last frame's luma histogram and automatic threshold
+    // i : pick the automatic threshold by Otsu's method or as a percentile
+    // j : set how much darker than its surroundings a pixel is made white by the local threshold
+    // y : set the morphology applied to the B/W mask and before lookback edge detection
     switch(user_input){
         case 'm':
-            if(color_enabled){
-                color_enabled = 0;
-            }
-            else{
-                color_enabled = 1;
-                edge_detection_en = 0;
-            }
+            apply_setting(CMD_SET_MODE, color_enabled ? CMD_MODE_BW : CMD_MODE_COLOR);
             break;
         case 'e':
-            color_enabled = 0;
-            edge_detection_en = 2;
-            consecutive_threshold = 7;
+            apply_setting(CMD_SET_MODE, CMD_MODE_EDGE_LOOKBACK);
             break;
         case 's':
-            color_enabled = 0;
-            edge_detection_en = 1;
-            consecutive_threshold = 4;
+            apply_setting(CMD_SET_MODE, CMD_MODE_EDGE_SIMPLE);
             break;
         case 'r':
-            color_enabled = 0;
-            edge_detection_en = 0;
+            apply_setting(CMD_SET_MODE, CMD_MODE_BW);
             break;
         case 'n':
             sprintf(pt_serial_out_buffer, "Input new consecutive threshold: ");
             serial_write ;
             serial_read ;
-            // convert input string to number
-            sscanf(pt_serial_in_buffer,"%i", &user_input) ;
-            consecutive_threshold = user_input;
+            // convert input string to number, a bad one leaves it unchanged
+            {
+                int value = -1;
+                sscanf(pt_serial_in_buffer,"%i", &value) ;
+                if(value >= 0 && value <= 255) apply_setting(CMD_SET_THRESHOLD, value);
+                else{
+                    sprintf(pt_serial_out_buffer, "Out of range, setting unchanged\n\r");
+                    serial_write ;
+                }
+            }
             break;
         case 'd':
             sprintf(pt_serial_out_buffer, "Input new number between 2 solids: ");
             serial_write ;
             serial_read ;
-            // convert input string to number
-            sscanf(pt_serial_in_buffer,"%i", &user_input) ;
-            dithering_number = user_input;
+            // convert input string to number, a bad one leaves it unchanged
+            {
+                int value = -1;
+                sscanf(pt_serial_in_buffer,"%i", &value) ;
+                if(value >= 0 && value <= 255) apply_setting(CMD_SET_DITHER, value);
+                else{
+                    sprintf(pt_serial_out_buffer, "Out of range, setting unchanged\n\r");
+                    serial_write ;
+                }
+            }
             break;
         case 'c':
             sprintf(pt_serial_out_buffer, "Input new contrast value 0-8:");
@@ -174,36 +860,8 @@ static PT_THREAD (protothread_serial(struct pt *pt))
             serial_read ;
             // convert input string to number
             sscanf(pt_serial_in_buffer,"%c", &user_input) ;
-                switch(user_input){
-                    case '0':
-                        myCAM.OV5642_set_Contrast(Contrast4);
-                        break;
-                    case '1':
-                        myCAM.OV5642_set_Contrast(Contrast3);
-                        break;
-                    case '2':
-                        myCAM.OV5642_set_Contrast(Contrast2);
-                        break;
-                    case '3':
-                        myCAM.OV5642_set_Contrast(Contrast1);
-                        break;
-                    case '4':
-                        myCAM.OV5642_set_Contrast(Contrast0);
-                        break;
-                    case '5':
-                        myCAM.OV5642_set_Contrast(Contrast_1);
-                        break;
-                    case '6':
-                        myCAM.OV5642_set_Contrast(Contrast_2);
-                        break;
-                    case '7':
-                        myCAM.OV5642_set_Contrast(Contrast_3);
-                        break;
-                    case '8':
-                        myCAM.OV5642_set_Contrast(Contrast_4);
-                        break;
-                }
-                break;
+            apply_setting(CMD_SET_CONTRAST, user_input - '0');
+            break;
         case 'b':
             sprintf(pt_serial_out_buffer, "Input new brightness value 0-8:");
             // non-blocking write
@@ -212,36 +870,8 @@ static PT_THREAD (protothread_serial(struct pt *pt))
             serial_read ;
             // convert input string to number
             sscanf(pt_serial_in_buffer,"%c", &user_input) ;
-                switch(user_input){
-                    case '0':
-                        myCAM.OV5642_set_Brightness(Brightness4);
-                        break;
-                    case '1':
-                        myCAM.OV5642_set_Brightness(Brightness3);
-                        break;
-                    case '2':
-                        myCAM.OV5642_set_Brightness(Brightness2);
-                        break;
-                    case '3':
-                        myCAM.OV5642_set_Brightness(Brightness1);
-                        break;
-                    case '4':
-                        myCAM.OV5642_set_Brightness(Brightness0);
-                        break;
-                    case '5':
-                        myCAM.OV5642_set_Brightness(Brightness_1);
-                        break;
-                    case '6':
-                        myCAM.OV5642_set_Brightness(Brightness_2);
-                        break;
-                    case '7':
-                        myCAM.OV5642_set_Brightness(Brightness_3);
-                        break;
-                    case '8':
-                        myCAM.OV5642_set_Brightness(Brightness_4);
-                        break;
-                }
-                break;
+            apply_setting(CMD_SET_BRIGHTNESS, user_input - '0');
+            break;
         case 'f':
             sprintf(pt_serial_out_buffer, "Input 0 for mirror, 1 for flip, 2 for mirror flip, or 3 for normal:");
             // non-blocking write
@@ -250,20 +880,8 @@ static PT_THREAD (protothread_serial(struct pt *pt))
             serial_read ;
             // convert input string to number
             sscanf(pt_serial_in_buffer,"%c", &user_input) ;
-                switch(user_input){
-                    case '0':
-                        myCAM.OV5642_set_Mirror_Flip(MIRROR);
-                        break;
-                    case '1':
-                        myCAM.OV5642_set_Mirror_Flip(FLIP);
-                        break;
-                    case '2':
-                        myCAM.OV5642_set_Mirror_Flip(MIRROR_FLIP);
-                        break;
-                    case '3':
-                        myCAM.OV5642_set_Mirror_Flip(Normal);
-                }
-                break;
+            apply_setting(CMD_SET_MIRROR_FLIP, user_input - '0');
+            break;
         case 'l':
             sprintf(pt_serial_out_buffer, "Input new light setting value 0-8: \n"); 
             serial_write ;
@@ -273,27 +891,8 @@ static PT_THREAD (protothread_serial(struct pt *pt))
             serial_read ;
             // convert input string to number
             sscanf(pt_serial_in_buffer,"%c", &user_input) ;
-                switch(user_input){
-                    case '0':
-                        myCAM.OV5642_set_Light_Mode(Advanced_AWB);
-                        break;
-                    case '1':
-                        myCAM.OV5642_set_Light_Mode(Simple_AWB);
-                        break;
-                    case '2': //makes much more noisy, brighter
-                        myCAM.OV5642_set_Light_Mode(Manual_day);
-                        break;
-                    case '3':
-                        myCAM.OV5642_set_Light_Mode(Manual_A);
-                        break;
-                    case '4':
-                        myCAM.OV5642_set_Light_Mode(Manual_cwf);
-                        break;
-                    case '5': // Very noisy and mushed together colors
-                        myCAM.OV5642_set_Light_Mode(Manual_cloudy);
-                        break;
-                }
-                break;
+            apply_setting(CMD_SET_LIGHT_MODE, user_input - '0');
+            break;
         //ArduCAM has built in test patterns, but can't find what they are
         case 't':
             sprintf(pt_serial_out_buffer, "Input test pattern 0=color_bar, 1=color_square, 2=BW_square, 3=DLI: \n"); 
@@ -301,29 +900,235 @@ static PT_THREAD (protothread_serial(struct pt *pt))
             serial_read ;
             // convert input string to number
             sscanf(pt_serial_in_buffer,"%c", &user_input) ;
-                switch(user_input){
-                    case '0':
-                        myCAM.OV5642_Test_Pattern(Color_bar);
-                        break;
-                    case '1':
-                        myCAM.OV5642_Test_Pattern(Color_square);
-                        break;
-                    case '2': //makes much more noisy, brighter
-                        myCAM.OV5642_Test_Pattern(BW_square);
-                        break;
-                    case '3':
-                        myCAM.OV5642_Test_Pattern(DLI);
-                        break;
+            apply_setting(CMD_SET_TEST_PATTERN, user_input - '0');
+            break;
+        case 'S':
+            sprintf(pt_serial_out_buffer, "Input frame source 0=camera, 1=sensor test pattern,\n\r");
+            serial_write ;
+            sprintf(pt_serial_out_buffer, "2=bars, 3=gradient, 4=checkerboard, 5=moving shapes: ");
+            serial_write ;
+            serial_read ;
+            sscanf(pt_serial_in_buffer,"%c", &user_input) ;
+            apply_setting(CMD_SET_SOURCE, user_input - '0');
+            break;
+        case 'w':
+            sprintf(pt_serial_out_buffer, "rows written %u skipped %u, readout %u us\n\r", last_rows_written, last_rows_skipped, last_readout_us);
+            serial_write ;
+            break;
+        case 'v':
+            apply_setting(CMD_SET_STREAM, !streaming_enabled);
+            sprintf(pt_serial_out_buffer, "streaming %s, frame %u bytes %u deferred rows %u dropped frames %u\n\r",
+                    streaming_enabled ? "on" : "off", stream_encoder.frame, stream_encoder.bytes_sent,
+                    stream_encoder.rows_deferred, stream_encoder.frames_dropped);
+            serial_write ;
+            break;
+        case 'x':
+            apply_setting(CMD_SET_EDGE_EXPORT, !edge_export_enabled);
+            sprintf(pt_serial_out_buffer, "edge export %s, frames %u skipped %u points %u truncated %u\n\r",
+                    edge_export_enabled ? "on" : "off", edge_export.frames_exported, edge_export.frames_skipped,
+                    edge_export.points_exported, edge_export.points_truncated);
+            serial_write ;
+            break;
+        case 'g':
+            apply_setting(CMD_SET_VECTORIZE, !vectorize_enabled);
+            sprintf(pt_serial_out_buffer, "vectoriser %s, paths %u points %u pen-up travel %u -> %u px, %u us\n\r",
+                    vectorize_enabled ? "on" : "off", vec_paths, vec_points, vec_travel_before, vec_travel_after, vec_time_us);
+            serial_write ;
+            break;
+        case 'o':
+            apply_setting(CMD_SET_BLOBS, !blobs_enabled);
+            sprintf(pt_serial_out_buffer, "blobs %s, %d found, labels exhausted %u runs dropped %u\n\r",
+                    blobs_enabled ? "on" : "off", blob_labels.n_blobs, blob_labels.labels_exhausted, blob_labels.runs_dropped);
+            serial_write ;
+            for(stats_thread = 0; stats_thread < blob_labels.n_blobs; stats_thread++){
+                format_blob(stats_thread, pt_serial_out_buffer, pt_buffer_size);
+                serial_write ;
+            }
+            break;
+        case 'k':
+            apply_setting(CMD_SET_MOTION, (motion_mode + 1) % 3);
+            sprintf(pt_serial_out_buffer, "motion mode %d, %s, events %u last at frame %u of %u\n\r",
+                    motion_mode, motion.active ? "moving" : "still", motion.events, motion.last_event, motion.frames);
+            serial_write ;
+            sprintf(pt_serial_out_buffer, "moving blocks %d box %d,%d-%d,%d max sad %u\n\r",
+                    motion.n_moving, motion.x0, motion.y0, motion.x1, motion.y1, motion.max_sad);
+            serial_write ;
+            break;
+        case 'a':
+            apply_setting(CMD_SET_BW_METHOD, (bw_method + 1) % BW_METHODS);
+            sprintf(pt_serial_out_buffer, "bw method %d, background %s after %u frames, %u foreground pixels\n\r",
+                    bw_method, background.learned ? "learned" : "learning", background.frames, background.last_fg_pixels);
+            serial_write ;
+            break;
+        case 'h':
+            sprintf(pt_serial_out_buffer, "threshold %u (%s) mean %u pixels %u\n\r", luma_hist.threshold,
+                    luma_hist.percentile == HIST_OTSU ? "otsu" : "percentile", luma_hist.mean, luma_hist.pixels);
+            serial_write ;
+            //8 bins of 8 luma values per line
+            for(stats_thread = 0; stats_thread < HIST_REPORT_BINS; stats_thread += 8){
+                uint32_t *r = &luma_hist.report[stats_thread];
+                sprintf(pt_serial_out_buffer, "%3d: %u %u %u %u %u %u %u %u\n\r", stats_thread * (HIST_BINS/HIST_REPORT_BINS),
+                        r[0], r[1], r[2], r[3], r[4], r[5], r[6], r[7]);
+                serial_write ;
+            }
+            break;
+        case 'i':
+            sprintf(pt_serial_out_buffer, "Input 0 for Otsu, or the percent of pixels to make white 1-99: ");
+            serial_write ;
+            serial_read ;
+            // range checked here, apply_setting's uint8_t would wrap 256 to Otsu
+            {
+                int value = -1;
+                sscanf(pt_serial_in_buffer,"%i", &value) ;
+                if(value >= 0 && value <= 99) apply_setting(CMD_SET_AUTO_THRESHOLD, value);
+                else{
+                    sprintf(pt_serial_out_buffer, "Out of range, setting unchanged\n\r");
+                    serial_write ;
+                }
+            }
+            break;
+        case 'j':
+            sprintf(pt_serial_out_buffer, "Input local threshold percent 0-99: ");
+            serial_write ;
+            serial_read ;
+            {
+                int value = -1;
+                sscanf(pt_serial_in_buffer,"%i", &value) ;
+                if(value >= 0 && value <= 99) apply_setting(CMD_SET_LOCAL_THRESHOLD, value);
+                else{
+                    sprintf(pt_serial_out_buffer, "Out of range, setting unchanged\n\r");
+                    serial_write ;
+                }
+            }
+            break;
+        case 'y':{
+            sprintf(pt_serial_out_buffer, "Operation 0=off 1=erode 2=dilate 3=open 4=close\n\r");
+            serial_write ;
+            sprintf(pt_serial_out_buffer, "Shape 0=square 1=cross 2=horizontal 3=vertical\n\r");
+            serial_write ;
+            sprintf(pt_serial_out_buffer, "Input operation, shape and iterations 1-3: ");
+            serial_write ;
+            serial_read ;
+            int op = morph_op, shape = morph_shape, iterations = morph_iterations;
+            sscanf(pt_serial_in_buffer,"%d %d %d", &op, &shape, &iterations) ;
+            // all three or none, so a bad value cannot leave a half changed filter
+            if(op >= 0 && op < MORPH_OPS && shape >= 0 && shape < MORPH_SHAPES &&
+               iterations >= 1 && iterations <= MORPH_MAX_ITERATIONS){
+                apply_setting(CMD_SET_MORPH_SHAPE, shape);
+                apply_setting(CMD_SET_MORPH_ITERATIONS, iterations);
+                apply_setting(CMD_SET_MORPH, op);
+            }
+            else{
+                sprintf(pt_serial_out_buffer, "Out of range, setting unchanged\n\r");
+                serial_write ;
+            }
+            break;
+        }
+        case 'u':
+            sprintf(pt_serial_out_buffer, "uart dropped tx %u rx %u lines %u\n\r", pt_uart_tx_dropped, pt_uart_rx_dropped, pt_uart_line_dropped);
+            serial_write ;
+            sprintf(pt_serial_out_buffer, "command frames bad %u dropped %u\n\r", cmd_frames_bad, cmd_frames_dropped);
+            serial_write ;
+            break;
+#if FRAME_TIMING
+        case 'z':
+            sprintf(pt_serial_out_buffer, "last %d of %u frames, usec min/avg/p99\n\r", ftCount(&frame_times), frame_times.frames);
+            serial_write ;
+            for(stats_thread = 0; stats_thread < FT_PHASES + 2; stats_thread++){
+                ft_summary s;
+                if(!ftSummarize(&frame_times, stats_thread, &s)) break;
+                sprintf(pt_serial_out_buffer, "%-8s %7u %7u %7u\n\r", ft_phase_names[stats_thread], s.min, s.avg, s.p99);
+                serial_write ;
+            }
+            sprintf(pt_serial_out_buffer, "period %u usec, %u overruns\n\r",
+                    pt_thread_list[camera_thread].period, pt_thread_list[camera_thread].overruns);
+            serial_write ;
+            break;
+        case 'q':
+            apply_setting(CMD_SET_TIMING_HUD, !timing_hud_enabled);
+            break;
+#endif
+#if PT_STATS
+        case 'p':
+            for(stats_thread = 0; pt_stats_format(0, stats_thread, pt_serial_out_buffer, pt_buffer_size); stats_thread++){
+                serial_write ;
+                pt_stats_format_hist(0, stats_thread, pt_serial_out_buffer, pt_buffer_size);
+                serial_write ;
+            }
+            break;
+#endif
+#if EVENT_TRACE
+        case 'T':
+            //Dump the event trace for host/trace2json, recording paused meanwhile
+            trace_buf.enabled = 0;
+            for(trace_ring_num = 0; trace_ring_num < TRACE_RINGS; trace_ring_num++){
+                sprintf(pt_serial_out_buffer, "trace ring %d %lu %lu\n\r", trace_ring_num,
+                        (unsigned long)traceHeld(&trace_buf.ring[trace_ring_num]),
+                        (unsigned long)traceLost(&trace_buf.ring[trace_ring_num]));
+                serial_write ;
+                for(trace_pos = 0; ; trace_pos += TRACE_PER_LINE){
+                    trace_n = traceFormatEvents(&trace_buf.ring[trace_ring_num], trace_pos,
+                                                pt_serial_out_buffer, pt_buffer_size - 2);
+                    if(trace_n == 0) break;
+                    strcat(pt_serial_out_buffer, "\n\r");
+                    serial_write ;
                 }
-                break;
+            }
+            for(trace_ring_num = 0; trace_ring_num < 3; trace_ring_num++){
+                sprintf(pt_serial_out_buffer, "trace thread 0 %d %s\n\r", trace_ring_num,
+                        trace_thread_names[trace_ring_num]);
+                serial_write ;
+            }
+            sprintf(pt_serial_out_buffer, "trace end\n\r");
+            serial_write ;
+            traceClear(&trace_buf);
+            trace_buf.enabled = 1;
+            break;
+#endif
         default:
             break;
     }  
+    update_mode_hud();
   
     } // END WHILE(1)
   PT_END(pt);
 } // timer thread
 
+// ==================================================
+// === binary command thread
+// ==================================================
+//Runs each queued command frame and answers it with an ack frame
+static PT_THREAD (protothread_command(struct pt *pt))
+{
+    PT_BEGIN(pt);
+    static uint8_t ack[CMD_MAX_FRAME];
+    static int ack_len;
+    while(1){
+        PT_YIELD_UNTIL(pt, cmd_queue_head != cmd_queue_tail);
+        cmd_frame *f = &cmd_queue[cmd_queue_tail & (CMD_QUEUE_LEN-1)];
+        //ack payload: CMD_ACK, status, number of commands applied
+        uint8_t reply[3] = {CMD_ACK, CMD_OK, 0};
+        if(f->len % (1 + CMD_ARG_BYTES)){
+            reply[1] = CMD_ERR_LENGTH;
+        }
+        else{
+            for(int i = 0; i < f->len; i += 1 + CMD_ARG_BYTES){
+                reply[1] = apply_setting(f->payload[i], f->payload[i+1]);
+                TRACE(TR_COMMAND, (f->payload[i] << 8) | f->payload[i+1]);
+                if(reply[1] != CMD_OK) break;
+                reply[2]++;
+            }
+        }
+        ack_len = cmdEncodeFrame(f->seq, reply, sizeof(reply), ack);
+        cmd_queue_tail++;
+        update_mode_hud();
+        //Only queue whole frames, a partial ack would desync the host
+        PT_YIELD_UNTIL(pt, pt_tx_free() >= ack_len);
+        pt_serial_write_nb((char *)ack, ack_len);
+    }
+    PT_END(pt);
+}
+
 // Animation on core 0
 static PT_THREAD (protothread_camera(struct pt *pt))
 {
@@ -387,167 +1192,192 @@ static PT_THREAD (protothread_camera(struct pt *pt))
     myCAM.write_reg(ARDUCHIP_FRAMES,0x00);  //FRAME control register, Number of frames to be captured
     printf("Starting capture loop\n");
 
-    int num_consecutive = 0;
-    int num_edges = 0;
+    static int num_edges = 0;
+    static uint16_t frame_number = 0;
     while(1){
-        myCAM.flush_fifo();         //Clears out the previous capture
-        myCAM.clear_fifo_flag();    //Clears the flag that an image is completed
-        myCAM.start_capture();      //Start capture
-        
-        // Wait until capture is complete 
-        while(myCAM.get_bit(ARDUCHIP_TRIG, CAP_DONE_MASK) == 0){}
+        FT_BEGIN();
+        //Start a frame and wait until it is ready
+        frame_source *source = current_source();
+        frame_number++;
+        TRACE(TR_CAPTURE_START, frame_number);
+        source->start(source);
+        TRACE(TR_CAPTURE_DONE, frame_number);
+        FT_MARK(FT_CAPTURE);
         
         //Getting the length image buffer that the frame is loaded into 
-        int length = myCAM.read_fifo_length();
-        int count = 0;
-        int first_pass = 1;
-        if(edge_detection_en == 2){
-            for(int i = 0; i < 640; i++){
-                prev_3_rows[0][i] = 0;
-                prev_3_rows[1][i] = 0;
-                prev_3_rows[2][i] = 0;
-            }
+        int length = source->length(source);
+        FT_MARK(FT_LENGTH);
+        uint32_t readout_start = time_us_32();
+        last_rows_written = vga_rows_written;
+        last_rows_skipped = vga_rows_skipped;
+        vga_rows_written = 0;
+        vga_rows_skipped = 0;
+        int streaming = streaming_enabled && fsBeginFrame(&stream_encoder);
+        int blobs = blobs_enabled && !color_enabled && !edge_detection_en;
+        int subtract_background = bw_method == BW_BACKGROUND && !color_enabled && !edge_detection_en;
+        int histogram_on = !edge_detection_en;
+        int local = bw_method == BW_LOCAL_THRESHOLD && !color_enabled && !edge_detection_en;
+        if(local){
+            ltBeginFrame(&local_thr);
+        }
+        int morph_on = morph.n_stages && !color_enabled && (edge_detection_en == 0 || edge_detection_en == 2);
+        if(morph_on){
+            morphBeginFrame(&morph);
+        }
+        if(!subtract_background && background.learned){
+            bgReset(&background);
         }
+        int motion_on = motion_mode && !edge_detection_en;
+        //Nothing moved in the last frames, leave the screen as it is
+        int skip_redraw = motion_on && motion_mode == 2 && motion.ref_valid && !motion.active && !blobs;
+        if(!motion_on && motion.ref_valid){
+            motionReset(&motion);
+        }
+        FT_MARK(FT_OTHER);
         if(edge_detection_en){
-            for(int i = 0; i < 10000; i++){
+            for(int i = 0; i < MAX_EDGES; i++){
                 edge_locations[0][i] = 0;
                 edge_locations[1][i] = 0;
             }
+            FT_MARK(FT_CLEAR);
         }
-        for(int i =0; i < length ; i++){
-            //Check to see if the first 3 rows are completed
-            if(edge_detection_en == 2){
-                if(i>=1917){
-                    first_pass = 0;
+        //Fused row kernel of this frame's mode, read and processed a row at a time
+        pipeline::row_kernel kernel = select_kernel(motion_on);
+        pipe_ctx.threshold = consecutive_threshold;
+        pipe_ctx.dither = dithering_number;
+        pipe_ctx.num_edges = 0;
+        pipeline::lookbackBeginFrame(lookback_rows);
+        int rows = length / 640 < 480 ? length / 640 : 480;
+        for(int r = 0; r < rows; r++){
+            short y = 479 - r;
+            source->read(source, raw_row, 640);
+            FT_MARK(FT_DRAIN);
+            kernel(pipe_ctx, y, raw_row);
+            FT_MARK(FT_CONVERT);
+
+            //Finished a displayed row
+            if(!edge_detection_en){
+                if(!morph_on){
+                    show_row(y, !skip_redraw, streaming, blobs);
                 }
-                else{
-                    first_pass = 1;
+                else if(morphRow(&morph, y, (const uint32_t *)mask_row)){
+                    show_morph_row(!skip_redraw, streaming, blobs);
+                }
+            }
+            //Finished a row of the lookback edge detector's dark pixels,
+            //cleaned by the morphology filter first if it is on
+            else if(edge_detection_en == 2){
+                if(!morph_on){
+                    pipeline::lookbackRow(lookback_rows, pipe_ctx, mask_row, y);
+                }
+                else if(morphRow(&morph, y, (const uint32_t *)mask_row)){
+                    pipeline::lookbackRow(lookback_rows, pipe_ctx, (const uint8_t *)morph.out, morph.out_y);
                 }
             }
-            //Read in current pixel from the SPI FIFO
-            uint8_t color = myCAM.read_fifo();
+            FT_MARK(edge_detection_en ? FT_EDGES : FT_REDRAW);
+            //Keep the previous frame's edge points draining to the host
+            if(edgeExportBusy(&edge_export)){
+                edgeExportPump(&edge_export);
+                stream_pump();
+                FT_MARK(FT_OTHER);
+            }
+        }
 
-            // uint8_t blue = (int)(color%4)/2;
-            // uint8_t green = (int)(((color - blue) >> 2)%16)/8;
-            // uint8_t red = (int)((color - green - blue) >> 6)/2;
+        //Rows still held back by the morphology filter
+        while(morph_on && morphFlush(&morph)){
+            if(edge_detection_en){
+                pipeline::lookbackRow(lookback_rows, pipe_ctx, (const uint8_t *)morph.out, morph.out_y);
+            }
+            else{
+                show_morph_row(!skip_redraw, streaming, blobs);
+            }
+        }
+        FT_MARK(edge_detection_en ? FT_EDGES : FT_REDRAW);
+        num_edges = pipe_ctx.num_edges;
 
-            //TRYING TO SHIFT THE DATA TO GET 1 BIT OF R G AND B (Good for BW)
-            uint8_t red = (int)(color>>6)>>1;
-            uint8_t green = (int)((color-(red<<6))>>4)>>1;
-            uint8_t blue = (int)((color>>2)%4)>>1;
+        if(subtract_background){
+            bgEndFrame(&background);
+        }
+        if(histogram_on){
+            histEndFrame(&luma_hist);
+        }
+        if(blobs){
+            blobEndFrame(&blob_labels);
+            draw_blobs();
+        }
 
-            //Color mode
-            if(color_enabled){
-                drawPixel(640- (i%640),480-((int)i/640),(red<<2)+(green<<1)+blue);
+        if(motion_on){
+            int was_active = motion.active;
+            motionEndFrame(&motion);
+            if(motion.active != was_active){
+                overlaySetVisible(motion_overlay, motion.active);
             }
-            //BLACK "EDGE DETECTION"
-            //Check if all of the bits of color data for a pixel are 0, if they are draw them in white
-            else{
-                if(edge_detection_en == 2){
-                    //Add a dot to array
-                    if((red<<2)+(green<<1)+blue == 0){
-                        if(first_pass){
-                            prev_3_rows[(int)(i/640)][(int)(i%640)] = 1;
-                        }
-                        else{
-                            prev_3_rows[2][(int)(i%640)] = 1;
-                        }
-                    }
-                    //Add no dot to array
-                    else{
-                        if(first_pass){
-                            prev_3_rows[(int)(i/640)][(int)(i%640)] = 0;
-                        }
-                        else{
-                            prev_3_rows[2][(int)(i%640)] = 0;
-                        }
-                    }
-                    //Finished a row, not in the first pass, check for edges
-                    if(i%639 == 0 && first_pass == 0){
-                        int count_since_pixel = 0;
-                        for(int j = 1; j <= 638; j++){
-                            if(prev_3_rows[0][j-1] + prev_3_rows[0][j]+prev_3_rows[0][j+1]+prev_3_rows[1][j-1]+prev_3_rows[1][j+1]+prev_3_rows[2][j-1] + prev_3_rows[2][j]+prev_3_rows[2][j+1] > consecutive_threshold){
-                                if(count_since_pixel == 0){
-                                    edge_locations[0][num_edges] = (j%640);
-                                    edge_locations[1][num_edges] = 480-(int)(i/640);
-                                    num_edges = num_edges + 1;
-                                    if(num_edges > 10000){
-                                        num_edges = 0;
-                                    }
-                                    count_since_pixel = count_since_pixel + 1;
-                                }
-                                else{
-                                    count_since_pixel = count_since_pixel + 1;
-                                    if (count_since_pixel >= dithering_number){
-                                        count_since_pixel = 0;
-                                    }
-                                }
-                            }
-                            else{
-                                count_since_pixel = 0;
-                            }
-                        }
-                        //Shift rows up
-                        for(int j = 0; j < 640; j++){
-                            prev_3_rows[0][j] = prev_3_rows[1][j];
-                            prev_3_rows[1][j] = prev_3_rows[2][j];
-                        }
-                    }
-                }
-                //Simple edge detection
-                else if(edge_detection_en == 1){
-                    if((red<<2)+(green<<1)+blue == 0){
-                        if(num_consecutive == consecutive_threshold){
-                            edge_locations[0][num_edges] = 640- (i%640);
-                            edge_locations[1][num_edges] = 480-((int)i/640);
-                            num_edges = num_edges + 1;
-                        }
-                        num_consecutive = num_consecutive + 1;
-                        if(num_consecutive >= 9999){
-                            num_consecutive = 0;
-                        }
-                    }
-                    else{
-                        num_consecutive = 0;
-                    }
-                }
-                else{
-                    if((red<<2)+(green<<1)+blue == 0){
-                        drawPixel(640-(i%640),480-((int)i/640),WHITE);
-                    }
-                    else{
-                        drawPixel(640-(i%640),480-((int)i/640),BLACK);
-                    }
-                }
+            //Box the moving blocks, erased with the next redraw
+            if(motion.n_moving && !skip_redraw){
+                drawRect(motion.x0, motion.y0, motion.x1 - motion.x0 + 1, motion.y1 - motion.y0 + 1, YELLOW);
             }
-            //The first 3 rows are filled, can start doing edge detection
-            //VERY BASIC IMPLEMENTATAION (BAD)
-            //drawPixel((i%640),480-((int)i/640),color>>5);
         }
+        FT_MARK(FT_OTHER);
 
         //Edge detection: Clear the screen and then draw the pixels of edges stored in edge_locations
         if(edge_detection_en != 0){
-            for(int i = 0; i < 640; i ++){
-                for(int j = 0; j < 480; j++){
-                    drawPixel(i,j,BLACK);
-                }
+            //Hand this frame's points to the exporter before they are cleared
+            //(the vectoriser exports paths instead)
+            if(edge_export_enabled && !vectorize_enabled){
+                edgeExportFrame(&edge_export, (const short *)edge_locations[0], (const short *)edge_locations[1], num_edges);
+                edgeExportPump(&edge_export);
+                stream_pump();
+                FT_MARK(FT_OTHER);
             }
 
+            fillRect(0, 0, 640, 480, BLACK);
+            FT_MARK(FT_CLEAR);
+
             //Draw the edges to the screen
-            for(int i = 0; i < 10000; i++){
+            for(int i = 0; i < MAX_EDGES; i++){
                 drawPixel(edge_locations[0][i],edge_locations[1][i],WHITE);
             }
+            FT_MARK(FT_REDRAW);
+
+            if(vectorize_enabled){
+                vectorize_edges(num_edges);
+                FT_MARK(FT_EDGES);
+            }
+
+            //Redraw the overlay over the cleared screen
+            overlayCompositeRows(0, 479);
+
+            if(streaming){
+                for(short y = 0; y < 480; y++){
+                    stream_row(y);
+                }
+            }
+            FT_MARK(FT_REDRAW);
 
             //Reset the edge location arrays
-            for(int i = 0; i < 10000; i++){
+            for(int i = 0; i < MAX_EDGES; i++){
                 edge_locations[0][i] = 0;
                 edge_locations[1][i] = 0;
             }
+            FT_MARK(FT_CLEAR);
         }
+        if(streaming){
+            fsEndFrame(&stream_encoder);
+            stream_pump();
+        }
+        FT_MARK(FT_OTHER);
+        FT_END(num_edges);
+        TRACE(TR_FRAME_END, num_edges);
         num_edges = 0;
+        last_readout_us = time_us_32() - readout_start;
+#if FRAME_TIMING
+        if(timing_hud_enabled && frame_times.frames % TIMING_HUD_INTERVAL == 0){
+            update_timing_hud();
+        }
+#endif
         
-        //Yield for a short amount of time for serial 
-        PT_YIELD_usec(5000) ;
+        //Wait for the next release, the serial and command threads run in between
+        PT_YIELD(pt) ;
     }
     PT_END(pt);
 } //Camera Thread
@@ -560,12 +1390,64 @@ int main(){
     stdio_init_all() ;
 
     stdio_init_all();
+    stdio_set_driver_enabled(&stdio_usb, false);    //USB CDC carries only the frame stream
+    pt_uart_init(BAUD_RATE);        //Interrupt driven serial at full speed
+    cmdParserReset(&cmd_rx_parser);
+    pt_uart_rx_hook = cmd_rx_hook;  //Binary command frames bypass the text menu
+    fsEncoderInit(&stream_encoder, stream_queue, STREAM_KEYFRAME_INTERVAL);
+    edgeExportInit(&edge_export, stream_queue);
+    blobInit(&blob_labels, BLOB_MIN_AREA);
+    motionInit(&motion, MOTION_THRESHOLD, MOTION_MIN_BLOCKS, MOTION_HOLD);
+    bgInit(&background, (bg_cell *)edge_locations, BG_ALPHA_SHIFT, BG_K, BG_MIN_DIFF);
+    histInit(&luma_hist, HIST_INITIAL_THRESHOLD);
+    ltInit(&local_thr, (uint8_t *)edge_locations, LT_WINDOW, LT_RADIUS, LT_PERCENT);
+    morphInit(&morph, morph_op, morph_shape, morph_iterations);
+    pipeline::initTables();
+    pipe_ctx.row = row_buffer;
+    pipe_ctx.mask = mask_row;
+    pipe_ctx.lut = luma_hist.lut;
+    pipe_ctx.hist = &luma_hist;
+    pipe_ctx.motion = &motion;
+    pipe_ctx.background = &background;
+    pipe_ctx.local = &local_thr;
+    pipe_ctx.edge_x = (short *)edge_locations[0];
+    pipe_ctx.edge_y = (short *)edge_locations[1];
+    pipe_ctx.max_edges = MAX_EDGES;
+    live_source.start = live_start;
+    live_source.length = live_length;
+    live_source.read = live_read;
+    srcSynthetic(&synthetic_source, SRC_BARS);
     myCAM.Arducam_init();	        //Initialize camera
     initVGA() ;                     // Initialize VGA
+#if EVENT_TRACE
+    traceInit(&trace_buf);
+    //Channel 0 finishing a transfer means the last line of the screen went out
+    dma_channel_set_irq0_enabled(0, true);
+    irq_set_exclusive_handler(DMA_IRQ_0, scanout_irq);
+    irq_set_enabled(DMA_IRQ_0, true);
+#if TRACE_BLITS
+    vga_blit_hook = trace_blit;
+#endif
+#endif
+    hud_overlay = overlayAdd(4, 4, HUD_WIDTH, HUD_HEIGHT, &hud_mask[0][0], HUD_WIDTH/8, GREEN);
+    update_mode_hud();
+    motion_overlay = overlayAdd(640-4-MOTION_HUD_WIDTH, 4, MOTION_HUD_WIDTH, HUD_HEIGHT, &motion_mask[0][0], MOTION_HUD_WIDTH/8, YELLOW);
+    overlayDrawString(motion_overlay, 0, 0, "MOTION");
+    overlaySetVisible(motion_overlay, 0);
+#if FRAME_TIMING
+    ftInit(&frame_times);
+    timing_overlay = overlayAdd(4, 480-4-2*HUD_HEIGHT, TIMING_HUD_WIDTH, 2*HUD_HEIGHT, &timing_mask[0][0], TIMING_HUD_WIDTH/8, CYAN);
+    overlaySetVisible(timing_overlay, 0);
+#endif
 
     // add threads
-    pt_add_thread(protothread_serial);
-    pt_add_thread(protothread_camera);
+    // The serial and command threads are released every SERIAL_PERIOD_US
+    // and the camera thread every CAMERA_PERIOD_LIVE_US, or
+    // CAMERA_PERIOD_SYNTHETIC_US on a synthetic source, earliest deadline first
+    pt_sched_method = SCHED_RATE;
+    pt_add_thread_rate(protothread_serial, SERIAL_PERIOD_US, 0);
+    pt_add_thread_rate(protothread_command, SERIAL_PERIOD_US, 0);
+    camera_thread = pt_add_rate(protothread_camera, CAMERA_PERIOD_LIVE_US, 0);
 
     // start scheduler
     pt_schedule_start ;
@@ -1,22 +1,74 @@
 #include "ArduCAM.h"
+#ifndef ARDUCAM_HOST
 #include "hardware/i2c.h"
 #include "hardware/spi.h"
 #include "hardware/irq.h"
 #include "pico/binary_info.h"
+#include "../pio_spi.h"
+#endif
 #include "ov2640_regs.h"
 #include "ov5642_regs.h"
-#include "../pio_spi.h"
+
+#ifndef ARDUCAM_HOST
+// The pico transport: spi0 with the chip select on GPIO *ctx, and i2c0
+static void pico_select(void *ctx, int selected)
+{
+	gpio_put(*(regsize *)ctx, !selected);
+}
+
+static void pico_spi(void *ctx, const uint8_t *tx, int tx_len, uint8_t *rx, int rx_len)
+{
+	if (tx_len) spi_write_blocking(SPI_PORT, tx, tx_len);
+	if (rx_len) spi_read_blocking(SPI_PORT, 0, rx, rx_len);
+}
+
+static int pico_i2c_write(void *ctx, uint8_t addr, const uint8_t *buf, int len, int nostop)
+{
+	return i2c_write_blocking(I2C_PORT, addr, buf, len, nostop);
+}
+
+static int pico_i2c_read(void *ctx, uint8_t addr, uint8_t *buf, int len)
+{
+	return i2c_read_blocking(I2C_PORT, addr, buf, len, false);
+}
+
+static void pico_delay_ms(void *ctx, uint32_t ms)
+{
+	sleep_ms(ms);
+}
+#endif
+
+// Point bus at the pico transport, or at nothing on the host until
+// set_transport
+static const cam_transport *default_transport(cam_transport *t, regsize *cs)
+{
+#ifndef ARDUCAM_HOST
+	t->ctx = cs;
+	t->select = pico_select;
+	t->spi = pico_spi;
+	t->i2c_write = pico_i2c_write;
+	t->i2c_read = pico_i2c_read;
+	t->delay_ms = pico_delay_ms;
+	return t;
+#else
+	(void)t;
+	(void)cs;
+	return 0;
+#endif
+}
 
 ArduCAM::ArduCAM()
 {
   sensor_model = OV7670;
   sensor_addr = 0x42;
+  bus = default_transport(&pico_bus, &B_CS);
 }
 ArduCAM::ArduCAM(byte model ,int CS)
 {
 	B_CS = CS;
-	*P_CS=CS;
-  sbi(P_CS, B_CS);
+	bus = default_transport(&pico_bus, &B_CS);
+	if (bus)
+		sbi(P_CS, B_CS);
 	sensor_model = model;
 	switch (sensor_model)
 	{
@@ -32,6 +84,11 @@ ArduCAM::ArduCAM(byte model ,int CS)
 	}	
 }
 
+void ArduCAM::set_transport(const cam_transport *t)
+{
+	bus = t;
+}
+
 void ArduCAM::InitCAM()
 {
  
@@ -40,7 +97,7 @@ void ArduCAM::InitCAM()
     case OV2640:
         wrSensorReg8_8(0xff, 0x01);
         wrSensorReg8_8(0x12, 0x80);
-        sleep_ms(100);
+        bus->delay_ms(bus->ctx, 100);
         if (m_fmt == JPEG)
         {
           wrSensorRegs8_8(OV2640_JPEG_INIT);
@@ -67,13 +124,13 @@ void ArduCAM::InitCAM()
 					else
 					{	
 						wrSensorRegs16_8(OV5642_QVGA_Preview);
-						sleep_ms(100);
+						bus->delay_ms(bus->ctx, 100);
 						if (m_fmt == JPEG)
 						{
-							sleep_ms(100);
+							bus->delay_ms(bus->ctx, 100);
 							wrSensorRegs16_8(OV5642_JPEG_Capture_QSXGA);
 							wrSensorRegs16_8(ov5642_320x240);
-							sleep_ms(100);
+							bus->delay_ms(bus->ctx, 100);
 							wrSensorReg16_8(0x3818, 0xa8);
 							wrSensorReg16_8(0x3621, 0x10);
 							wrSensorReg16_8(0x3801, 0xb0);
@@ -139,8 +196,7 @@ uint8_t ArduCAM::read_reg(uint8_t addr)
   uint8_t value = 0;
 	addr = addr& 0x7f;
  	cbi(P_CS, B_CS);
-	spi_write_blocking(SPI_PORT, &addr, 1);
-  	spi_read_blocking(SPI_PORT, 0, &value, 1);
+	bus->spi(bus->ctx, &addr, 1, &value, 1);
   	sbi(P_CS, B_CS);
 	return value;
 }
@@ -153,9 +209,9 @@ void ArduCAM::write_reg(uint8_t addr, uint8_t data)
     buf[0] = addr|WRITE_BIT ;  // remove read bit as this is a write
     buf[1] = data;
     cbi(P_CS, B_CS);
-    spi_write_blocking(SPI_PORT, buf, 2);
+    bus->spi(bus->ctx, buf, 2, 0, 0);
     sbi(P_CS, B_CS);
-    sleep_ms(1); 
+    bus->delay_ms(bus->ctx, 1);
 }
 
 
@@ -169,10 +225,19 @@ uint32_t ArduCAM::read_fifo_length(void)
 	return length;	
 }
 
+//Inside a CS_LOW/CS_HIGH transaction, read_fifo_burst does it all
 void ArduCAM::set_fifo_burst()
 {
-    uint8_t value;
-    spi_read_blocking(SPI_PORT, BURST_FIFO_READ, &value, 1);	
+    uint8_t cmd = BURST_FIFO_READ;
+    bus->spi(bus->ctx, &cmd, 1, 0, 0);
+}
+
+void ArduCAM::read_fifo_burst(uint8_t *buf, uint32_t len)
+{
+    uint8_t cmd = BURST_FIFO_READ;
+    cbi(P_CS, B_CS);
+    bus->spi(bus->ctx, &cmd, 1, buf, len);
+    sbi(P_CS, B_CS);
 }
 
 //Set corresponding bit  
@@ -221,8 +286,7 @@ uint8_t ArduCAM:: bus_read(int address)
 	uint8_t value = 0;
  	cbi(P_CS, B_CS);
 	uint8_t ADDRESS = (uint8_t) address;
-  	spi_write_blocking(SPI_PORT, &ADDRESS, 1);
-  	spi_read_blocking(SPI_PORT, 0, &value, 1);
+  	bus->spi(bus->ctx, &ADDRESS, 1, &value, 1);
   	sbi(P_CS, B_CS);
 	// spi0->transfer(address);
 	// value = spi0->transfer(0x00);
@@ -254,7 +318,7 @@ int ArduCAM::wrSensorRegs8_16(const struct sensor_reg reglist[])
 {
 
 		int err = 0;
-	  unsigned int reg_addr, reg_val;
+	  unsigned int reg_addr = 0, reg_val = 0;
 	  const struct sensor_reg *next = reglist;
 	  while ((reg_addr != 0xff) | (reg_val != 0xffff))
 	  {
@@ -270,8 +334,8 @@ int ArduCAM::wrSensorRegs8_16(const struct sensor_reg reglist[])
 int ArduCAM::wrSensorRegs16_8(const struct sensor_reg reglist[])
 {
 		int err = 0;
-	  unsigned int reg_addr;
-	  unsigned char reg_val;
+	  unsigned int reg_addr = 0;
+	  unsigned char reg_val = 0;
 	  const struct sensor_reg *next = reglist;
 	  while ((reg_addr != 0xffff) | (reg_val != 0xff))
 	  {
@@ -290,8 +354,8 @@ byte ArduCAM::wrSensorReg16_8(int regID, int regDat)
     buf[0]=(regID >> 8)&0xff;
     buf[1]=(regID)&0xff;
     buf[2]=regDat;
-    i2c_write_blocking(I2C_PORT, sensor_addr, buf,  3, true );
-		sleep_ms(2);
+    bus->i2c_write(bus->ctx, sensor_addr, buf,  3, true );
+		bus->delay_ms(bus->ctx, 2);
 	  return 1;
 }
 
@@ -301,11 +365,22 @@ byte ArduCAM::wrSensorReg8_8(int regID, int regDat)
 uint8_t buf[2];
     buf[0] = regID;
     buf[1] = regDat;
-    i2c_write_blocking(I2C_PORT, sensor_addr, buf,  2, true );
+    bus->i2c_write(bus->ctx, sensor_addr, buf,  2, true );
 	return 1;
 	
 }
 
+// Read/write 16 bit value to/from 8 bit register address
+byte ArduCAM::wrSensorReg8_16(int regID, int regDat)
+{
+    uint8_t buf[3];
+    buf[0] = regID;
+    buf[1] = (regDat >> 8) & 0xff;
+    buf[2] = regDat & 0xff;
+    bus->i2c_write(bus->ctx, sensor_addr, buf,  3, true );
+	return 1;
+}
+
 	void ArduCAM::OV2640_set_Special_effects(uint8_t Special_effect)
 	{
 // #if (defined (OV2640_CAM)||defined (OV2640_MINI_2MP)||defined (OV2640_MINI_2MP_PLUS))	
@@ -592,8 +667,8 @@ void ArduCAM::OV2640_set_Light_Mode(uint8_t Light_Mode)
 
 byte ArduCAM::rdSensorReg8_8(uint8_t regID, uint8_t* regDat)
 {	
-  i2c_write_blocking(I2C_PORT, sensor_addr, &regID, 1, true );
-  i2c_read_blocking(I2C_PORT, sensor_addr, regDat,  1, false );
+  bus->i2c_write(bus->ctx, sensor_addr, &regID, 1, true );
+  bus->i2c_read(bus->ctx, sensor_addr, regDat,  1);
   return 1;
 	
 }
@@ -603,9 +678,9 @@ byte ArduCAM::rdSensorReg16_8(uint16_t regID, uint8_t* regDat)
 	uint8_t buffer[2]={0};
 	buffer[0]=(regID>>8)&0xff;
 	buffer[1]=regID&0xff;
-	i2c_write_blocking(I2C_PORT, sensor_addr, buffer, 2, true );
+	bus->i2c_write(bus->ctx, sensor_addr, buffer, 2, true );
 //	i2c_write_blocking(I2C_PORT, sensor_addr, &low, 1, true );
-	i2c_read_blocking(I2C_PORT, sensor_addr, regDat,  1, false );
+	bus->i2c_read(bus->ctx, sensor_addr, regDat,  1);
 	return 1;
 }
 
@@ -661,6 +736,7 @@ void ArduCAM::set_format(byte fmt)
 }
 unsigned char usart_symbol=0;
 unsigned char usart_Command = 0;
+#ifndef ARDUCAM_HOST
 // RX interrupt handler
 void on_uart_rx() {
     while (uart_is_readable(UART_ID)) {
@@ -684,6 +760,11 @@ void ArduCAM:: Arducam_init(void)
   gpio_set_function(PIN_SCK, GPIO_FUNC_SPI);
   gpio_set_function(PIN_MOSI, GPIO_FUNC_SPI);
 }
+#else
+void ArduCAM:: Arducam_init(void)
+{
+}
+#endif
 
 
 void ArduCAM::OV5642_set_JPEG_size(uint8_t size)
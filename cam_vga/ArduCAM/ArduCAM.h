@@ -1,9 +1,13 @@
 #ifndef ARDUCAM_MIC_H
 #define ARDUCAM_MIC_H
 #include <stdio.h>
+#include <stdint.h>
+#ifndef ARDUCAM_HOST
 #include "pico/stdlib.h"
 #include "hardware/dma.h"
 #include "hardware/clocks.h"
+#endif
+#include "cam_transport.h"
 
 
 #define regtype volatile uint8_t
@@ -352,8 +356,8 @@
 
 /****************************************************/
 
-#define cbi(reg, bitmask) gpio_put(bitmask, 0)
-#define sbi(reg, bitmask) gpio_put(bitmask, 1)
+#define cbi(reg, bitmask) bus->select(bus->ctx, 1)
+#define sbi(reg, bitmask) bus->select(bus->ctx, 0)
 
 
 extern unsigned char usart_symbol;
@@ -393,6 +397,8 @@ class ArduCAM
 	
 	uint32_t read_fifo_length(void);
 	void set_fifo_burst(void);
+	// len bytes of the FIFO in one burst read transaction
+	void read_fifo_burst(uint8_t *buf, uint32_t len);
 	
 	void set_bit(uint8_t addr, uint8_t bit);
 	void clear_bit(uint8_t addr, uint8_t bit);
@@ -490,7 +496,11 @@ class ArduCAM
 	void transferBytes(uint8_t * out, uint8_t * in, uint32_t size);
 	inline void setDataBits(uint16_t bits);
 	void Arducam_init(void);
+	// Bus used from now on, the pico's spi0/i2c0 unless set
+	void set_transport(const cam_transport *t);
   protected:
+	const cam_transport *bus;
+	cam_transport pico_bus;
 	regtype *P_CS;
 	regsize B_CS;
 	byte m_fmt;
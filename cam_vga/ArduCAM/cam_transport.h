@@ -0,0 +1,44 @@
+/**
+ * Bus transport of the ArduCAM driver
+ *
+ * Every SPI, I2C and delay the ArduCAM class makes goes through one of
+ * these calls. The firmware uses the pico one built into ArduCAM.cpp
+ * (spi0 with a GPIO chip select, i2c0, sleep_ms); anything else that
+ * fills in the struct can stand in for the board, such as the ArduChip
+ * and OV5642 simulator of the host tools (host/arduchip_sim.h).
+ *
+ * An SPI transaction is everything between select(ctx, 1) and
+ * select(ctx, 0), and may be made of several spi calls.
+ *
+ * Plain C with no pico dependencies.
+ */
+
+#ifndef CAM_TRANSPORT_H
+#define CAM_TRANSPORT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    void *ctx ;                 // passed back to every call
+    // Chip select, 1 to start a transaction and 0 to end it
+    void (*select)(void *ctx, int selected) ;
+    // Clock out tx_len bytes of tx, then clock in rx_len bytes to rx
+    // (sending 0), either length may be 0
+    void (*spi)(void *ctx, const uint8_t *tx, int tx_len, uint8_t *rx, int rx_len) ;
+    // I2C to the 7 bit address; nostop keeps the bus for the read that
+    // follows. Both return the bytes moved, or a negative number when
+    // nothing answers.
+    int (*i2c_write)(void *ctx, uint8_t addr, const uint8_t *buf, int len, int nostop) ;
+    int (*i2c_read)(void *ctx, uint8_t addr, uint8_t *buf, int len) ;
+    void (*delay_ms)(void *ctx, uint32_t ms) ;
+} cam_transport ;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,78 @@
+/**
+ * Adaptive background model, see background.h
+ */
+
+#include <string.h>
+#include "background.h"
+
+void bgInit(bg_model *m, bg_cell *cells, uint8_t alpha_shift, uint8_t k, uint8_t min_diff) {
+    memset(m, 0, sizeof(*m)) ;
+    m->cells = cells ;
+    m->alpha_shift = alpha_shift ;
+    m->k = k ;
+    m->min_diff = min_diff ;
+    bgReset(m) ;
+}
+
+void bgReset(bg_model *m) {
+    memset(m->acc_sum, 0, sizeof(m->acc_sum)) ;
+    memset(m->acc_sq, 0, sizeof(m->acc_sq)) ;
+    m->loaded = -1 ;
+    m->rows = 0 ;
+    m->filled = 0 ;
+    m->learned = 0 ;
+    m->fg_pixels = 0 ;
+}
+
+void bgBeginRow(bg_model *m, short y) {
+    short cr = y >> BG_CELL_SHIFT ;
+    if (cr == m->loaded || cr < 0 || cr >= BG_H) return ;
+    const bg_cell *cell = &m->cells[cr * BG_W] ;
+    uint32_t floor = (uint32_t)m->min_diff * m->min_diff ;
+    for (int c = 0; c < BG_W; c++) {
+        m->row_mean[c] = (cell[c].mean + 128) >> 8 ;
+        uint32_t thr = ((uint32_t)m->k * m->k * cell[c].var) >> 4 ;
+        // nothing is foreground until there is a background to compare with
+        m->row_thr[c] = !m->learned ? 0xffffffff : thr > floor ? thr : floor ;
+    }
+    m->loaded = cr ;
+}
+
+void bgEndRow(bg_model *m, short y) {
+    if (++m->rows < BG_CELL) return ;
+    m->rows = 0 ;
+    short cr = y >> BG_CELL_SHIFT ;
+    if (cr < 0 || cr >= BG_H) return ;
+    bg_cell *cell = &m->cells[cr * BG_W] ;
+    for (int c = 0; c < BG_W; c++) {
+        // this frame's mean (Q8.8) and variance about it, from the squared
+        // differences about the integer mean the pixels were compared with
+        int32_t mean = ((uint32_t)m->acc_sum[c] << 8) >> (2 * BG_CELL_SHIFT) ;
+        int32_t shift = mean - (m->row_mean[c] << 8) ;
+        int32_t var = (int32_t)(m->acc_sq[c] >> (2 * BG_CELL_SHIFT)) - ((shift * shift) >> 16) ;
+        if (var < 0) var = 0 ;
+        if (m->learned) {
+            mean = cell[c].mean + ((mean - cell[c].mean) >> m->alpha_shift) ;
+            var = cell[c].var + ((var - cell[c].var) >> m->alpha_shift) ;
+        }
+        cell[c].mean = mean ;
+        cell[c].var = var > 0xffff ? 0xffff : var ;
+        m->acc_sum[c] = 0 ;
+        m->acc_sq[c] = 0 ;
+    }
+    // the next frame has to pick up the new cells
+    if (cr == m->loaded) m->loaded = -1 ;
+    m->filled++ ;
+}
+
+void bgEndFrame(bg_model *m) {
+    if (m->filled >= BG_H) m->learned = 1 ;
+    m->last_fg_pixels = m->fg_pixels ;
+    m->fg_pixels = 0 ;
+    m->filled = 0 ;
+    m->rows = 0 ;
+    m->loaded = -1 ;
+    m->frames++ ;
+    memset(m->acc_sum, 0, sizeof(m->acc_sum)) ;
+    memset(m->acc_sq, 0, sizeof(m->acc_sq)) ;
+}
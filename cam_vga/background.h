@@ -0,0 +1,97 @@
+/**
+ * Adaptive background model for foreground segmentation
+ *
+ * The background is kept per cell of BG_CELL x BG_CELL pixels (80x60
+ * cells by default): a running mean of the luma (Q8.8) and a running
+ * variance of the pixels about that mean, both updated once per frame by
+ * exponential decay with weight 2^-alpha_shift. A pixel is foreground
+ * when its squared difference from its cell's mean is above
+ * (k/4)^2 times the cell's variance, and above min_diff^2 so flat cells
+ * don't turn noise into foreground.
+ *
+ * Classification and learning happen in the same pass while the frame is
+ * read out: each pixel is compared against the model from the previous
+ * frames and added into one row of accumulators, and once the last row of
+ * a cell row is in, those cells are updated. Anything that stops moving
+ * fades into the background after about 2^alpha_shift frames.
+ *
+ * Memory: 4 bytes per cell in caller storage (19200 bytes at 80x60), plus
+ * 11 bytes per cell column in the model (880 bytes). Cost per pixel is
+ * a shift, a load, a subtract, a multiply, two adds and a compare, about
+ * a dozen cycles on a Cortex-M0+; the cell update adds a few per pixel
+ * spread over the frame.
+ *
+ * Plain C with no pico dependencies.
+ */
+
+#ifndef BACKGROUND_H
+#define BACKGROUND_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef BG_CELL_SHIFT
+#define BG_CELL_SHIFT 3             // 8x8 pixels per cell
+#endif
+#define BG_CELL (1 << BG_CELL_SHIFT)
+#define BG_W (640 >> BG_CELL_SHIFT)
+#define BG_H (480 >> BG_CELL_SHIFT)
+
+typedef struct {
+    uint16_t mean ;             // Q8.8 luma
+    uint16_t var ;              // luma^2, saturated
+} bg_cell ;
+
+typedef struct {
+    bg_cell *cells ;            // BG_H rows of BG_W cells
+    // settings
+    uint8_t alpha_shift ;       // learning rate 2^-alpha_shift per frame
+    uint8_t k ;                 // threshold in quarter standard deviations
+    uint8_t min_diff ;          // smallest difference that is foreground
+    // cell row being read
+    uint8_t row_mean[BG_W] ;
+    uint32_t row_thr[BG_W] ;    // squared difference threshold
+    uint16_t acc_sum[BG_W] ;
+    uint32_t acc_sq[BG_W] ;     // squared differences from row_mean
+    short loaded ;              // cell row in row_mean/row_thr, -1 for none
+    uint8_t rows ;              // screen rows summed into the accumulators
+    uint8_t learned ;           // cells hold at least one whole frame
+    uint8_t filled ;            // cell rows updated this frame
+    // counters
+    uint32_t fg_pixels ;        // foreground pixels this frame
+    uint32_t last_fg_pixels ;   // in the last complete frame
+    uint32_t frames ;
+} bg_model ;
+
+void bgInit(bg_model *m, bg_cell *cells, uint8_t alpha_shift, uint8_t k, uint8_t min_diff) ;
+// Forget the background, the next frame is learned as it is
+void bgReset(bg_model *m) ;
+
+// Call before the first pixel of screen row y
+void bgBeginRow(bg_model *m, short y) ;
+
+// Classify one pixel of the current row and learn from it. Returns 1 for
+// foreground (never before the first frame is learned).
+static inline int bgPixel(bg_model *m, int x, uint8_t luma) {
+    int c = x >> BG_CELL_SHIFT ;
+    int d = luma - m->row_mean[c] ;
+    uint32_t d2 = d * d ;
+    m->acc_sum[c] += luma ;
+    m->acc_sq[c] += d2 ;
+    m->fg_pixels += d2 > m->row_thr[c] ;
+    return d2 > m->row_thr[c] ;
+}
+
+// Call after the last pixel of screen row y. Rows come in order, in
+// either direction.
+void bgEndRow(bg_model *m, short y) ;
+void bgEndFrame(bg_model *m) ;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,212 @@
+/**
+ * Streaming connected-component labelling, see blob.h
+ */
+
+#include <string.h>
+#include "blob.h"
+
+// ==================================================
+// === Label table
+// ==================================================
+
+static inline uint16_t blobFind(blob_labeler *b, uint16_t l) {
+    while (b->parent[l] != l) {
+        b->parent[l] = b->parent[b->parent[l]] ;    // path halving
+        l = b->parent[l] ;
+    }
+    return l ;
+}
+
+static void blobMergeStats(blob_stats *into, const blob_stats *from) {
+    into->area += from->area ;
+    if (from->x0 < into->x0) into->x0 = from->x0 ;
+    if (from->y0 < into->y0) into->y0 = from->y0 ;
+    if (from->x1 > into->x1) into->x1 = from->x1 ;
+    if (from->y1 > into->y1) into->y1 = from->y1 ;
+    into->sum_x += from->sum_x ;
+    into->sum_y += from->sum_y ;
+    into->sum_xx += from->sum_xx ;
+    into->sum_yy += from->sum_yy ;
+    into->sum_xy += from->sum_xy ;
+}
+
+// sum of i^2 for i = 0..n
+static inline uint32_t sumSquares(int n) {
+    return (uint32_t)n * (n + 1) * (2 * n + 1) / 6 ;
+}
+
+static void blobAddRun(blob_stats *s, short y, short start, short end) {
+    uint32_t len = end - start + 1 ;
+    uint32_t sx = (uint32_t)(start + end) * len / 2 ;
+    s->area += len ;
+    if (start < s->x0) s->x0 = start ;
+    if (end > s->x1) s->x1 = end ;
+    if (y < s->y0) s->y0 = y ;
+    if (y > s->y1) s->y1 = y ;
+    s->sum_x += sx ;
+    s->sum_y += (uint32_t)y * len ;
+    s->sum_xx += sumSquares(end) - (start ? sumSquares(start - 1) : 0) ;
+    s->sum_yy += (uint64_t)y * y * len ;
+    s->sum_xy += (uint64_t)y * sx ;
+}
+
+static uint16_t blobNewLabel(blob_labeler *b) {
+    if (b->n_free == 0) {
+        b->labels_exhausted++ ;
+        return BLOB_NONE ;
+    }
+    uint16_t l = b->free_labels[--b->n_free] ;
+    blob_stats *s = &b->stats[l] ;
+    b->parent[l] = l ;
+    memset(s, 0, sizeof(*s)) ;
+    s->x0 = s->y0 = 0x7fff ;
+    s->x1 = s->y1 = -1 ;
+    return l ;
+}
+
+// Report a finished component and give its label back
+static void blobFinish(blob_labeler *b, uint16_t root) {
+    blob_stats *s = &b->stats[root] ;
+    b->free_labels[b->n_free++] = root ;
+    if (s->area < b->min_area) return ;
+    if (b->n_found < BLOB_MAX_OUT) {
+        b->found[b->n_found++] = *s ;
+        return ;
+    }
+    // full, replace the smallest if this one is bigger
+    int smallest = 0 ;
+    for (int i = 1; i < BLOB_MAX_OUT; i++) {
+        if (b->found[i].area < b->found[smallest].area) smallest = i ;
+    }
+    if (s->area > b->found[smallest].area) b->found[smallest] = *s ;
+    b->blobs_dropped++ ;
+}
+
+// Close every component that has a run in the previous row
+static void blobFinishRow(blob_labeler *b, const blob_run *runs, int n) {
+    if (++b->gen == 0) {
+        memset(b->stamp, 0, sizeof(b->stamp)) ;
+        b->gen = 1 ;
+    }
+    for (int i = 0; i < n; i++) {
+        if (runs[i].label == BLOB_NONE) continue ;
+        uint16_t root = blobFind(b, runs[i].label) ;
+        if (b->stamp[root] == b->gen) continue ;
+        b->stamp[root] = b->gen ;
+        blobFinish(b, root) ;
+    }
+}
+
+// ==================================================
+// === Frames and rows
+// ==================================================
+
+void blobInit(blob_labeler *b, uint32_t min_area) {
+    memset(b, 0, sizeof(*b)) ;
+    b->min_area = min_area ;
+    blobBeginFrame(b) ;
+}
+
+void blobBeginFrame(blob_labeler *b) {
+    b->n_runs[0] = b->n_runs[1] = 0 ;
+    b->n_merged = 0 ;
+    b->n_found = 0 ;
+    b->last_y = -2 ;
+    for (int i = 0; i < BLOB_MAX_LABELS; i++) b->free_labels[i] = BLOB_MAX_LABELS - 1 - i ;
+    b->n_free = BLOB_MAX_LABELS ;
+}
+
+void blobRow(blob_labeler *b, short y, const uint8_t *mask, int width) {
+    blob_run *prev = b->runs[b->cur ^ 1] ;
+    blob_run *cur = b->runs[b->cur] ;
+    int n_prev = b->n_runs[b->cur ^ 1], n = 0 ;
+
+    // not adjacent to the last row, nothing can connect
+    if (y != b->last_y + 1 && y != b->last_y - 1) {
+        blobFinishRow(b, prev, n_prev) ;
+        n_prev = 0 ;
+    }
+    b->last_y = y ;
+
+    // cut the row into runs, whole empty or full bytes at a time
+    int x = 0 ;
+    while (x < width) {
+        if (!(x & 7) && mask[x >> 3] == 0) {
+            x += 8 ;
+            continue ;
+        }
+        if (!(mask[x >> 3] & (1 << (x & 7)))) {
+            x++ ;
+            continue ;
+        }
+        int start = x ;
+        while (x < width) {
+            if (!(x & 7) && mask[x >> 3] == 0xff) x += 8 ;
+            else if (mask[x >> 3] & (1 << (x & 7))) x++ ;
+            else break ;
+        }
+        if (x > width) x = width ;
+        if (n == BLOB_MAX_RUNS) {
+            b->runs_dropped++ ;
+            continue ;
+        }
+        cur[n].start = start ;
+        cur[n].end = x - 1 ;
+        cur[n].label = BLOB_NONE ;
+        n++ ;
+    }
+
+    // join each run to the runs it touches above (or below)
+    int j = 0 ;
+    for (int i = 0; i < n; i++) {
+        blob_run *r = &cur[i] ;
+        while (j < n_prev && prev[j].end < r->start - 1) j++ ;
+        for (int k = j; k < n_prev && prev[k].start <= r->end + 1; k++) {
+            if (prev[k].label == BLOB_NONE) continue ;
+            uint16_t root = blobFind(b, prev[k].label) ;
+            if (r->label == BLOB_NONE) {
+                r->label = root ;
+                continue ;
+            }
+            uint16_t mine = blobFind(b, r->label) ;
+            if (root == mine) continue ;
+            b->parent[root] = mine ;
+            blobMergeStats(&b->stats[mine], &b->stats[root]) ;
+            b->merged[b->n_merged++] = root ;
+        }
+        if (r->label == BLOB_NONE) r->label = blobNewLabel(b) ;
+        if (r->label == BLOB_NONE) continue ;
+        blobAddRun(&b->stats[blobFind(b, r->label)], y, r->start, r->end) ;
+    }
+
+    // components still open have a run in this row, the rest are done
+    if (++b->gen == 0) {
+        memset(b->stamp, 0, sizeof(b->stamp)) ;
+        b->gen = 1 ;
+    }
+    for (int i = 0; i < n; i++) {
+        if (cur[i].label == BLOB_NONE) continue ;
+        cur[i].label = blobFind(b, cur[i].label) ;
+        b->stamp[cur[i].label] = b->gen ;
+    }
+    for (int k = 0; k < n_prev; k++) {
+        if (prev[k].label == BLOB_NONE) continue ;
+        uint16_t root = blobFind(b, prev[k].label) ;
+        if (b->stamp[root] == b->gen) continue ;
+        b->stamp[root] = b->gen ;
+        blobFinish(b, root) ;
+    }
+    // absorbed labels are only referenced by the previous row
+    while (b->n_merged) b->free_labels[b->n_free++] = b->merged[--b->n_merged] ;
+
+    b->n_runs[b->cur] = n ;
+    b->cur ^= 1 ;
+}
+
+void blobEndFrame(blob_labeler *b) {
+    int last = b->cur ^ 1 ;
+    blobFinishRow(b, b->runs[last], b->n_runs[last]) ;
+    memcpy(b->blobs, b->found, b->n_found * sizeof(blob_stats)) ;
+    b->n_blobs = b->n_found ;
+    blobBeginFrame(b) ;
+}
@@ -0,0 +1,83 @@
+/**
+ * Streaming connected-component labelling
+ *
+ * Single pass, run based labelling of a binary image fed one row at a
+ * time, with no frame buffer. Each row is cut into runs of set pixels;
+ * a run joins the labels of the runs it touches in the previous row
+ * (8-connected) through union-find. Labels come from a fixed table and
+ * are recycled as soon as a component has no run in the current row, at
+ * which point its statistics are final and the blob is reported.
+ *
+ * Per blob: area, bounding box and the raw moments sum x, sum y, sum x^2,
+ * sum y^2 and sum xy, from which the centroid and orientation follow.
+ *
+ * Plain C with no pico dependencies.
+ */
+
+#ifndef BLOB_H
+#define BLOB_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BLOB_MAX_LABELS 128     // components open at once
+#define BLOB_MAX_RUNS 192       // runs per row, more are dropped
+#define BLOB_MAX_OUT 16         // largest blobs kept per frame
+#define BLOB_NONE 0xffff
+
+typedef struct {
+    uint32_t area ;
+    short x0, y0, x1, y1 ;      // bounding box, inclusive
+    uint32_t sum_x, sum_y ;
+    uint64_t sum_xx, sum_yy, sum_xy ;
+} blob_stats ;
+
+typedef struct {
+    short start, end ;          // inclusive
+    uint16_t label ;
+} blob_run ;
+
+typedef struct {
+    uint32_t min_area ;         // smaller blobs are not reported
+    // row state
+    blob_run runs[2][BLOB_MAX_RUNS] ;
+    int n_runs[2] ;
+    uint8_t cur ;               // runs[cur] is the row being labelled
+    short last_y ;
+    // label table
+    uint16_t parent[BLOB_MAX_LABELS] ;
+    blob_stats stats[BLOB_MAX_LABELS] ;
+    uint16_t free_labels[BLOB_MAX_LABELS] ;
+    int n_free ;
+    uint16_t merged[BLOB_MAX_LABELS] ;  // absorbed this row, freed at row end
+    int n_merged ;
+    uint16_t stamp[BLOB_MAX_LABELS] ;   // row generation a root was last seen
+    uint16_t gen ;
+    // blobs of the frame in progress, and of the last complete frame
+    blob_stats found[BLOB_MAX_OUT] ;
+    int n_found ;
+    blob_stats blobs[BLOB_MAX_OUT] ;
+    int n_blobs ;
+    // overflow counters, since init
+    uint32_t runs_dropped ;
+    uint32_t labels_exhausted ;
+    uint32_t blobs_dropped ;
+} blob_labeler ;
+
+void blobInit(blob_labeler *b, uint32_t min_area) ;
+void blobBeginFrame(blob_labeler *b) ;
+// Label one row. mask has bit (x & 7) of byte x >> 3 set for foreground
+// pixels. Rows should come in order (either direction); a gap closes
+// every open blob.
+void blobRow(blob_labeler *b, short y, const uint8_t *mask, int width) ;
+// Close the remaining blobs and publish them in b->blobs
+void blobEndFrame(blob_labeler *b) ;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,95 @@
+/**
+ * Binary command protocol, see cmd_protocol.h
+ */
+
+#include "cmd_protocol.h"
+
+enum {
+    CMD_STATE_SYNC0,
+    CMD_STATE_SYNC1,
+    CMD_STATE_LEN,
+    CMD_STATE_SEQ,
+    CMD_STATE_PAYLOAD,
+    CMD_STATE_CRC_LO,
+    CMD_STATE_CRC_HI
+} ;
+
+uint16_t cmdCrc16(uint16_t crc, uint8_t byte) {
+    crc ^= (uint16_t)byte << 8 ;
+    for (int i = 0; i < 8; i++) {
+        crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1 ;
+    }
+    return crc ;
+}
+
+int cmdEncodeFrame(uint8_t seq, const uint8_t *payload, int len, uint8_t *out) {
+    if (len < 0 || len > CMD_MAX_PAYLOAD) return 0 ;
+    uint16_t crc = 0xffff ;
+    out[0] = CMD_SYNC0 ;
+    out[1] = CMD_SYNC1 ;
+    out[2] = len ;
+    out[3] = seq ;
+    for (int i = 0; i < len; i++) out[4 + i] = payload[i] ;
+    for (int i = 2; i < 4 + len; i++) crc = cmdCrc16(crc, out[i]) ;
+    out[4 + len] = crc & 0xff ;
+    out[5 + len] = crc >> 8 ;
+    return len + CMD_FRAME_OVERHEAD ;
+}
+
+void cmdParserReset(cmd_parser *p) {
+    p->state = CMD_STATE_SYNC0 ;
+    p->pos = 0 ;
+}
+
+// Drop the frame in progress; the byte that broke it may start the next
+static int cmdParserDrop(cmd_parser *p, uint8_t byte) {
+    cmdParserReset(p) ;
+    if (byte == CMD_SYNC0) p->state = CMD_STATE_SYNC1 ;
+    return CMD_PARSE_ERROR ;
+}
+
+int cmdParserFeed(cmd_parser *p, uint8_t byte) {
+    switch (p->state) {
+        case CMD_STATE_SYNC0:
+            if (byte != CMD_SYNC0) return CMD_PARSE_IDLE ;
+            p->state = CMD_STATE_SYNC1 ;
+            return CMD_PARSE_BUSY ;
+        case CMD_STATE_SYNC1:
+            // a second CMD_SYNC0: the first was noise, this one may start the frame
+            if (byte == CMD_SYNC0) return CMD_PARSE_BUSY ;
+            if (byte != CMD_SYNC1) return cmdParserDrop(p, byte) ;
+            p->state = CMD_STATE_LEN ;
+            return CMD_PARSE_BUSY ;
+        case CMD_STATE_LEN:
+            if (byte > CMD_MAX_PAYLOAD) return cmdParserDrop(p, byte) ;
+            p->len = byte ;
+            p->crc = cmdCrc16(0xffff, byte) ;
+            p->state = CMD_STATE_SEQ ;
+            return CMD_PARSE_BUSY ;
+        case CMD_STATE_SEQ:
+            p->seq = byte ;
+            p->crc = cmdCrc16(p->crc, byte) ;
+            p->pos = 0 ;
+            p->state = p->len ? CMD_STATE_PAYLOAD : CMD_STATE_CRC_LO ;
+            return CMD_PARSE_BUSY ;
+        case CMD_STATE_PAYLOAD:
+            p->payload[p->pos++] = byte ;
+            p->crc = cmdCrc16(p->crc, byte) ;
+            if (p->pos == p->len) p->state = CMD_STATE_CRC_LO ;
+            return CMD_PARSE_BUSY ;
+        case CMD_STATE_CRC_LO:
+            if (byte != (p->crc & 0xff)) return cmdParserDrop(p, byte) ;
+            p->state = CMD_STATE_CRC_HI ;
+            return CMD_PARSE_BUSY ;
+        default:
+            if (byte != (p->crc >> 8)) return cmdParserDrop(p, byte) ;
+            cmdParserReset(p) ;
+            return CMD_PARSE_FRAME ;
+    }
+}
+
+int cmdParserFeedAt(cmd_parser *p, uint8_t byte, uint32_t now_us) {
+    if (p->state != CMD_STATE_SYNC0 && now_us - p->last_us > CMD_FRAME_GAP_US) cmdParserReset(p) ;
+    p->last_us = now_us ;
+    return cmdParserFeed(p, byte) ;
+}
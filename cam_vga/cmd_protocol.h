@@ -0,0 +1,118 @@
+/**
+ * Binary command protocol
+ *
+ * Framed commands for automated rigs, received on the same uart as the
+ * text menu. A frame is
+ *
+ *   CMD_SYNC0 CMD_SYNC1 len seq payload[len] crc_lo crc_hi
+ *
+ * The crc is CRC-16/CCITT (poly 0x1021, init 0xffff) over len, seq and
+ * the payload. The payload is a batch of commands, each an opcode byte
+ * followed by CMD_ARG_BYTES argument bytes, applied in order. The device
+ * answers every frame with an ack frame carrying the same seq:
+ *
+ *   CMD_ACK status applied
+ *
+ * where applied is the number of commands run before the first failure.
+ * Acks are asynchronous: the host may have several frames in flight and
+ * match the acks up by seq.
+ *
+ * Plain C with no pico dependencies, shared with the host tools.
+ */
+
+#ifndef CMD_PROTOCOL_H
+#define CMD_PROTOCOL_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CMD_SYNC0 0xa5      // never typed by a human, starts a frame
+#define CMD_SYNC1 0x5a
+#define CMD_MAX_PAYLOAD 64
+#define CMD_FRAME_OVERHEAD 6
+#define CMD_MAX_FRAME (CMD_MAX_PAYLOAD + CMD_FRAME_OVERHEAD)
+#define CMD_ARG_BYTES 1
+#define CMD_FRAME_GAP_US 5000   // a pause this long inside a frame drops it
+
+// Opcodes, host to device. Arguments match the text menu entries.
+#define CMD_SET_MODE        0x01    // CMD_MODE_*
+#define CMD_SET_THRESHOLD   0x02    // edge detection consecutive threshold
+#define CMD_SET_DITHER      0x03    // pixels between two solid edge pixels
+#define CMD_SET_CONTRAST    0x04    // 0-8
+#define CMD_SET_BRIGHTNESS  0x05    // 0-8
+#define CMD_SET_MIRROR_FLIP 0x06    // 0 mirror, 1 flip, 2 mirror flip, 3 normal
+#define CMD_SET_LIGHT_MODE  0x07    // 0-5
+#define CMD_SET_TEST_PATTERN 0x08   // 0-3
+#define CMD_PING            0x09    // argument ignored
+#define CMD_SET_STREAM      0x0a    // 0 off, 1 stream frames over USB
+#define CMD_SET_EDGE_EXPORT 0x0b    // 0 off, 1 export edge points over USB
+#define CMD_SET_VECTORIZE   0x0c    // 0 off, 1 vectorise edges into ordered polylines
+#define CMD_SET_BLOBS       0x0d    // 0 off, 1 label blobs in B/W mode
+#define CMD_SET_MOTION      0x0e    // 0 off, 1 detect motion, 2 also skip redraw while still
+#define CMD_SET_BW_METHOD   0x0f    // B/W rule: 0 dark pixels, 1 background subtraction, 2 auto threshold, 3 local threshold
+#define CMD_SET_AUTO_THRESHOLD 0x10 // 0 Otsu, 1-99 percent of pixels at or below the threshold
+#define CMD_SET_LOCAL_THRESHOLD 0x11 // 0-99 percent darker than the local mean
+#define CMD_SET_MORPH       0x12    // 0 off, 1 erode, 2 dilate, 3 open, 4 close
+#define CMD_SET_MORPH_SHAPE 0x13    // 0 square, 1 cross, 2 horizontal, 3 vertical
+#define CMD_SET_MORPH_ITERATIONS 0x14 // 1-3
+#define CMD_SET_TIMING_HUD  0x15    // 0 off, 1 show frame rate and phase times on screen
+#define CMD_SET_SOURCE      0x16    // 0 camera, 1 sensor test pattern, 2-5 synthetic bars/gradient/checkerboard/shapes
+
+// Device to host
+#define CMD_ACK             0x80
+
+// CMD_SET_MODE arguments
+#define CMD_MODE_BW         0
+#define CMD_MODE_COLOR      1
+#define CMD_MODE_EDGE_SIMPLE 2
+#define CMD_MODE_EDGE_LOOKBACK 3
+
+// Ack status
+#define CMD_OK              0
+#define CMD_ERR_OPCODE      1
+#define CMD_ERR_ARG         2
+#define CMD_ERR_LENGTH      3
+
+// cmd_parser_feed results
+#define CMD_PARSE_IDLE      0   // byte is not part of a frame
+#define CMD_PARSE_BUSY      1   // byte consumed, frame not complete
+#define CMD_PARSE_FRAME     2   // frame complete and valid
+#define CMD_PARSE_ERROR     3   // byte consumed, frame dropped (crc/length)
+
+typedef struct {
+    uint8_t state ;
+    uint8_t len ;
+    uint8_t seq ;
+    uint8_t pos ;
+    uint16_t crc ;
+    uint32_t last_us ;
+    uint8_t payload[CMD_MAX_PAYLOAD] ;
+} cmd_parser ;
+
+uint16_t cmdCrc16(uint16_t crc, uint8_t byte) ;
+
+// Build a frame into out (CMD_MAX_FRAME bytes). Returns its length, or 0
+// if the payload is too long
+int cmdEncodeFrame(uint8_t seq, const uint8_t *payload, int len, uint8_t *out) ;
+
+// Byte at a time frame decoder, safe to call from an interrupt. After
+// CMD_PARSE_FRAME the frame is in p->seq, p->len and p->payload until the
+// next byte is fed. A CMD_SYNC0 that breaks a frame is taken as the start
+// of the next one.
+void cmdParserReset(cmd_parser *p) ;
+int cmdParserFeed(cmd_parser *p, uint8_t byte) ;
+
+// cmdParserFeed for a byte received at now_us on a free running usec
+// clock. A frame is sent in one go, so a byte more than CMD_FRAME_GAP_US
+// after the previous one drops the frame in progress instead of being
+// taken as the rest of it.
+int cmdParserFeedAt(cmd_parser *p, uint8_t byte, uint32_t now_us) ;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,112 @@
+/**
+ * Edge point export, see edge_export.h
+ */
+
+#include <string.h>
+#include "edge_export.h"
+#include "varint.h"
+
+// ==================================================
+// === Point coding
+// ==================================================
+
+int edgeEncode(const short *xs, const short *ys, int n, uint8_t *out, int cap, uint32_t *len) {
+    int used = 0, px = 0, py = 0, i ;
+    for (i = 0; i < n; i++) {
+        int dx = xs[i] - px, dy = ys[i] - py ;
+        int a = putVarint(&out[used], cap - used, (zigzag(dx) << 1) | (dy != 0)) ;
+        if (!a) break ;
+        int b = 0 ;
+        if (dy) {
+            b = putVarint(&out[used + a], cap - used - a, zigzag(dy)) ;
+            if (!b) break ;
+        }
+        used += a + b ;
+        px = xs[i] ;
+        py = ys[i] ;
+    }
+    *len = used ;
+    return i ;
+}
+
+int edgeDecode(const uint8_t *in, uint32_t len, short *xs, short *ys, int max) {
+    uint32_t pos = 0, v ;
+    int n = 0, x = 0, y = 0 ;
+    while (pos < len && n < max) {
+        int a = getVarint(&in[pos], len - pos, &v) ;
+        if (!a) return -1 ;
+        pos += a ;
+        x += unzigzag(v >> 1) ;
+        if (v & 1) {
+            a = getVarint(&in[pos], len - pos, &v) ;
+            if (!a) return -1 ;
+            pos += a ;
+            y += unzigzag(v) ;
+        }
+        xs[n] = x ;
+        ys[n] = y ;
+        n++ ;
+    }
+    return n ;
+}
+
+// ==================================================
+// === Exporter
+// ==================================================
+
+void edgeExportInit(edge_exporter *ex, fs_sink sink) {
+    memset(ex, 0, sizeof(*ex)) ;
+    ex->sink = sink ;
+}
+
+int edgeExportClaim(edge_exporter *ex) {
+    if (ex->busy) {
+        ex->frames_skipped++ ;
+        return 0 ;
+    }
+    return 1 ;
+}
+
+void edgeExportCommit(edge_exporter *ex, uint8_t type, uint32_t count, uint32_t len) {
+    ex->type = type ;
+    ex->points = count ;
+    ex->len = len ;
+    ex->sent = 0 ;
+    ex->header_sent = 0 ;
+    ex->busy = 1 ;
+}
+
+int edgeExportFrame(edge_exporter *ex, const short *xs, const short *ys, int n) {
+    uint32_t len ;
+    if (!edgeExportClaim(ex)) return 0 ;
+    int fit = edgeEncode(xs, ys, n, ex->buf, EDGE_EXPORT_BYTES, &len) ;
+    ex->points_truncated += n - fit ;
+    edgeExportCommit(ex, FS_PKT_EDGE_FRAME, fit, len) ;
+    return 1 ;
+}
+
+static int edgeSend(edge_exporter *ex, uint8_t type, uint16_t chunk, const uint8_t *payload, int len) {
+    int n = fsEncodePacket(type, ex->frame, chunk, payload, len, ex->packet) ;
+    return ex->sink(ex->packet, n) ;
+}
+
+void edgeExportPump(edge_exporter *ex) {
+    if (!ex->busy) return ;
+    if (!ex->header_sent) {
+        uint8_t info[EDGE_FRAME_INFO_BYTES] = {
+            ex->points & 0xff, (ex->points >> 8) & 0xff, (ex->points >> 16) & 0xff, ex->points >> 24,
+            ex->len & 0xff, (ex->len >> 8) & 0xff, (ex->len >> 16) & 0xff, ex->len >> 24 } ;
+        if (!edgeSend(ex, ex->type, 0, info, sizeof(info))) return ;
+        ex->header_sent = 1 ;
+    }
+    while (ex->sent < ex->len) {
+        uint32_t chunk = ex->len - ex->sent ;
+        if (chunk > FS_MAX_PAYLOAD) chunk = FS_MAX_PAYLOAD ;
+        if (!edgeSend(ex, ex->type + 1, ex->sent / FS_MAX_PAYLOAD, &ex->buf[ex->sent], chunk)) return ;
+        ex->sent += chunk ;
+    }
+    ex->busy = 0 ;
+    ex->frames_exported++ ;
+    ex->points_exported += ex->points ;
+    ex->frame++ ;
+}
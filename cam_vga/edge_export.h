@@ -0,0 +1,78 @@
+/**
+ * Edge point export
+ *
+ * Sends each frame's detected edge points to a host as a compact byte
+ * stream, over the same packet framing as frame_stream.h. Points are
+ * delta coded against the previous point and varint packed: for each
+ * point
+ *
+ *   varint(zigzag(dx) << 1 | (dy != 0)) [varint(zigzag(dy))]
+ *
+ * so a point on the same row within 31 pixels of the last one costs one
+ * byte. The first point is relative to (0, 0).
+ *
+ * A frame is exported as an FS_PKT_EDGE_FRAME packet (point count,
+ * encoded length) followed by FS_PKT_EDGE_DATA chunks, row = chunk index.
+ * The points are encoded into the exporter's own buffer when the frame
+ * ends, so detection of the next frame can reuse the point arrays while
+ * the encoded copy drains to the host. A frame that ends before the
+ * previous one has drained is skipped.
+ *
+ * Plain C with no pico dependencies, shared with the host tools.
+ */
+
+#ifndef EDGE_EXPORT_H
+#define EDGE_EXPORT_H
+
+#include <stdint.h>
+#include "frame_stream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EDGE_EXPORT_BYTES 12288     // encoded bytes per frame
+#define EDGE_FRAME_INFO_BYTES 8     // FS_PKT_EDGE_FRAME payload
+
+typedef struct {
+    fs_sink sink ;
+    uint16_t frame ;
+    uint8_t type ;              // frame packet type of the current frame
+    uint8_t busy ;              // a frame is being exported
+    uint8_t header_sent ;
+    uint32_t points ;           // points (or paths) in the frame being exported
+    uint32_t len ;              // encoded bytes
+    uint32_t sent ;             // encoded bytes already sent
+    uint32_t frames_exported ;
+    uint32_t frames_skipped ;   // still busy with the previous frame
+    uint32_t points_exported ;
+    uint32_t points_truncated ; // did not fit in EDGE_EXPORT_BYTES
+    uint8_t buf[EDGE_EXPORT_BYTES] ;
+    uint8_t packet[FS_MAX_PACKET] ;
+} edge_exporter ;
+
+// Encode up to n points into out. Returns the number of points that fit
+// and sets *len to the bytes used.
+int edgeEncode(const short *xs, const short *ys, int n, uint8_t *out, int cap, uint32_t *len) ;
+// Decode len bytes into at most max points, returns the number decoded or
+// -1 on malformed input
+int edgeDecode(const uint8_t *in, uint32_t len, short *xs, short *ys, int max) ;
+
+void edgeExportInit(edge_exporter *ex, fs_sink sink) ;
+// Take a copy of one frame's points. Returns 0 if the previous frame is
+// still being sent (this one is skipped)
+int edgeExportFrame(edge_exporter *ex, const short *xs, const short *ys, int n) ;
+// Export bytes coded by another encoder (vecEncodePaths) with the same
+// chunking: claim the exporter, code into ex->buf, then commit. type is
+// the frame packet type, its data packets are type + 1.
+int edgeExportClaim(edge_exporter *ex) ;
+void edgeExportCommit(edge_exporter *ex, uint8_t type, uint32_t count, uint32_t len) ;
+// Send as much of the current frame as the sink takes
+void edgeExportPump(edge_exporter *ex) ;
+#define edgeExportBusy(ex) ((ex)->busy)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,119 @@
+/**
+ * Synthetic and replay frame sources, see frame_source.h
+ */
+
+#include <string.h>
+#include "frame_source.h"
+
+const char *const src_pattern_names[SRC_PATTERNS] = {
+    "bars", "gradient", "checker", "shapes"
+} ;
+
+// FIFO bytes the camera decodes as each display color, luma rising with
+// the color number
+static const uint8_t color_bytes[8] = { 0x04, 0x0c, 0x24, 0x2c, 0x44, 0x4c, 0x64, 0x6c } ;
+
+#define DARK 0x04               // black, and white in B/W
+#define LIGHT 0x6c              // white
+#define SQUARE_COLOR 0x2c       // yellow
+#define CHECKER 40
+#define DISC_R 60
+#define SQUARE 80
+
+// Screen row y of the pattern into s->row, in sensor order (x = 639 - j)
+static void synthRow(frame_source *s, int y) {
+    uint8_t *row = s->row ;
+    switch (s->pattern) {
+        case SRC_BARS:
+            for (int j = 0; j < SRC_WIDTH; j++) row[j] = color_bytes[(SRC_WIDTH - 1 - j) / (SRC_WIDTH / 8)] ;
+            break ;
+        case SRC_GRADIENT:
+            for (int j = 0; j < SRC_WIDTH; j++) row[j] = (SRC_WIDTH - 1 - j + y) * 255 / (SRC_WIDTH + SRC_HEIGHT - 2) ;
+            break ;
+        case SRC_CHECKER:
+            for (int j = 0; j < SRC_WIDTH; j++) row[j] = (((SRC_WIDTH - 1 - j) / CHECKER + y / CHECKER) & 1) ? LIGHT : DARK ;
+            break ;
+        default: {
+            // disc moving right, square moving down, both wrapping around
+            int t = s->frame ;
+            int cx = DISC_R + (4 * t) % (SRC_WIDTH - 2 * DISC_R), cy = SRC_HEIGHT / 2 ;
+            int sx = 3 * SRC_WIDTH / 4, sy = (3 * t) % (SRC_HEIGHT - SQUARE) ;
+            memset(row, LIGHT, SRC_WIDTH) ;
+            int dy = y - cy ;
+            if (dy * dy <= DISC_R * DISC_R) {
+                // half width of the disc on this row
+                int w = 0 ;
+                while ((w + 1) * (w + 1) + dy * dy <= DISC_R * DISC_R) w++ ;
+                memset(&row[SRC_WIDTH - 1 - (cx + w)], DARK, 2 * w + 1) ;
+            }
+            if (y >= sy && y < sy + SQUARE) memset(&row[SRC_WIDTH - sx - SQUARE], SQUARE_COLOR, SQUARE) ;
+            break ;
+        }
+    }
+}
+
+static void synthStart(frame_source *s) {
+    s->frame++ ;
+    s->pos = 0 ;
+}
+
+static uint32_t synthLength(frame_source *s) {
+    (void)s ;
+    return SRC_FRAME_BYTES ;
+}
+
+static void synthRead(frame_source *s, uint8_t *buf, uint32_t len) {
+    while (len) {
+        if (s->pos >= SRC_FRAME_BYTES) {
+            memset(buf, 0, len) ;
+            return ;
+        }
+        uint32_t r = s->pos / SRC_WIDTH, j = s->pos % SRC_WIDTH ;
+        if (j == 0) synthRow(s, SRC_HEIGHT - 1 - r) ;
+        uint32_t n = SRC_WIDTH - j < len ? SRC_WIDTH - j : len ;
+        memcpy(buf, &s->row[j], n) ;
+        buf += n ;
+        len -= n ;
+        s->pos += n ;
+    }
+}
+
+void srcSynthetic(frame_source *s, uint8_t pattern) {
+    memset(s, 0, sizeof(*s)) ;
+    s->start = synthStart ;
+    s->length = synthLength ;
+    s->read = synthRead ;
+    s->pattern = pattern < SRC_PATTERNS ? pattern : SRC_BARS ;
+}
+
+// Replay: frame s->frame - 1 of the list
+static void replayStart(frame_source *s) {
+    s->frame++ ;
+    s->pos = 0 ;
+}
+
+static uint32_t replayLength(frame_source *s) {
+    return s->n_frames > 0 ? s->frame_bytes : 0 ;
+}
+
+static void replayRead(frame_source *s, uint8_t *buf, uint32_t len) {
+    uint32_t left = s->n_frames > 0 && s->pos < s->frame_bytes ? s->frame_bytes - s->pos : 0 ;
+    uint32_t n = len < left ? len : left ;
+    if (n) {
+        uint32_t f = s->frame ? (s->frame - 1) % s->n_frames : 0 ;
+        const uint8_t *frame = &s->frames[(uint64_t)f * s->frame_bytes] ;
+        memcpy(buf, &frame[s->pos], n) ;
+        s->pos += n ;
+    }
+    memset(buf + n, 0, len - n) ;
+}
+
+void srcReplay(frame_source *s, const uint8_t *frames, uint32_t frame_bytes, int n_frames) {
+    memset(s, 0, sizeof(*s)) ;
+    s->start = replayStart ;
+    s->length = replayLength ;
+    s->read = replayRead ;
+    s->frames = frames ;
+    s->frame_bytes = frame_bytes ;
+    s->n_frames = n_frames ;
+}
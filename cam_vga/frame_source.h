@@ -0,0 +1,76 @@
+/**
+ * Frame sources for the camera loop
+ *
+ * The camera thread gets its frames through a frame_source: start a
+ * frame (and wait until it can be read), ask its length, then read it in
+ * pieces, FIFO bytes in the order the sensor sends them (bottom row
+ * first, each row right to left). The live ArduCAM source is in
+ * 2040camera.cpp, and the sensor's own test patterns are live frames with
+ * OV5642_Test_Pattern on. This module has the sources that need no
+ * sensor:
+ *
+ *  - synthetic patterns, made a row at a time as they are read: color
+ *    bars, a gradient, a checkerboard and moving shapes (a dark disc and
+ *    a yellow square that move every frame), for running processing and
+ *    display at their own rate and comparing it with the capture bound
+ *    rate in the frame timing report
+ *  - replay of whole frames kept in memory, in turn, for the host tools
+ *    (a 640x480 frame is bigger than the RP2040's SRAM)
+ *
+ * Memory: one row (640 bytes) per synthetic source. Cost per pixel of a
+ * synthetic row is a table load or a compare or two.
+ *
+ * Plain C with no pico dependencies.
+ */
+
+#ifndef FRAME_SOURCE_H
+#define FRAME_SOURCE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SRC_WIDTH 640
+#define SRC_HEIGHT 480
+#define SRC_FRAME_BYTES (SRC_WIDTH * SRC_HEIGHT)
+
+// Synthetic patterns
+enum {
+    SRC_BARS,                   // 8 vertical bars, one per display color
+    SRC_GRADIENT,               // dark top left to bright bottom right
+    SRC_CHECKER,                // 40 pixel squares, black and white
+    SRC_SHAPES,                 // dark disc and yellow square moving on white
+    SRC_PATTERNS
+} ;
+
+extern const char *const src_pattern_names[SRC_PATTERNS] ;
+
+typedef struct frame_source frame_source ;
+struct frame_source {
+    // Start a frame and wait until it can be read
+    void (*start)(frame_source *s) ;
+    // Bytes in the frame
+    uint32_t (*length)(frame_source *s) ;
+    // The next len bytes of the frame
+    void (*read)(frame_source *s, uint8_t *buf, uint32_t len) ;
+    void *ctx ;                 // for sources defined elsewhere
+    // synthetic and replay
+    uint8_t pattern ;
+    uint32_t frame ;            // frames started
+    uint32_t pos ;              // bytes read of the frame
+    const uint8_t *frames ;     // replay: n_frames of frame_bytes, back to back
+    uint32_t frame_bytes ;
+    int n_frames ;
+    uint8_t row[SRC_WIDTH] ;    // synthetic row being read, sensor order
+} ;
+
+void srcSynthetic(frame_source *s, uint8_t pattern) ;
+void srcReplay(frame_source *s, const uint8_t *frames, uint32_t frame_bytes, int n_frames) ;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,212 @@
+/**
+ * Frame streaming codec, see frame_stream.h
+ */
+
+#include <string.h>
+#include "cmd_protocol.h"
+#include "frame_stream.h"
+
+// ==================================================
+// === PackBits
+// ==================================================
+// control byte c: 0..127 copy the next c+1 bytes, 129..255 repeat the
+// next byte 257-c times (2..128), 128 is unused
+
+int fsRleEncode(const uint8_t *src, int n, uint8_t *dst, int cap) {
+    int in = 0, out = 0 ;
+    while (in < n) {
+        int run = 1 ;
+        while (in + run < n && run < 128 && src[in + run] == src[in]) run++ ;
+        if (run >= 2) {
+            if (out + 2 > cap) return -1 ;
+            dst[out++] = 257 - run ;
+            dst[out++] = src[in] ;
+            in += run ;
+            continue ;
+        }
+        // literal up to the next run of 2 or more
+        int lit = 1 ;
+        while (in + lit < n && lit < 128 &&
+               !(in + lit + 1 < n && src[in + lit] == src[in + lit + 1])) lit++ ;
+        if (out + 1 + lit > cap) return -1 ;
+        dst[out++] = lit - 1 ;
+        memcpy(&dst[out], &src[in], lit) ;
+        out += lit ;
+        in += lit ;
+    }
+    return out ;
+}
+
+int fsRleDecode(const uint8_t *src, int n, uint8_t *dst, int cap) {
+    int in = 0, out = 0 ;
+    while (in < n) {
+        uint8_t c = src[in++] ;
+        if (c < 128) {
+            int lit = c + 1 ;
+            if (in + lit > n || out + lit > cap) return -1 ;
+            memcpy(&dst[out], &src[in], lit) ;
+            in += lit ;
+            out += lit ;
+        }
+        else if (c > 128) {
+            int run = 257 - c ;
+            if (in >= n || out + run > cap) return -1 ;
+            memset(&dst[out], src[in++], run) ;
+            out += run ;
+        }
+        else return -1 ;
+    }
+    return out ;
+}
+
+// ==================================================
+// === Packets
+// ==================================================
+
+int fsEncodePacket(uint8_t type, uint16_t frame, uint16_t row,
+                   const uint8_t *payload, int len, uint8_t *out) {
+    uint16_t crc = 0xffff ;
+    out[0] = FS_SYNC0 ;
+    out[1] = FS_SYNC1 ;
+    out[2] = type ;
+    out[3] = frame & 0xff ;
+    out[4] = frame >> 8 ;
+    out[5] = row & 0xff ;
+    out[6] = row >> 8 ;
+    out[7] = len & 0xff ;
+    out[8] = len >> 8 ;
+    memcpy(&out[FS_HEADER_BYTES], payload, len) ;
+    for (int i = 2; i < FS_HEADER_BYTES + len; i++) crc = cmdCrc16(crc, out[i]) ;
+    out[FS_HEADER_BYTES + len] = crc & 0xff ;
+    out[FS_HEADER_BYTES + len + 1] = crc >> 8 ;
+    return FS_HEADER_BYTES + len + 2 ;
+}
+
+// ==================================================
+// === Encoder
+// ==================================================
+
+void fsEncoderInit(fs_encoder *e, fs_sink sink, uint16_t keyframe_interval) {
+    memset(e, 0, sizeof(*e)) ;
+    e->sink = sink ;
+    e->keyframe_interval = keyframe_interval ? keyframe_interval : 1 ;
+}
+
+void fsInvalidate(fs_encoder *e) {
+    memset(e->row_hash, 0, sizeof(e->row_hash)) ;
+}
+
+static int fsSend(fs_encoder *e, uint8_t type, uint16_t row, const uint8_t *payload, int len) {
+    int n = fsEncodePacket(type, e->frame, row, payload, len, e->packet) ;
+    if (!e->sink(e->packet, n)) return 0 ;
+    e->bytes_sent += n ;
+    return 1 ;
+}
+
+int fsBeginFrame(fs_encoder *e) {
+    int keyframe = (e->frame % e->keyframe_interval) == 0 ;
+    uint8_t info[5] = { keyframe ? FS_FLAG_KEYFRAME : 0,
+                        FS_WIDTH & 0xff, FS_WIDTH >> 8, FS_HEIGHT & 0xff, FS_HEIGHT >> 8 } ;
+    e->rows_sent = 0 ;
+    e->active = fsSend(e, FS_PKT_FRAME, 0, info, sizeof(info)) ;
+    if (!e->active) {
+        e->frames_dropped++ ;
+        return 0 ;
+    }
+    if (keyframe) fsInvalidate(e) ;
+    return 1 ;
+}
+
+int fsStreamRow(fs_encoder *e, uint16_t row, const uint8_t *data) {
+    uint32_t hash = 2166136261u ;
+    if (!e->active || row >= FS_HEIGHT) return 0 ;
+    for (int i = 0; i < FS_ROW_BYTES; i++) hash = (hash ^ data[i]) * 16777619u ;
+    if (hash == 0) hash = 1 ;
+    if (hash == e->row_hash[row]) return 0 ;
+
+    int len = fsRleEncode(data, FS_ROW_BYTES, e->coded, FS_ROW_BYTES - 1) ;
+    int sent = (len < 0) ? fsSend(e, FS_PKT_ROW_RAW, row, data, FS_ROW_BYTES)
+                         : fsSend(e, FS_PKT_ROW_RLE, row, e->coded, len) ;
+    if (!sent) {
+        // left stale in row_hash, so it goes out in a later frame
+        e->rows_deferred++ ;
+        return -1 ;
+    }
+    e->row_hash[row] = hash ;
+    e->rows_sent++ ;
+    return 1 ;
+}
+
+void fsEndFrame(fs_encoder *e) {
+    if (!e->active) return ;
+    uint8_t info[2] = { e->rows_sent & 0xff, e->rows_sent >> 8 } ;
+    fsSend(e, FS_PKT_END, 0, info, sizeof(info)) ;
+    e->active = 0 ;
+    e->frame++ ;
+}
+
+// ==================================================
+// === Decoder
+// ==================================================
+
+enum {
+    FS_STATE_SYNC0,
+    FS_STATE_SYNC1,
+    FS_STATE_HEADER,
+    FS_STATE_PAYLOAD,
+    FS_STATE_CRC_LO,
+    FS_STATE_CRC_HI
+} ;
+
+void fsParserReset(fs_parser *p) {
+    p->state = FS_STATE_SYNC0 ;
+    p->pos = 0 ;
+}
+
+int fsParserFeed(fs_parser *p, uint8_t byte) {
+    switch (p->state) {
+        case FS_STATE_SYNC0:
+            if (byte != FS_SYNC0) return FS_PARSE_IDLE ;
+            p->state = FS_STATE_SYNC1 ;
+            return FS_PARSE_BUSY ;
+        case FS_STATE_SYNC1:
+            if (byte != FS_SYNC1) {
+                fsParserReset(p) ;
+                return FS_PARSE_ERROR ;
+            }
+            p->state = FS_STATE_HEADER ;
+            p->pos = 2 ;
+            p->crc = 0xffff ;
+            return FS_PARSE_BUSY ;
+        case FS_STATE_HEADER:
+            p->header[p->pos++] = byte ;
+            p->crc = cmdCrc16(p->crc, byte) ;
+            if (p->pos < FS_HEADER_BYTES) return FS_PARSE_BUSY ;
+            p->type = p->header[2] ;
+            p->frame = p->header[3] | (p->header[4] << 8) ;
+            p->row = p->header[5] | (p->header[6] << 8) ;
+            p->len = p->header[7] | (p->header[8] << 8) ;
+            if (p->len > FS_MAX_PAYLOAD) {
+                fsParserReset(p) ;
+                return FS_PARSE_ERROR ;
+            }
+            p->pos = 0 ;
+            p->state = p->len ? FS_STATE_PAYLOAD : FS_STATE_CRC_LO ;
+            return FS_PARSE_BUSY ;
+        case FS_STATE_PAYLOAD:
+            p->payload[p->pos++] = byte ;
+            p->crc = cmdCrc16(p->crc, byte) ;
+            if (p->pos == p->len) p->state = FS_STATE_CRC_LO ;
+            return FS_PARSE_BUSY ;
+        case FS_STATE_CRC_LO:
+            if (byte != (p->crc & 0xff)) {
+                fsParserReset(p) ;
+                return FS_PARSE_ERROR ;
+            }
+            p->state = FS_STATE_CRC_HI ;
+            return FS_PARSE_BUSY ;
+        default:
+            fsParserReset(p) ;
+            return (byte == (p->crc >> 8)) ? FS_PARSE_PACKET : FS_PARSE_ERROR ;
+    }
+}
@@ -0,0 +1,116 @@
+/**
+ * Frame streaming codec
+ *
+ * Sends packed 3 bit frames (the vga_data_array layout, 2 pixels per
+ * byte) to a host one row per packet. A row is only sent if it changed
+ * since the last time it was sent, so a still scene costs almost nothing,
+ * and rows are run length coded (PackBits) when that is smaller than the
+ * raw bytes. Every keyframe_interval frames all rows are sent again so a
+ * receiver that joins late or lost a packet catches up.
+ *
+ * Packets are
+ *
+ *   FS_SYNC0 FS_SYNC1 type frame_lo frame_hi row_lo row_hi len_lo len_hi
+ *   payload[len] crc_lo crc_hi
+ *
+ * with the CRC-16/CCITT of cmd_protocol.h over type..payload, so text
+ * printed on the same port is skipped by the receiver.
+ *
+ * Plain C with no pico dependencies, shared with the host tools.
+ */
+
+#ifndef FRAME_STREAM_H
+#define FRAME_STREAM_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FS_SYNC0 0xc3
+#define FS_SYNC1 0x3c
+#define FS_WIDTH 640
+#define FS_HEIGHT 480
+#define FS_ROW_BYTES (FS_WIDTH / 2)
+#define FS_HEADER_BYTES 9
+#define FS_MAX_PAYLOAD FS_ROW_BYTES
+#define FS_MAX_PACKET (FS_HEADER_BYTES + FS_MAX_PAYLOAD + 2)
+
+// Packet types
+#define FS_PKT_FRAME    1   // payload: flags, width (2), height (2)
+#define FS_PKT_ROW_RAW  2   // payload: FS_ROW_BYTES packed pixels
+#define FS_PKT_ROW_RLE  3   // payload: PackBits coded packed pixels
+#define FS_PKT_END      4   // payload: rows sent (2)
+#define FS_PKT_EDGE_FRAME 5 // edge points, see edge_export.h
+#define FS_PKT_EDGE_DATA  6
+#define FS_PKT_PATH_FRAME 7 // polylines, see vectorize.h
+#define FS_PKT_PATH_DATA  8
+
+#define FS_FLAG_KEYFRAME 0x01
+
+// Send function, must take the whole packet or none of it.
+// Returns nonzero if the packet was taken.
+typedef int (*fs_sink)(const uint8_t *buf, int len) ;
+
+typedef struct {
+    fs_sink sink ;
+    uint16_t frame ;
+    uint16_t keyframe_interval ;
+    uint16_t rows_sent ;        // in the current frame
+    uint32_t bytes_sent ;       // since init
+    uint32_t rows_deferred ;    // changed rows the sink had no room for
+    uint32_t frames_dropped ;   // frames whose start packet did not fit
+    uint8_t active ;            // current frame's start packet was sent
+    uint32_t row_hash[FS_HEIGHT] ;  // of each row as last sent, 0 = resend
+    uint8_t coded[FS_ROW_BYTES] ;   // scratch, kept off the small stack
+    uint8_t packet[FS_MAX_PACKET] ;
+} fs_encoder ;
+
+// PackBits. Encode returns the coded length, or -1 if it would exceed cap.
+// Decode returns the decoded length, or -1 on malformed input or overflow.
+int fsRleEncode(const uint8_t *src, int n, uint8_t *dst, int cap) ;
+int fsRleDecode(const uint8_t *src, int n, uint8_t *dst, int cap) ;
+
+// Build one packet into out (FS_MAX_PACKET bytes), returns its length
+int fsEncodePacket(uint8_t type, uint16_t frame, uint16_t row,
+                   const uint8_t *payload, int len, uint8_t *out) ;
+
+// Device side
+void fsEncoderInit(fs_encoder *e, fs_sink sink, uint16_t keyframe_interval) ;
+// Returns 1 if the frame was started, 0 if the sink is full (the rows and
+// end of this frame are then ignored)
+int fsBeginFrame(fs_encoder *e) ;
+// Returns 1 if the row was sent, 0 if it was unchanged (or the frame was
+// not started), -1 if deferred
+int fsStreamRow(fs_encoder *e, uint16_t row, const uint8_t *data) ;
+void fsEndFrame(fs_encoder *e) ;
+// Force every row out in the next frame
+void fsInvalidate(fs_encoder *e) ;
+
+// Host side: byte at a time packet decoder
+#define FS_PARSE_IDLE   0   // byte is not part of a packet
+#define FS_PARSE_BUSY   1
+#define FS_PARSE_PACKET 2   // p->type, frame, row, len, payload are valid
+#define FS_PARSE_ERROR  3
+
+typedef struct {
+    uint8_t state ;
+    uint8_t header[FS_HEADER_BYTES] ;
+    uint8_t type ;
+    uint16_t frame ;
+    uint16_t row ;
+    uint16_t len ;
+    uint16_t pos ;
+    uint16_t crc ;
+    uint8_t payload[FS_MAX_PAYLOAD] ;
+} fs_parser ;
+
+void fsParserReset(fs_parser *p) ;
+int fsParserFeed(fs_parser *p, uint8_t byte) ;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,52 @@
+/**
+ * Per-phase frame timing, see frame_timing.h
+ */
+
+#include <string.h>
+#include "frame_timing.h"
+
+const char *const ft_phase_names[FT_PHASES + 2] = {
+    "capture", "length", "drain", "convert", "edges", "redraw", "clear", "other", "total", "period"
+} ;
+
+void ftInit(frame_timing *t) {
+    memset(t, 0, sizeof(*t)) ;
+}
+
+void ftEndFrame(frame_timing *t, uint32_t now, uint32_t edges) {
+    t->cur.total = now - t->start ;
+    t->cur.edges = edges ;
+    t->ring[t->frames % FT_FRAMES] = t->cur ;
+    t->frames++ ;
+}
+
+int ftCount(const frame_timing *t) {
+    return t->frames < FT_FRAMES ? t->frames : FT_FRAMES ;
+}
+
+static uint32_t ftValue(const ft_record *r, int p) {
+    if (p == FT_TOTAL) return r->total ;
+    if (p == FT_PERIOD) return r->period ;
+    return r->phase[p] ;
+}
+
+int ftSummarize(const frame_timing *t, int p, ft_summary *s) {
+    uint32_t v[FT_FRAMES] ;
+    int n = 0 ;
+    uint64_t sum = 0 ;
+    for (int i = 0; i < ftCount(t); i++) {
+        // the first frame has no period
+        if (p == FT_PERIOD && t->frames <= FT_FRAMES && i == 0) continue ;
+        uint32_t x = ftValue(&t->ring[i], p) ;
+        // insertion sort, the ring is small
+        int j = n++ ;
+        for (; j > 0 && v[j - 1] > x; j--) v[j] = v[j - 1] ;
+        v[j] = x ;
+        sum += x ;
+    }
+    if (n == 0) return 0 ;
+    s->min = v[0] ;
+    s->avg = sum / n ;
+    s->p99 = v[(99 * n + 99) / 100 - 1] ;
+    return 1 ;
+}
@@ -0,0 +1,91 @@
+/**
+ * Per-phase frame timing
+ *
+ * The camera thread stamps the microsecond timer at the end of each phase
+ * of a frame (waiting for the capture, reading the FIFO length, draining
+ * the FIFO, converting, edge detection, redrawing, clearing). The time
+ * since the previous stamp is added to that phase, so phases that take
+ * turns row by row are summed over the frame. Each finished frame's
+ * record goes into a ring of the last FT_FRAMES frames, and the ring is
+ * summarised as min/avg/p99 per phase on request.
+ *
+ * Memory: 44 bytes per frame in the ring (2.8 KB at 64 frames). Cost is
+ * one timer read, a subtract and an add per stamp.
+ *
+ * Plain C with no pico dependencies, the caller passes the time.
+ */
+
+#ifndef FRAME_TIMING_H
+#define FRAME_TIMING_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef FT_FRAMES
+#define FT_FRAMES 64
+#endif
+
+// Phases of a frame
+#define FT_CAPTURE 0        // start the capture and wait until it is done
+#define FT_LENGTH 1         // read the FIFO length
+#define FT_DRAIN 2          // read pixels out of the FIFO
+#define FT_CONVERT 3        // row kernels
+#define FT_EDGES 4          // lookback rows and the vectoriser
+#define FT_REDRAW 5         // write rows and overlays to the screen
+#define FT_CLEAR 6          // clear the screen and the edge arrays
+#define FT_OTHER 7          // everything else
+#define FT_PHASES 8
+#define FT_TOTAL FT_PHASES  // ftSummarize the whole frame
+#define FT_PERIOD (FT_PHASES + 1)   // and the time from one frame's start to the next
+
+typedef struct {
+    uint32_t phase[FT_PHASES] ; // usec
+    uint32_t total ;            // start to end of the frame
+    uint32_t period ;           // start to start, 0 for the first frame
+    uint32_t edges ;
+} ft_record ;
+
+typedef struct {
+    ft_record ring[FT_FRAMES] ;
+    uint32_t frames ;           // finished frames, the last is ring[(frames-1) % FT_FRAMES]
+    ft_record cur ;
+    uint32_t start, last ;      // time of the frame's start and of the last stamp
+    uint32_t prev_start ;
+} frame_timing ;
+
+typedef struct {
+    uint32_t min, avg, p99 ;
+} ft_summary ;
+
+extern const char *const ft_phase_names[FT_PHASES + 2] ;
+
+void ftInit(frame_timing *t) ;
+
+static inline void ftBeginFrame(frame_timing *t, uint32_t now) {
+    for (int p = 0; p < FT_PHASES; p++) t->cur.phase[p] = 0 ;
+    t->cur.period = t->frames ? now - t->prev_start : 0 ;
+    t->prev_start = t->start = t->last = now ;
+}
+
+// Charge the time since the last stamp to phase p
+static inline void ftMark(frame_timing *t, int p, uint32_t now) {
+    t->cur.phase[p] += now - t->last ;
+    t->last = now ;
+}
+
+void ftEndFrame(frame_timing *t, uint32_t now, uint32_t edges) ;
+
+// Frames held in the ring
+int ftCount(const frame_timing *t) ;
+// Summary of phase p (or FT_TOTAL, FT_PERIOD) over the frames in the ring.
+// Returns 0 if there are none.
+int ftSummarize(const frame_timing *t, int p, ft_summary *s) ;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
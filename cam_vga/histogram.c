@@ -0,0 +1,71 @@
+/**
+ * Streaming luma histogram, see histogram.h
+ */
+
+#include <string.h>
+#include "histogram.h"
+
+void histInit(histogram *h, uint8_t threshold) {
+    memset(h, 0, sizeof(*h)) ;
+    histSetThreshold(h, threshold) ;
+}
+
+void histSetThreshold(histogram *h, uint8_t threshold) {
+    h->threshold = threshold ;
+    for (int v = 0; v < HIST_BINS; v++) h->lut[v] = v <= threshold ;
+}
+
+int histOtsu(const uint32_t *bins) {
+    float total = 0, sum = 0 ;
+    for (int v = 0; v < HIST_BINS; v++) {
+        total += bins[v] ;
+        sum += (float)v * bins[v] ;
+    }
+    float w0 = 0, sum0 = 0, best = -1 ;
+    int first = 0, last = 0 ;
+    for (int v = 0; v < HIST_BINS - 1; v++) {
+        w0 += bins[v] ;
+        sum0 += (float)v * bins[v] ;
+        float w1 = total - w0 ;
+        if (w0 == 0 || w1 == 0) continue ;
+        // w0 w1 (m0 - m1)^2, up to a constant factor
+        float d = sum0 / w0 - (sum - sum0) / w1 ;
+        float between = w0 * w1 * d * d ;
+        if (between > best) {
+            best = between ;
+            first = last = v ;
+        }
+        // every split in an empty gap is as good, take the middle one
+        else if (between == best) last = v ;
+    }
+    return (first + last) / 2 ;
+}
+
+int histPercentile(const uint32_t *bins, int percent) {
+    uint32_t total = 0 ;
+    for (int v = 0; v < HIST_BINS; v++) total += bins[v] ;
+    uint32_t want = (uint64_t)total * percent / 100, seen = 0 ;
+    for (int v = 0; v < HIST_BINS; v++) {
+        seen += bins[v] ;
+        if (seen >= want) return v ;
+    }
+    return HIST_BINS - 1 ;
+}
+
+void histEndFrame(histogram *h) {
+    uint32_t pixels = 0 ;
+    uint64_t sum = 0 ;
+    memset(h->report, 0, sizeof(h->report)) ;
+    for (int v = 0; v < HIST_BINS; v++) {
+        pixels += h->bins[v] ;
+        sum += (uint64_t)v * h->bins[v] ;
+        h->report[v / (HIST_BINS / HIST_REPORT_BINS)] += h->bins[v] ;
+    }
+    h->pixels = pixels ;
+    h->mean = pixels ? sum / pixels : 0 ;
+    if (pixels) {
+        histSetThreshold(h, h->percentile == HIST_OTSU ? histOtsu(h->bins) : histPercentile(h->bins, h->percentile)) ;
+    }
+    memset(h->bins, 0, sizeof(h->bins)) ;
+    h->frames++ ;
+}
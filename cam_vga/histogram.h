@@ -0,0 +1,63 @@
+/**
+ * Streaming luma histogram and automatic threshold
+ *
+ * The 256 bin histogram of a frame is built while it is read out, one
+ * increment per pixel and no second pass. At the end of the frame a
+ * threshold is picked from it, by Otsu's method (the split that
+ * maximises the between-class variance) or as a percentile, and turned
+ * into a lookup table that binarises the next frame: lut[v] is 1 for
+ * v <= threshold.
+ *
+ * Memory: the histogram (1 KB), the table (256 bytes) and a 32 bin copy
+ * of the last frame's histogram to report while the next one builds.
+ *
+ * Plain C with no pico dependencies.
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HIST_BINS 256
+#define HIST_REPORT_BINS 32
+#define HIST_OTSU 0             // percentile setting that selects Otsu
+
+typedef struct {
+    uint32_t bins[HIST_BINS] ;  // frame in progress
+    uint8_t lut[HIST_BINS] ;    // binarisation for the next frame
+    uint8_t percentile ;        // HIST_OTSU, or 1-99 to put that % of pixels at or below
+    // last complete frame
+    uint8_t threshold ;
+    uint8_t mean ;
+    uint32_t pixels ;
+    uint32_t report[HIST_REPORT_BINS] ;
+    uint32_t frames ;
+} histogram ;
+
+void histInit(histogram *h, uint8_t threshold) ;
+// Set the threshold and rebuild the table
+void histSetThreshold(histogram *h, uint8_t threshold) ;
+
+static inline void histAdd(histogram *h, uint8_t v) {
+    h->bins[v]++ ;
+}
+
+// Threshold by Otsu's method: the v that gives the largest between-class
+// variance for the classes <= v and > v, centred in a gap of empty bins
+int histOtsu(const uint32_t *bins) ;
+// Smallest v with at least percent % of the pixels at or below it
+int histPercentile(const uint32_t *bins, int percent) ;
+
+// Pick the next threshold from the frame's histogram and start over
+void histEndFrame(histogram *h) ;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,44 @@
+/**
+ * Adaptive local threshold, see local_threshold.h
+ */
+
+#include <string.h>
+#include "local_threshold.h"
+
+void ltInit(local_threshold *t, uint8_t *ring, uint8_t window, uint8_t radius, uint8_t percent) {
+    memset(t, 0, sizeof(*t)) ;
+    t->ring = ring ;
+    t->window = window ? window : 1 ;
+    t->radius = radius ;
+    t->percent = percent ;
+    ltBeginFrame(t) ;
+}
+
+void ltBeginFrame(local_threshold *t) {
+    memset(t->ring, 0, t->window * LT_WIDTH) ;
+    memset(t->colsum, 0, sizeof(t->colsum)) ;
+    t->cur = 0 ;
+    t->filled = 0 ;
+}
+
+int ltRow(local_threshold *t, uint8_t *mask) {
+    const uint8_t *row = &t->ring[t->cur * LT_WIDTH] ;
+    int r = t->radius, set = 0 ;
+    if (t->filled < t->window) t->filled++ ;
+    uint32_t scale = 100 - t->percent ;
+    // window total over columns lo..hi, slid one column at a time
+    uint32_t sum = 0 ;
+    int lo = 0, hi = -1 ;
+    memset(mask, 0, LT_WIDTH / 8) ;
+    for (int x = 0; x < LT_WIDTH; x++) {
+        while (hi < x + r && hi < LT_WIDTH - 1) sum += t->colsum[++hi] ;
+        while (lo < x - r) sum -= t->colsum[lo++] ;
+        uint32_t count = (uint32_t)(hi - lo + 1) * t->filled ;
+        if (row[x] * count * 100 < sum * scale) {
+            mask[x >> 3] |= 1 << (x & 7) ;
+            set++ ;
+        }
+    }
+    if (++t->cur == t->window) t->cur = 0 ;
+    return set ;
+}
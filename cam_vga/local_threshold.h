@@ -0,0 +1,66 @@
+/**
+ * Adaptive local threshold
+ *
+ * Bradley style binarisation: a pixel is set when it is more than
+ * percent % darker than the mean of the window around it. The window is
+ * 2 * radius + 1 columns wide, centred on the pixel, and covers the
+ * pixel's row and the window - 1 rows read before it, so a row can be
+ * binarised as soon as it is complete without holding up the display.
+ *
+ * Instead of an integral image the window is kept as column sums: each
+ * pixel replaces the value of the same column window rows back in a ring
+ * of rows, and the column sum is corrected by the difference. At the end
+ * of the row one running sum across the column sums gives every pixel's
+ * window total.
+ *
+ * Memory: the ring (window * LT_WIDTH bytes, caller storage) and the
+ * column sums (2 * LT_WIDTH bytes). Cost per pixel is a load, a store and
+ * two adds while reading, and an add, a subtract, two multiplies and a
+ * compare at the end of the row.
+ *
+ * Plain C with no pico dependencies.
+ */
+
+#ifndef LOCAL_THRESHOLD_H
+#define LOCAL_THRESHOLD_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LT_WIDTH 640
+#define LT_MAX_WINDOW 255       // rows, column sums are 16 bits
+
+typedef struct {
+    uint8_t *ring ;             // window rows of LT_WIDTH pixels
+    uint16_t colsum[LT_WIDTH] ;
+    uint8_t window ;            // rows
+    uint8_t radius ;            // columns either side
+    uint8_t percent ;           // how much darker than the mean
+    uint8_t cur ;               // ring row being read
+    uint8_t filled ;            // rows in the window so far
+} local_threshold ;
+
+void ltInit(local_threshold *t, uint8_t *ring, uint8_t window, uint8_t radius, uint8_t percent) ;
+// Empty the window, rows of the last frame don't count
+void ltBeginFrame(local_threshold *t) ;
+
+// Add pixel x of the row being read
+static inline void ltPixel(local_threshold *t, int x, uint8_t luma) {
+    uint8_t *old = &t->ring[t->cur * LT_WIDTH + x] ;
+    t->colsum[x] += luma - *old ;
+    *old = luma ;
+}
+
+// Binarise the row just read into mask (bit x & 7 of byte x >> 3, the
+// whole row is written) and move the window down. Returns the number of
+// pixels set.
+int ltRow(local_threshold *t, uint8_t *mask) ;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
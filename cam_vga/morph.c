@@ -0,0 +1,138 @@
+/**
+ * Bit-parallel binary morphology, see morph.h
+ */
+
+#include <string.h>
+#include "morph.h"
+
+// ==================================================
+// === Row operations
+// ==================================================
+
+// Pixel x-1 at bit x, pad coming in at x = 0
+static inline uint32_t fromLeft(const uint32_t *r, int w, uint32_t pad) {
+    return (r[w] << 1) | (w ? r[w - 1] >> 31 : pad & 1) ;
+}
+
+// Pixel x+1 at bit x, pad coming in at the last pixel
+static inline uint32_t fromRight(const uint32_t *r, int w, uint32_t pad) {
+    return (r[w] >> 1) | (w < MORPH_WORDS - 1 ? r[w + 1] << 31 : pad << 31) ;
+}
+
+static void morphRows(const uint32_t *a, const uint32_t *c, const uint32_t *b, uint32_t *out,
+                      uint8_t shape, uint8_t dilate) {
+    uint32_t pad = dilate ? 0 : 0xffffffff ;
+    for (int w = 0; w < MORPH_WORDS; w++) {
+        uint32_t v ;
+        if (dilate) {
+            uint32_t h = c[w] | fromLeft(c, w, pad) | fromRight(c, w, pad) ;
+            switch (shape) {
+                case MORPH_SQUARE:
+                    v = h | a[w] | fromLeft(a, w, pad) | fromRight(a, w, pad)
+                          | b[w] | fromLeft(b, w, pad) | fromRight(b, w, pad) ;
+                    break ;
+                case MORPH_CROSS: v = h | a[w] | b[w] ; break ;
+                case MORPH_HLINE: v = h ; break ;
+                default: v = a[w] | c[w] | b[w] ; break ;
+            }
+        }
+        else {
+            uint32_t h = c[w] & fromLeft(c, w, pad) & fromRight(c, w, pad) ;
+            switch (shape) {
+                case MORPH_SQUARE:
+                    v = h & a[w] & fromLeft(a, w, pad) & fromRight(a, w, pad)
+                          & b[w] & fromLeft(b, w, pad) & fromRight(b, w, pad) ;
+                    break ;
+                case MORPH_CROSS: v = h & a[w] & b[w] ; break ;
+                case MORPH_HLINE: v = h ; break ;
+                default: v = a[w] & c[w] & b[w] ; break ;
+            }
+        }
+        out[w] = v ;
+    }
+}
+
+// ==================================================
+// === Stages
+// ==================================================
+
+static const uint32_t *morphPad(uint8_t dilate) {
+    static const uint32_t clear[MORPH_WORDS] ;
+    static uint32_t set[MORPH_WORDS] ;
+    if (!set[0]) memset(set, 0xff, sizeof(set)) ;
+    return dilate ? clear : set ;
+}
+
+// Push a row into a stage. Returns 1 if the stage output its current row.
+static int stagePush(morph_stage *s, uint8_t shape, const uint32_t *row, short y) {
+    int done = s->have ;
+    if (done) {
+        morphRows(s->above, s->cur, row, s->out, shape, s->dilate) ;
+        s->out_y = s->y ;
+        memcpy(s->above, s->cur, sizeof(s->cur)) ;
+    }
+    else memcpy(s->above, morphPad(s->dilate), sizeof(s->above)) ;
+    memcpy(s->cur, row, sizeof(s->cur)) ;
+    s->y = y ;
+    s->have = 1 ;
+    return done ;
+}
+
+// Output the stage's last row, with padding below it
+static int stageFlush(morph_stage *s, uint8_t shape) {
+    if (!s->have) return 0 ;
+    morphRows(s->above, s->cur, morphPad(s->dilate), s->out, shape, s->dilate) ;
+    s->out_y = s->y ;
+    s->have = 0 ;
+    return 1 ;
+}
+
+// ==================================================
+// === Chain
+// ==================================================
+
+void morphInit(morph_filter *m, uint8_t op, uint8_t shape, uint8_t iterations) {
+    memset(m, 0, sizeof(*m)) ;
+    if (op >= MORPH_OPS) op = MORPH_OFF ;
+    if (shape >= MORPH_SHAPES) shape = MORPH_SQUARE ;
+    if (iterations < 1) iterations = 1 ;
+    if (iterations > MORPH_MAX_ITERATIONS) iterations = MORPH_MAX_ITERATIONS ;
+    m->op = op ;
+    m->shape = shape ;
+    m->iterations = iterations ;
+    for (int i = 0; op != MORPH_OFF && i < iterations; i++) {
+        m->stages[m->n_stages++].dilate = op == MORPH_DILATE || op == MORPH_CLOSE ;
+    }
+    for (int i = 0; (op == MORPH_OPEN || op == MORPH_CLOSE) && i < iterations; i++) {
+        m->stages[m->n_stages++].dilate = op == MORPH_OPEN ;
+    }
+}
+
+void morphBeginFrame(morph_filter *m) {
+    for (int i = 0; i < m->n_stages; i++) m->stages[i].have = 0 ;
+}
+
+// Push a row through stages from.. to the end
+static int morphPropagate(morph_filter *m, int from, const uint32_t *row, short y) {
+    for (int i = from; i < m->n_stages; i++) {
+        morph_stage *s = &m->stages[i] ;
+        if (!stagePush(s, m->shape, row, y)) return 0 ;
+        row = s->out ;
+        y = s->out_y ;
+    }
+    memcpy(m->out, row, sizeof(m->out)) ;
+    m->out_y = y ;
+    return 1 ;
+}
+
+int morphRow(morph_filter *m, short y, const uint32_t *row) {
+    return morphPropagate(m, 0, row, y) ;
+}
+
+int morphFlush(morph_filter *m) {
+    for (int i = 0; i < m->n_stages; i++) {
+        morph_stage *s = &m->stages[i] ;
+        if (stageFlush(s, m->shape) && morphPropagate(m, i + 1, s->out, s->out_y)) return 1 ;
+    }
+    return 0 ;
+}
@@ -0,0 +1,85 @@
+/**
+ * Bit-parallel binary morphology on streamed rows
+ *
+ * Rows are 1 bit per pixel, pixel x in bit x & 31 of 32 bit word x >> 5
+ * (the byte layout of the row masks, read as little endian words), so
+ * every operation handles 32 pixels at once: horizontal neighbours come
+ * from shifting the row one bit either way, carrying across words, and
+ * vertical neighbours from the rows above and below.
+ *
+ * An operation is a chain of erode or dilate stages with a 3x3 (or
+ * smaller) structuring element. Each stage keeps the row above and the
+ * row it is working on, and outputs that row once the row below comes
+ * in, so every stage delays the stream by one row; the last rows come out
+ * of morphFlush at the end of the frame. Outside the image counts as set
+ * for erosion and clear for dilation, so borders neither erode nor grow.
+ *
+ * Memory: 3 rows (240 bytes) per stage. Cost per 32 pixels and stage is
+ * about 10 logic operations and shifts.
+ *
+ * Plain C with no pico dependencies.
+ */
+
+#ifndef MORPH_H
+#define MORPH_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MORPH_WIDTH 640
+#define MORPH_WORDS (MORPH_WIDTH / 32)
+#define MORPH_MAX_ITERATIONS 3
+#define MORPH_MAX_STAGES (2 * MORPH_MAX_ITERATIONS)
+
+// Operations
+#define MORPH_OFF 0
+#define MORPH_ERODE 1
+#define MORPH_DILATE 2
+#define MORPH_OPEN 3            // erode then dilate, removes specks
+#define MORPH_CLOSE 4           // dilate then erode, fills pinholes
+#define MORPH_OPS 5
+
+// Structuring elements
+#define MORPH_SQUARE 0          // 3x3
+#define MORPH_CROSS 1           // centre and its 4 neighbours
+#define MORPH_HLINE 2           // 3x1
+#define MORPH_VLINE 3           // 1x3
+#define MORPH_SHAPES 4
+
+typedef struct {
+    uint8_t dilate ;
+    uint8_t have ;              // cur holds a row
+    short y ;                   // row in cur
+    short out_y ;               // row in out
+    uint32_t above[MORPH_WORDS] ;
+    uint32_t cur[MORPH_WORDS] ;
+    uint32_t out[MORPH_WORDS] ;
+} morph_stage ;
+
+typedef struct {
+    uint8_t op, shape, iterations ;
+    int n_stages ;
+    morph_stage stages[MORPH_MAX_STAGES] ;
+    // row output by the last morphRow or morphFlush that returned 1
+    uint32_t out[MORPH_WORDS] ;
+    short out_y ;
+} morph_filter ;
+
+// Set up op applied iterations times (erode/dilate) or with iterations
+// erosions and dilations (open/close), with the given shape
+void morphInit(morph_filter *m, uint8_t op, uint8_t shape, uint8_t iterations) ;
+void morphBeginFrame(morph_filter *m) ;
+// Feed row y, in order (either direction). Returns 1 if a row came out,
+// in m->out and m->out_y. With no stages every row comes straight out.
+int morphRow(morph_filter *m, short y, const uint32_t *row) ;
+// After the last row: returns 1 for each row still in the chain
+int morphFlush(morph_filter *m) ;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
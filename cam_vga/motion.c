@@ -0,0 +1,89 @@
+/**
+ * Motion detection, see motion.h
+ */
+
+#include <string.h>
+#include "motion.h"
+
+void motionInit(motion_detector *m, uint8_t threshold, uint8_t min_blocks, uint8_t hold) {
+    memset(m, 0, sizeof(*m)) ;
+    m->threshold = threshold ;
+    m->min_blocks = min_blocks ;
+    m->hold = hold ;
+}
+
+void motionReset(motion_detector *m) {
+    memset(m->acc, 0, sizeof(m->acc)) ;
+    memset(m->sad, 0, sizeof(m->sad)) ;
+    m->rows = 0 ;
+    m->filled = 0 ;
+    m->ref_valid = 0 ;
+}
+
+void motionRow(motion_detector *m, short y) {
+    if (++m->rows < MOTION_SCALE) return ;
+    m->rows = 0 ;
+    int ty = y >> MOTION_SCALE_SHIFT ;
+    if (ty < 0 || ty >= MOTION_THUMB_H) return ;
+    uint8_t *ref = m->thumb[ty] ;
+    uint16_t *sad = m->sad[ty / MOTION_BLOCK] ;
+    for (int tx = 0; tx < MOTION_THUMB_W; tx++) {
+        int v = m->acc[tx] >> (2 * MOTION_SCALE_SHIFT) ;
+        int d = v - ref[tx] ;
+        sad[tx / MOTION_BLOCK] += d < 0 ? -d : d ;
+        ref[tx] = v ;
+        m->acc[tx] = 0 ;
+    }
+    m->filled++ ;
+}
+
+int motionEndFrame(motion_detector *m) {
+    int started = 0 ;
+    int compare = m->ref_valid ;
+    m->ref_valid = m->filled >= MOTION_THUMB_H ;
+    m->frames++ ;
+
+    m->n_moving = 0 ;
+    m->max_sad = 0 ;
+    m->x0 = m->y0 = 0x7fff ;
+    m->x1 = m->y1 = -1 ;
+    for (int by = 0; by < MOTION_GRID_H; by++) {
+        int bh = MOTION_THUMB_H - by * MOTION_BLOCK ;
+        if (bh > MOTION_BLOCK) bh = MOTION_BLOCK ;
+        m->moving[by] = 0 ;
+        for (int bx = 0; compare && bx < MOTION_GRID_W; bx++) {
+            int bw = MOTION_THUMB_W - bx * MOTION_BLOCK ;
+            if (bw > MOTION_BLOCK) bw = MOTION_BLOCK ;
+            uint32_t sad = m->sad[by][bx] ;
+            if (sad > m->max_sad) m->max_sad = sad ;
+            if (sad <= (uint32_t)m->threshold * bw * bh) continue ;
+            m->moving[by] |= 1u << bx ;
+            m->n_moving++ ;
+            short x = bx * MOTION_BLOCK * MOTION_SCALE, y = by * MOTION_BLOCK * MOTION_SCALE ;
+            if (x < m->x0) m->x0 = x ;
+            if (y < m->y0) m->y0 = y ;
+            if (x + bw * MOTION_SCALE - 1 > m->x1) m->x1 = x + bw * MOTION_SCALE - 1 ;
+            if (y + bh * MOTION_SCALE - 1 > m->y1) m->y1 = y + bh * MOTION_SCALE - 1 ;
+        }
+    }
+
+    if (compare && m->n_moving >= m->min_blocks) {
+        m->still_frames = 0 ;
+        if (!m->active) {
+            m->active = 1 ;
+            m->events++ ;
+            m->last_event = m->frames ;
+            started = 1 ;
+        }
+    }
+    else {
+        m->still_frames++ ;
+        if (m->active && m->still_frames >= m->hold) m->active = 0 ;
+    }
+
+    memset(m->sad, 0, sizeof(m->sad)) ;
+    memset(m->acc, 0, sizeof(m->acc)) ;
+    m->rows = 0 ;
+    m->filled = 0 ;
+    return started ;
+}
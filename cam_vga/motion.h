@@ -0,0 +1,95 @@
+/**
+ * Motion detection on a downsampled reference frame
+ *
+ * Each frame is reduced to a MOTION_THUMB_W x MOTION_THUMB_H luma
+ * thumbnail (80x60 by default, set MOTION_SCALE_SHIFT to change it) by
+ * box averaging MOTION_SCALE x MOTION_SCALE pixels while it is read out, so
+ * no full frame is ever stored: pixels are summed into one row of
+ * accumulators, and every MOTION_SCALE rows that row of the thumbnail is
+ * finished, compared against the same row of the previous frame's
+ * thumbnail and written over it. The absolute differences are summed per
+ * block of MOTION_BLOCK x MOTION_BLOCK thumbnail pixels (SAD), and a
+ * block whose mean difference is above the threshold is moving.
+ *
+ * A frame with at least min_blocks moving blocks is a motion frame. The
+ * detector turns on at the first motion frame (one event) and off after
+ * hold still frames in a row.
+ *
+ * Memory: the thumbnail (MOTION_THUMB_W * MOTION_THUMB_H bytes), one row
+ * of 16 bit accumulators and the block SADs, 5.6 KB at the default
+ * 80x60. Cost per pixel is one add into the accumulator row, plus one
+ * subtract per thumbnail pixel (1/64 of the pixels) at the end of its
+ * last row.
+ *
+ * Plain C with no pico dependencies.
+ */
+
+#ifndef MOTION_H
+#define MOTION_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MOTION_SCALE_SHIFT
+#define MOTION_SCALE_SHIFT 3        // 8x8 pixels per thumbnail pixel
+#endif
+#ifndef MOTION_BLOCK
+#define MOTION_BLOCK 4              // thumbnail pixels per block side
+#endif
+#define MOTION_SCALE (1 << MOTION_SCALE_SHIFT)
+#define MOTION_THUMB_W (640 >> MOTION_SCALE_SHIFT)
+#define MOTION_THUMB_H (480 >> MOTION_SCALE_SHIFT)
+#define MOTION_GRID_W ((MOTION_THUMB_W + MOTION_BLOCK - 1) / MOTION_BLOCK)
+#define MOTION_GRID_H ((MOTION_THUMB_H + MOTION_BLOCK - 1) / MOTION_BLOCK)
+#if MOTION_GRID_W > 32
+#error "moving blocks of a grid row must fit in 32 bits"
+#endif
+
+typedef struct {
+    // settings
+    uint8_t threshold ;         // mean absolute difference per thumbnail pixel
+    uint8_t min_blocks ;        // moving blocks that make a motion frame
+    uint8_t hold ;              // still frames before motion ends
+    // frame in progress
+    uint16_t acc[MOTION_THUMB_W] ;
+    uint8_t rows ;              // screen rows summed into acc
+    uint8_t ref_valid ;         // thumb holds a whole previous frame
+    uint8_t filled ;            // thumbnail rows written this frame
+    uint16_t sad[MOTION_GRID_H][MOTION_GRID_W] ;
+    uint8_t thumb[MOTION_THUMB_H][MOTION_THUMB_W] ;
+    // result of the last complete frame
+    uint32_t moving[MOTION_GRID_H] ;    // bit bx set for a moving block
+    int n_moving ;
+    short x0, y0, x1, y1 ;      // screen box around the moving blocks
+    uint32_t max_sad ;
+    // state
+    uint8_t active ;            // motion in progress
+    uint32_t still_frames ;     // frames in a row without motion
+    uint32_t frames ;
+    uint32_t events ;           // times motion started
+    uint32_t last_event ;       // frame of the last start
+} motion_detector ;
+
+void motionInit(motion_detector *m, uint8_t threshold, uint8_t min_blocks, uint8_t hold) ;
+// Forget the reference, the next frame only rebuilds it
+void motionReset(motion_detector *m) ;
+
+// Add one pixel of the current row, x in screen coordinates
+static inline void motionPixel(motion_detector *m, int x, uint8_t luma) {
+    m->acc[x >> MOTION_SCALE_SHIFT] += luma ;
+}
+
+// Call after the last pixel of each screen row. Rows come in order, in
+// either direction.
+void motionRow(motion_detector *m, short y) ;
+// Classify the blocks of the frame. Returns 1 if motion started.
+int motionEndFrame(motion_detector *m) ;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,142 @@
+/**
+ * Overlay plane for the VGA display, see overlay.h
+ */
+
+#include <string.h>
+#include "vga_graphics.h"
+#include "overlay.h"
+
+typedef struct {
+    short x, y, w, h ;
+    unsigned char *mask ;
+    short stride ;
+    char color ;
+    char visible ;
+    char used ;
+} overlay_region ;
+
+static overlay_region overlay_regions[OVERLAY_MAX_REGIONS] ;
+
+// Rows covered by any visible region, so rows without overlay return early
+static short overlay_top = 0, overlay_bottom = -1 ;
+
+static void overlayUpdateBounds(void) {
+    overlay_top = 0x7fff ;
+    overlay_bottom = -1 ;
+    for (int i = 0; i < OVERLAY_MAX_REGIONS; i++) {
+        overlay_region *r = &overlay_regions[i] ;
+        if (!r->used || !r->visible) continue ;
+        if (r->y < overlay_top) overlay_top = r->y ;
+        if (r->y + r->h - 1 > overlay_bottom) overlay_bottom = r->y + r->h - 1 ;
+    }
+}
+
+// Force the rows under a region to be rewritten (and so re-composited) on
+// the next frame, even if the camera image there has not changed
+static void overlayInvalidate(overlay_region *r) {
+    markDirtyRows(r->y, r->y + r->h - 1) ;
+}
+
+static int overlayValid(int id) {
+    return (id >= 0) && (id < OVERLAY_MAX_REGIONS) && overlay_regions[id].used ;
+}
+
+int overlayAdd(short x, short y, short w, short h, unsigned char *mask, short stride, char color) {
+    for (int i = 0; i < OVERLAY_MAX_REGIONS; i++) {
+        overlay_region *r = &overlay_regions[i] ;
+        if (r->used) continue ;
+        r->x = x ;
+        r->y = y ;
+        r->w = w ;
+        r->h = h ;
+        r->mask = mask ;
+        r->stride = stride ;
+        r->color = color ;
+        r->visible = 1 ;
+        r->used = 1 ;
+        overlayInvalidate(r) ;
+        overlayUpdateBounds() ;
+        return i ;
+    }
+    return -1 ;
+}
+
+void overlayRemove(int id) {
+    if (!overlayValid(id)) return ;
+    overlayInvalidate(&overlay_regions[id]) ;
+    overlay_regions[id].used = 0 ;
+    overlayUpdateBounds() ;
+}
+
+void overlayMove(int id, short x, short y) {
+    if (!overlayValid(id)) return ;
+    overlayInvalidate(&overlay_regions[id]) ;
+    overlay_regions[id].x = x ;
+    overlay_regions[id].y = y ;
+    overlayInvalidate(&overlay_regions[id]) ;
+    overlayUpdateBounds() ;
+}
+
+void overlaySetColor(int id, char color) {
+    if (!overlayValid(id)) return ;
+    overlay_regions[id].color = color ;
+    overlayInvalidate(&overlay_regions[id]) ;
+}
+
+void overlaySetVisible(int id, char visible) {
+    if (!overlayValid(id)) return ;
+    overlay_regions[id].visible = visible ;
+    overlayInvalidate(&overlay_regions[id]) ;
+    overlayUpdateBounds() ;
+}
+
+void overlayClear(int id) {
+    if (!overlayValid(id)) return ;
+    overlay_region *r = &overlay_regions[id] ;
+    memset(r->mask, 0, r->h * r->stride) ;
+    overlayInvalidate(r) ;
+}
+
+void overlayDrawString(int id, short x, short y, const char *str) {
+/* Render text into a region's mask with the 5x7 font (6x8 cells)
+ * Parameters:
+ *      id:     region to draw into
+ *      x, y:   top-left of the first character, relative to the region
+ *      str:    text to draw, stops at the region's right edge
+ */
+    if (!overlayValid(id)) return ;
+    overlay_region *r = &overlay_regions[id] ;
+    overlayInvalidate(r) ;
+    for (; *str && (x + 6 <= r->w); str++, x += 6) {
+        const unsigned char *glyph = fontGlyph((unsigned char)*str) ;
+        for (int i = 0; i < 6; i++) {
+            unsigned char line = (i == 5) ? 0 : glyph[i] ;
+            int col = x + i ;
+            if (col < 0) continue ;
+            for (int j = 0; j < 8; j++, line >>= 1) {
+                int row = y + j ;
+                if ((row < 0) || (row >= r->h)) continue ;
+                unsigned char *byte = &r->mask[(row * r->stride) + (col >> 3)] ;
+                unsigned char bit = 0x80 >> (col & 7) ;
+                if (line & 1) *byte |= bit ;
+                else *byte &= ~bit ;
+            }
+        }
+    }
+}
+
+void overlayCompositeRows(short y0, short y1) {
+    if (y0 < overlay_top) y0 = overlay_top ;
+    if (y1 > overlay_bottom) y1 = overlay_bottom ;
+    if (y0 > y1) return ;
+    for (int i = 0; i < OVERLAY_MAX_REGIONS; i++) {
+        overlay_region *r = &overlay_regions[i] ;
+        if (!r->used || !r->visible) continue ;
+        short top = (y0 > r->y) ? y0 : r->y ;
+        short bottom = (y1 < r->y + r->h - 1) ? y1 : r->y + r->h - 1 ;
+        if (top > bottom) continue ;
+        // Transparent background: only set bits touch the screen
+        blitMask(r->x, top, r->w, bottom - top + 1,
+                 &r->mask[(top - r->y) * r->stride], r->stride, r->color, r->color) ;
+    }
+}
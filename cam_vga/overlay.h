@@ -0,0 +1,34 @@
+/**
+ * Overlay plane for the VGA display
+ *
+ * A small set of 1 bit per pixel rectangular regions drawn on top of the
+ * camera image. Set bits are drawn in the region's color and clear bits
+ * are transparent. Regions are composited into vga_data_array one row at
+ * a time, right after the camera pipeline has written that row, so the
+ * HUD survives every new frame without being redrawn and the cost depends
+ * only on the size of the overlay.
+ *
+ * Masks are owned by the caller, most significant bit is leftmost.
+ */
+
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#define OVERLAY_MAX_REGIONS 8
+
+// Add a region. Returns its id, or -1 if all regions are in use
+int overlayAdd(short x, short y, short w, short h, unsigned char *mask, short stride, char color) ;
+void overlayRemove(int id) ;
+void overlayMove(int id, short x, short y) ;
+void overlaySetColor(int id, char color) ;
+void overlaySetVisible(int id, char visible) ;
+
+// Edit a region's mask
+void overlayClear(int id) ;
+void overlayDrawString(int id, short x, short y, const char *str) ;
+
+// Composite every visible region that covers screen rows y0..y1 (inclusive)
+void overlayCompositeRows(short y0, short y1) ;
+#define overlayCompositeRow(y) overlayCompositeRows((y), (y))
+
+#endif
@@ -0,0 +1,333 @@
+/**
+ * Compile-time pixel pipelines
+ *
+ * Each display mode is a list of stages (taps, conversion, threshold,
+ * edge and sink) composed by the pipe template into one fused row
+ * kernel: the stages' per-pixel code is inlined into a single loop with
+ * no mode branches and no volatile loads, and the mode's settings are
+ * copied into a context once per frame. The camera thread picks the
+ * kernel for the current mode at the start of every frame and calls it
+ * once per row read from the FIFO.
+ *
+ * A stage is a struct with static begin_row, pixel and end_row members
+ * (derive from stage for empty defaults). Pixels come right to left in
+ * screen coordinates, which is the order the sensor sends them, in pairs:
+ * pixel<1> for the odd x of a byte of the packed row and pixel<0> for the
+ * even x that completes it.
+ *
+ * Header only and free of pico dependencies, so the host can build and
+ * time the same kernels.
+ */
+
+#ifndef PIXEL_PIPELINE_HPP
+#define PIXEL_PIPELINE_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+extern "C" {
+#include "histogram.h"
+#include "motion.h"
+#include "background.h"
+#include "local_threshold.h"
+}
+
+namespace pipeline {
+
+const int WIDTH = 640 ;
+const uint8_t PIX_BLACK = 0 ;
+const uint8_t PIX_WHITE = 7 ;
+
+// One pixel on its way through the stages
+struct sample {
+    uint8_t raw ;               // FIFO byte, also used as luma
+    uint8_t color ;             // display color
+    uint8_t white ;             // set in the binary image
+} ;
+
+// Everything a kernel reads or writes, filled in at the start of a frame
+struct context {
+    short y ;                   // row being processed
+    uint8_t odd ;               // odd pixel waiting for its even partner
+    uint8_t *row ;              // packed output row, 2 pixels per byte
+    uint8_t *mask ;             // binary row, bit x & 7 of byte x >> 3
+    const uint8_t *lut ;        // threshold_lut table
+    histogram *hist ;
+    motion_detector *motion ;
+    bg_model *background ;
+    local_threshold *local ;
+    // edge_simple and lookback
+    short *edge_x, *edge_y ;
+    int max_edges ;
+    int num_edges ;
+    int consecutive ;           // dark pixels in a run, carried across rows
+    int threshold ;
+    int dither ;                // lookback: pixels of a run per saved edge
+} ;
+
+// Display color of each FIFO byte, worked out with the bit shifts the
+// camera loop used per pixel (values above 7 spill into the odd pixel of
+// a byte). A template so the header can define the table.
+template <int Unused = 0> struct tables {
+    static uint8_t color_of[256] ;
+} ;
+template <int Unused> uint8_t tables<Unused>::color_of[256] ;
+
+inline void initTables() {
+    for (int v = 0; v < 256; v++) {
+        uint8_t red = (int)(v>>6)>>1 ;
+        uint8_t green = (int)((v-(red<<6))>>4)>>1 ;
+        uint8_t blue = (int)((v>>2)%4)>>1 ;
+        tables<>::color_of[v] = (red<<2)+(green<<1)+blue ;
+    }
+}
+
+// Packed row bytes: the odd pixel takes bits 3-5, the even pixel is
+// written over what is left
+template <int Odd>
+static inline void storePixel(context &c, int x, uint8_t color) {
+    if (Odd) c.odd = color ;
+    else c.row[x >> 1] = ((c.odd << 3) & 0x38) | color ;
+}
+
+// Fill the packed row from the mask, set bits white
+inline void maskToRow(context &c) {
+    for (int x = 0; x < WIDTH; x += 2) {
+        uint8_t bits = c.mask[x >> 3] >> (x & 7) ;
+        c.row[x >> 1] = ((bits & 1) ? PIX_WHITE : PIX_BLACK) | (((bits & 2) ? PIX_WHITE : PIX_BLACK) << 3) ;
+    }
+}
+
+// ==================================================
+// === Stages
+// ==================================================
+
+struct stage {
+    static inline void begin_row(context &, short) {}
+    template <int Odd> static inline void pixel(context &, int, sample &) {}
+    static inline void end_row(context &, short) {}
+} ;
+
+// Taps: look at the raw pixel and pass it on
+
+struct tap_histogram : stage {
+    template <int Odd> static inline void pixel(context &c, int, sample &s) {
+        histAdd(c.hist, s.raw) ;
+    }
+} ;
+
+struct tap_motion : stage {
+    template <int Odd> static inline void pixel(context &c, int x, sample &s) {
+        motionPixel(c.motion, x, s.raw) ;
+    }
+    static inline void end_row(context &c, short y) {
+        motionRow(c.motion, y) ;
+    }
+} ;
+
+// Conversion
+
+struct decode_color : stage {
+    template <int Odd> static inline void pixel(context &, int, sample &s) {
+        s.color = tables<>::color_of[s.raw] ;
+    }
+} ;
+
+// Thresholds: decide which pixels are white
+
+// All color bits 0
+struct threshold_dark : stage {
+    template <int Odd> static inline void pixel(context &, int, sample &s) {
+        s.white = tables<>::color_of[s.raw] == 0 ;
+    }
+} ;
+
+// Table picked from the last frame's histogram
+struct threshold_lut : stage {
+    template <int Odd> static inline void pixel(context &c, int, sample &s) {
+        s.white = c.lut[s.raw] ;
+    }
+} ;
+
+// Differs from the learned background
+struct threshold_background : stage {
+    static inline void begin_row(context &c, short y) {
+        bgBeginRow(c.background, y) ;
+    }
+    template <int Odd> static inline void pixel(context &c, int x, sample &s) {
+        s.white = bgPixel(c.background, x, s.raw) ;
+    }
+    static inline void end_row(context &c, short y) {
+        bgEndRow(c.background, y) ;
+    }
+} ;
+
+// Darker than the pixels around it. Decided for the whole row at its
+// end, so it writes the mask and the packed row itself.
+struct threshold_local : stage {
+    template <int Odd> static inline void pixel(context &c, int x, sample &s) {
+        ltPixel(c.local, x, s.raw) ;
+    }
+    static inline void end_row(context &c, short) {
+        ltRow(c.local, c.mask) ;
+        maskToRow(c) ;
+    }
+} ;
+
+// Edges
+
+// Simple edge detection: save the pixel that makes a run of dark pixels
+// (in sensor order) reach the threshold
+struct edge_simple : stage {
+    template <int Odd> static inline void pixel(context &c, int x, sample &s) {
+        if (s.white) {
+            if (c.consecutive == c.threshold) {
+                c.edge_x[c.num_edges] = x + 1 ;
+                c.edge_y[c.num_edges] = c.y + 1 ;
+                if (++c.num_edges >= c.max_edges) c.num_edges = 0 ;
+            }
+            if (++c.consecutive >= 9999) c.consecutive = 0 ;
+        }
+        else c.consecutive = 0 ;
+    }
+} ;
+
+// Sinks: write the row
+
+struct sink_color : stage {
+    template <int Odd> static inline void pixel(context &c, int x, sample &s) {
+        storePixel<Odd>(c, x, s.color) ;
+    }
+} ;
+
+// White/black on screen and the mask, for blobs and morphology
+struct sink_binary : stage {
+    static inline void begin_row(context &c, short) {
+        memset(c.mask, 0, WIDTH / 8) ;
+    }
+    template <int Odd> static inline void pixel(context &c, int x, sample &s) {
+        storePixel<Odd>(c, x, s.white ? PIX_WHITE : PIX_BLACK) ;
+        c.mask[x >> 3] |= s.white << (x & 7) ;
+    }
+} ;
+
+// The mask only, for the lookback edge detector
+struct sink_mask : stage {
+    static inline void begin_row(context &c, short) {
+        memset(c.mask, 0, WIDTH / 8) ;
+    }
+    template <int Odd> static inline void pixel(context &c, int x, sample &s) {
+        c.mask[x >> 3] |= s.white << (x & 7) ;
+    }
+} ;
+
+// ==================================================
+// === Lookback edges
+// ==================================================
+
+// Lookback edge detection runs on whole rows of the dark pixel mask: a
+// pixel of the middle of the last three rows is an edge when more than
+// threshold of its 8 neighbours are dark, and at most one edge is saved
+// every dither pixels of a run. Rows are kept and edges saved in sensor
+// column order (x = 639 - column), as the camera loop always did.
+struct lookback {
+    uint8_t rows[3][WIDTH] ;    // used in turn, the newest is rows[fed % 3]
+    int fed ;                   // rows fed this frame
+} ;
+
+inline void lookbackBeginFrame(lookback &l) {
+    l.fed = 0 ;
+}
+
+// Feed the mask of screen row y, rows coming bottom up. Once three rows
+// are in, the middle one (y + 1) is searched for edges.
+inline void lookbackRow(lookback &l, context &c, const uint8_t *mask, short y) {
+    uint8_t *in = l.rows[l.fed % 3] ;
+    for (int j = 0; j < WIDTH; j++) {
+        int x = WIDTH - 1 - j ;
+        in[j] = (mask[x >> 3] >> (x & 7)) & 1 ;
+    }
+    if (++l.fed < 3) return ;
+    const uint8_t *a = l.rows[(l.fed - 3) % 3] ;
+    const uint8_t *m = l.rows[(l.fed - 2) % 3] ;
+    const uint8_t *b = in ;
+    int since = 0 ;
+    for (int j = 1; j < WIDTH - 1; j++) {
+        int n = a[j-1] + a[j] + a[j+1] + m[j-1] + m[j+1] + b[j-1] + b[j] + b[j+1] ;
+        if (n <= c.threshold) {
+            since = 0 ;
+            continue ;
+        }
+        if (since == 0) {
+            c.edge_x[c.num_edges] = j ;
+            c.edge_y[c.num_edges] = y + 1 ;
+            if (++c.num_edges >= c.max_edges) c.num_edges = 0 ;
+            since = 1 ;
+        }
+        else if (++since >= c.dither) since = 0 ;
+    }
+}
+
+// ==================================================
+// === Composition
+// ==================================================
+
+template <class... S> struct stages ;
+
+template <> struct stages<> {
+    static inline void begin_row(context &, short) {}
+    template <int Odd> static inline void pixel(context &, int, sample &) {}
+    static inline void end_row(context &, short) {}
+} ;
+
+template <class S, class... Rest> struct stages<S, Rest...> {
+    static inline void begin_row(context &c, short y) {
+        S::begin_row(c, y) ;
+        stages<Rest...>::begin_row(c, y) ;
+    }
+    template <int Odd> static inline void pixel(context &c, int x, sample &s) {
+        S::template pixel<Odd>(c, x, s) ;
+        stages<Rest...>::template pixel<Odd>(c, x, s) ;
+    }
+    static inline void end_row(context &c, short y) {
+        S::end_row(c, y) ;
+        stages<Rest...>::end_row(c, y) ;
+    }
+} ;
+
+typedef void (*row_kernel)(context &c, short y, const uint8_t *raw) ;
+
+// The fused kernel: raw holds one row of FIFO bytes in sensor order
+template <class... S> struct pipe {
+    static void row(context &c, short y, const uint8_t *raw) {
+        c.y = y ;
+        stages<S...>::begin_row(c, y) ;
+        for (int j = 0; j < WIDTH; j += 2) {
+            int x = WIDTH - 1 - j ;
+            sample a = { raw[j], 0, 0 } ;
+            stages<S...>::template pixel<1>(c, x, a) ;
+            sample b = { raw[j + 1], 0, 0 } ;
+            stages<S...>::template pixel<0>(c, x - 1, b) ;
+        }
+        stages<S...>::end_row(c, y) ;
+    }
+} ;
+
+// ==================================================
+// === Modes
+// ==================================================
+
+// Kernels of every display mode, with Motion either tap_motion or stage
+template <class Motion> struct modes {
+    typedef pipe<tap_histogram, Motion, decode_color, sink_color> color ;
+    typedef pipe<tap_histogram, Motion, threshold_dark, sink_binary> bw_dark ;
+    typedef pipe<tap_histogram, Motion, threshold_background, sink_binary> bw_background ;
+    typedef pipe<tap_histogram, Motion, threshold_lut, sink_binary> bw_auto ;
+    typedef pipe<tap_histogram, Motion, threshold_local> bw_local ;
+} ;
+typedef pipe<threshold_dark, edge_simple> edge_simple_mode ;
+typedef pipe<threshold_dark, sink_mask> edge_lookback_mode ;
+
+}
+
+#endif
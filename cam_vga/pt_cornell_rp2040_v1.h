@@ -542,11 +542,19 @@ struct pt_sem {
 //=====================================================================
 
 // macro to make a thread execution pause in usec
-// max time of about one hour
+// max time of about half an hour (times are compared as signed
+// differences, like the scheduler's, so timerawl wrap is harmless)
+// each time it yields the thread is parked with the scheduler until
+// time_thread (see pt_sleep_until), so it is not called again before then
 #define PT_YIELD_usec(delay_time)  \
     do { static unsigned int time_thread ;\
     time_thread = timer_hw->timerawl + (unsigned int)delay_time ; \
-    PT_YIELD_UNTIL(pt, (timer_hw->timerawl >= time_thread)); \
+    PT_YIELD_FLAG = 0;        \
+    LC_SET((pt)->lc);       \
+    if((PT_YIELD_FLAG == 0) || ((int)(timer_hw->timerawl - time_thread) < 0)) { \
+      pt_sleep_until(time_thread);  \
+      return PT_YIELDED;                        \
+    }           \
     } while(0);
 
 // macro to return system time
@@ -554,11 +562,21 @@ struct pt_sem {
 
 // macros for interval yield
 // attempts to make interval equal to specified value
-#define PT_INTERVAL_INIT() static unsigned int pt_interval_marker
+// (the first interval starts when the thread first gets here)
+#define PT_INTERVAL_INIT() static unsigned int pt_interval_marker, pt_interval_started
 //
 #define PT_YIELD_INTERVAL(interval_time)  \
     do { \
-    PT_YIELD_UNTIL(pt, (timer_hw->timerawl >= pt_interval_marker)); \
+    if (!pt_interval_started) { \
+      pt_interval_marker = timer_hw->timerawl ; \
+      pt_interval_started = 1 ; \
+    } \
+    PT_YIELD_FLAG = 0;        \
+    LC_SET((pt)->lc);       \
+    if((PT_YIELD_FLAG == 0) || ((int)(timer_hw->timerawl - pt_interval_marker) < 0)) { \
+      pt_sleep_until(pt_interval_marker);  \
+      return PT_YIELDED;                        \
+    }           \
     pt_interval_marker = timer_hw->timerawl + (unsigned int)interval_time; \
     } while(0);
 //
@@ -665,11 +683,52 @@ static struct pt pt_sched1 ;
 int pt_task_count = 0 ;
 int pt_task_count1 = 0 ;
 
+// === optional per-thread profiling ===
+// define PT_STATS as 1 before including this file to collect run time
+// and wake latency statistics for every thread. With PT_STATS 0 the
+// scheduler calls threads directly and none of this is compiled in.
+#ifndef PT_STATS
+#define PT_STATS 0
+#endif
+
+// === optional tracing of thread calls ===
+// define PT_TRACE_CALL(core, num, returned) before including this file to
+// hear of every call of a thread (returned 0) and its return (returned 1),
+// num being the thread's number on its core
+#ifndef PT_TRACE_CALL
+#define PT_TRACE_CALL(core, num, returned)
+#endif
+
+#if PT_STATS
+// log2 buckets of wake latency in usec: bucket 0 is on time,
+// bucket b counts latencies in [2^(b-1), 2^b), the last bucket is open
+#define PT_STATS_BUCKETS 16
+struct pt_stats {
+  unsigned int calls;              // number of times the thread was called
+  unsigned long long run_total;    // total usec spent inside the thread
+  unsigned int run_max;            // longest single call in usec
+  unsigned int last_return;        // timerawl when the thread last returned
+  unsigned int wait_max;           // longest usec between return and next call
+  unsigned int latency_hist[PT_STATS_BUCKETS];
+};
+#endif
+
 // The task structure
 struct ptx {
   struct pt pt;              // thread context
   int num;                    // thread number
   char (*pf)(struct pt *pt); // pointer to thread function
+  // used by SCHED_RATE
+  unsigned int period;       // usec between releases, 0 = run whenever idle
+  unsigned int deadline;     // usec after release the call must finish by
+  unsigned int release;      // time of the next release (timerawl)
+  unsigned int overruns;     // calls that finished after their deadline
+  // used by PT_YIELD_usec/PT_YIELD_INTERVAL
+  unsigned int wake;         // time the thread is parked until (timerawl)
+  char sleeping;             // parked in the sleep heap, not called
+#if PT_STATS
+  struct pt_stats stats;
+#endif
 };
 
 // === extended structure for scheduler ===============
@@ -691,6 +750,16 @@ int pt_add( char (*pf)(struct pt *pt)) {
     ptx->num   = pt_task_count;
         // function pointer
     ptx->pf    = pf;
+        // no rate: runs whenever nothing else is due
+    ptx->period = 0;
+    ptx->deadline = 0;
+    ptx->release = timer_hw->timerawl;
+    ptx->overruns = 0;
+    ptx->sleeping = 0;
+#if PT_STATS
+    memset(&ptx->stats, 0, sizeof(ptx->stats));
+    ptx->stats.last_return = ptx->release;
+#endif
     //
     PT_INIT( &ptx->pt );
         // count of number of defined threads
@@ -711,6 +780,16 @@ int pt_add1( char (*pf)(struct pt *pt)) {
     ptx->num   = pt_task_count1;
         // function pointer
     ptx->pf    = pf;
+        // no rate: runs whenever nothing else is due
+    ptx->period = 0;
+    ptx->deadline = 0;
+    ptx->release = timer_hw->timerawl;
+    ptx->overruns = 0;
+    ptx->sleeping = 0;
+#if PT_STATS
+    memset(&ptx->stats, 0, sizeof(ptx->stats));
+    ptx->stats.last_return = ptx->release;
+#endif
     //
     PT_INIT( &ptx->pt );
         // count of number of defined threads
@@ -721,6 +800,158 @@ int pt_add1( char (*pf)(struct pt *pt)) {
   return 0;
 }
 
+// === sleeping threads ===
+// A thread that yields in PT_YIELD_usec/PT_YIELD_INTERVAL is parked in
+// a min-heap keyed by wake time, one heap per core. The schedulers skip
+// parked threads entirely and move them back to ready when their time
+// comes; when nothing is ready the core sleeps (wfe, woken by a timer
+// alarm) until the first wake time.
+struct pt_sleep_heap {
+  struct ptx *entry[MAX_THREADS];
+  int count;
+};
+static struct pt_sleep_heap pt_sleepers[2];
+// thread each core's scheduler is currently calling
+static struct ptx *pt_running[2];
+
+// called by the yield macros: park the running thread until wake_time
+// (does nothing if the thread was not called by a scheduler)
+static inline void pt_sleep_until(unsigned int wake_time) {
+  struct ptx *ptx = pt_running[get_core_num()];
+  if (ptx) {
+    ptx->wake = wake_time;
+    ptx->sleeping = 1;
+  }
+}
+
+static void pt_heap_push(struct pt_sleep_heap *h, struct ptx *ptx) {
+  int i = h->count++;
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if ((int)(h->entry[parent]->wake - ptx->wake) <= 0) break;
+    h->entry[i] = h->entry[parent];
+    i = parent;
+  }
+  h->entry[i] = ptx;
+}
+
+static struct ptx *pt_heap_pop(struct pt_sleep_heap *h) {
+  struct ptx *top = h->entry[0];
+  struct ptx *last = h->entry[--h->count];
+  int i = 0, child;
+  while ((child = 2*i + 1) < h->count) {
+    if ((child + 1 < h->count) &&
+        ((int)(h->entry[child+1]->wake - h->entry[child]->wake) < 0)) child++;
+    if ((int)(last->wake - h->entry[child]->wake) <= 0) break;
+    h->entry[i] = h->entry[child];
+    i = child;
+  }
+  h->entry[i] = last;
+  return top;
+}
+
+// make every thread whose wake time has passed ready again. A periodic
+// thread that slept past its release is released at its wake time instead.
+static void pt_wake_sleepers(struct pt_sleep_heap *h, unsigned int now) {
+  while (h->count && (int)(h->entry[0]->wake - now) <= 0) {
+    struct ptx *ptx = pt_heap_pop(h);
+    ptx->sleeping = 0;
+    if ((int)(ptx->wake - ptx->release) > 0) ptx->release = ptx->wake;
+  }
+}
+
+// usec until the first parked thread wakes, or -1 if none are parked
+static int pt_sleep_wait(struct pt_sleep_heap *h, unsigned int now) {
+  int wait;
+  if (h->count == 0) return -1;
+  wait = (int)(h->entry[0]->wake - now);
+  return (wait > 0) ? wait : 0;
+}
+
+// === call a thread from the scheduler ===
+// With PT_STATS the call is timed. The wake latency is measured from the
+// thread's release time (SCHED_RATE) or from when it last returned
+// (round robin).
+static inline void pt_call_thread(struct ptx *ptx, int from_release) {
+#if PT_STATS
+  struct pt_stats *st = &ptx->stats;
+  unsigned int start = timer_hw->timerawl;
+  unsigned int wait = start - st->last_return;
+  int late = from_release ? (int)(start - ptx->release) : (int)wait;
+  int bucket = 0;
+  if (wait > st->wait_max) st->wait_max = wait;
+  if (late > 0) {
+    bucket = 32 - __builtin_clz((unsigned int)late);
+    if (bucket >= PT_STATS_BUCKETS) bucket = PT_STATS_BUCKETS - 1;
+  }
+  st->latency_hist[bucket]++;
+
+  (ptx->pf)(&ptx->pt);
+
+  unsigned int end = timer_hw->timerawl;
+  unsigned int run = end - start;
+  st->calls++;
+  st->run_total += run;
+  if (run > st->run_max) st->run_max = run;
+  st->last_return = end;
+#else
+  (ptx->pf)(&ptx->pt);
+#endif
+}
+
+// run one thread on the given core, and park it if it went to sleep
+static void pt_run_thread(struct ptx *ptx, int from_release, int core) {
+  pt_running[core] = ptx;
+  PT_TRACE_CALL(core, ptx->num, 0);
+  pt_call_thread(ptx, from_release);
+  PT_TRACE_CALL(core, ptx->num, 1);
+  pt_running[core] = NULL;
+  if (ptx->sleeping) pt_heap_push(&pt_sleepers[core], ptx);
+}
+
+#if PT_STATS
+// format the summary of thread n on the given core into buf
+// returns 0 if there is no such thread
+int pt_stats_format(int core, int n, char *buf, int len) {
+  struct ptx *ptx;
+  if (n >= (core ? pt_task_count1 : pt_task_count)) return 0;
+  ptx = core ? &pt_thread_list1[n] : &pt_thread_list[n];
+  snprintf(buf, len, "core %d thread %d: calls %u run avg %u max %u us, wait max %u us, overruns %u\n\r",
+    core, n, ptx->stats.calls,
+    ptx->stats.calls ? (unsigned int)(ptx->stats.run_total / ptx->stats.calls) : 0,
+    ptx->stats.run_max, ptx->stats.wait_max, ptx->overruns);
+  return 1;
+}
+
+// format the wake latency histogram of thread n on the given core into buf,
+// one count per log2 bucket starting at 'on time'
+// returns 0 if there is no such thread
+int pt_stats_format_hist(int core, int n, char *buf, int len) {
+  struct ptx *ptx;
+  int i, used;
+  if (n >= (core ? pt_task_count1 : pt_task_count)) return 0;
+  ptx = core ? &pt_thread_list1[n] : &pt_thread_list[n];
+  used = snprintf(buf, len, "  lat:");
+  for (i=0; i<PT_STATS_BUCKETS && used<len; i++) {
+    used += snprintf(buf+used, len-used, " %u", ptx->stats.latency_hist[i]);
+  }
+  if (used < len) snprintf(buf+used, len-used, "\n\r");
+  return 1;
+}
+#endif
+
+// add an entry with a rate to the thread list of the calling core
+// period and deadline are in usec, a deadline of 0 means the period
+// (only used when pt_sched_method is SCHED_RATE)
+int pt_add_rate( char (*pf)(struct pt *pt), unsigned int period, unsigned int deadline) {
+  int core = get_core_num();
+  int n = core ? pt_add1(pf) : pt_add(pf);
+  struct ptx *ptx = core ? &pt_thread_list1[n] : &pt_thread_list[n];
+  ptx->period = period;
+  ptx->deadline = deadline ? deadline : period;
+  return n;
+}
+
 /* Scheduler
 Copyright (c) 2014 edartuz
 
@@ -753,6 +984,94 @@ SOFTWARE.
 #define SCHED_RATE 1
 int pt_sched_method = SCHED_ROUND_ROBIN ;
 
+// === rate/deadline scheduling =====================================
+// One scheduling decision for SCHED_RATE: of the periodic threads that
+// have been released, call the one whose deadline (release + deadline)
+// is earliest. Threads with period 0 are released again as soon as they
+// return and only run when no periodic thread is released, so they soak
+// up time nothing periodic needs, oldest release first. If nothing is
+// released the core sleeps (wfe) until the next release.
+// Times are compared as signed differences so timer wrap is harmless.
+static void pt_sched_rate_step(struct ptx *list, int count, int core)
+{
+    struct ptx *ptx, *next = NULL;
+    struct pt_sleep_heap *h = &pt_sleepers[core];
+    unsigned int now = timer_hw->timerawl;
+    int i, wait, due, next_due = 0, min_wait = 0x7fffffff;
+
+    pt_wake_sleepers(h, now);
+    for (i=0, ptx=list; i<count; i++, ptx++){
+        if (ptx->sleeping) continue;
+        wait = (int)(ptx->release - now);
+        if (wait > 0) {
+          // not released yet
+          if (wait < min_wait) min_wait = wait;
+          continue;
+        }
+        if (ptx->period) {
+          due = (int)(ptx->release + ptx->deadline - now);
+          if ((next == NULL) || (next->period == 0) || (due < next_due)) {
+            next = ptx;
+            next_due = due;
+          }
+        }
+        else if ((next == NULL) ||
+                 ((next->period == 0) && ((int)(ptx->release - next->release) < 0))) {
+          next = ptx;
+        }
+    }
+    if (next == NULL) {
+        // nothing due: sleep until the earliest release or wake time
+        wait = pt_sleep_wait(h, now);
+        if ((wait >= 0) && (wait < min_wait)) min_wait = wait;
+        if ((min_wait > 0) && (min_wait != 0x7fffffff)) {
+          best_effort_wfe_or_timeout(make_timeout_time_us(min_wait));
+        }
+        return;
+    }
+
+    pt_run_thread(next, next->period != 0, core);
+    now = timer_hw->timerawl;
+
+    if (next->period) {
+        if ((int)(now - (next->release + next->deadline)) > 0) {
+          next->overruns++;
+        }
+        next->release += next->period;
+        // more than a whole period behind: drop the missed releases
+        if ((int)(now - next->release) > (int)next->period) {
+          next->release = now;
+        }
+    }
+    else {
+        next->release = now;
+    }
+}
+
+// === round robin scheduling =======================================
+// Call every thread that is not parked, once. If they are all parked the
+// core sleeps until the first one wakes.
+static void pt_sched_rr_pass(struct ptx *list, int count, int core)
+{
+    struct ptx *ptx;
+    struct pt_sleep_heap *h = &pt_sleepers[core];
+    int i, ran = 0, wait;
+
+    pt_wake_sleepers(h, timer_hw->timerawl);
+    // -- loop can have more than one initialization or increment/decrement, 
+    // -- separated using comma operator. But it can have only one condition.
+    for (i=0, ptx=list; i<count; i++, ptx++ ){
+        if (ptx->sleeping) continue;
+        // call thread function
+        pt_run_thread(ptx, 0, core);
+        ran = 1;
+    }
+    if (!ran) {
+        wait = pt_sleep_wait(h, timer_hw->timerawl);
+        if (wait > 0) best_effort_wfe_or_timeout(make_timeout_time_us(wait));
+    }
+}
+
 static PT_THREAD (protothread_sched(struct pt *pt))
 {   
     PT_BEGIN(pt);
@@ -761,19 +1080,18 @@ static PT_THREAD (protothread_sched(struct pt *pt))
     if (pt_sched_method==SCHED_ROUND_ROBIN){
         while(1) {
           // test stupid round-robin 
-          // on all defined threads
-          struct ptx *ptx = &pt_thread_list[0];
-          // step thru all defined threads
-          // -- loop can have more than one initialization or increment/decrement, 
-          // -- separated using comma operator. But it can have only one condition.
-          for (i=0; i<pt_task_count; i++, ptx++ ){
-              // call thread function
-              (pt_thread_list[i].pf)(&ptx->pt); 
-          }
+          // on all defined threads that are not asleep
+          pt_sched_rr_pass(pt_thread_list, pt_task_count, 0);
           // Never yields! 
           // NEVER exit while!
         } // END WHILE(1)
     } //end if (pt_sched_method==RR)       
+    else if (pt_sched_method==SCHED_RATE){
+        while(1) {
+          // earliest deadline first
+          pt_sched_rate_step(pt_thread_list, pt_task_count, 0);
+        } // END WHILE(1)
+    } //end if (pt_sched_method==SCHED_RATE)
      
     PT_END(pt);
 } // scheduler thread
@@ -789,19 +1107,18 @@ static PT_THREAD (protothread_sched1(struct pt *pt))
     if (pt_sched_method==SCHED_ROUND_ROBIN){
         while(1) {
           // test stupid round-robin 
-          // on all defined threads
-          struct ptx *ptx = &pt_thread_list1[0];
-          // step thru all defined threads
-          // -- loop can have more than one initialization or increment/decrement, 
-          // -- separated using comma operator. But it can have only one condition.
-          for (i=0; i<pt_task_count1; i++, ptx++ ){
-              // call thread function
-              (pt_thread_list1[i].pf)(&ptx->pt); 
-          }
+          // on all defined threads that are not asleep
+          pt_sched_rr_pass(pt_thread_list1, pt_task_count1, 1);
           // Never yields! 
           // NEVER exit while!
         } // END WHILE(1)
     } // end if(pt_sched_method==SCHED_ROUND_ROBIN)      
+    else if (pt_sched_method==SCHED_RATE){
+        while(1) {
+          // earliest deadline first
+          pt_sched_rate_step(pt_thread_list1, pt_task_count1, 1);
+        } // END WHILE(1)
+    } // end if(pt_sched_method==SCHED_RATE)
      
     PT_END(pt);
 } // scheduler1 thread
@@ -827,6 +1144,12 @@ static PT_THREAD (protothread_sched1(struct pt *pt))
   }\
 } while(0) 
 
+// === package the add thread with a rate ================
+// period/deadline in usec, used when pt_sched_method is SCHED_RATE
+#define pt_add_thread_rate(thread_name, period, deadline) do{\
+  pt_add_rate(thread_name, period, deadline);\
+} while(0)
+
 // === serial input thread ================================
 // serial buffers
 #define pt_buffer_size 100
@@ -905,10 +1228,183 @@ int pt_serialout_polled(struct pt *pt)
     // and indicate the end of the thread
     PT_END(pt);
 }
+// ================================================================
+// === interrupt driven serial
+// The uart interrupt moves bytes between the uart FIFOs and two software
+// buffers: a TX ring that serial_write and pt_serial_write_nb fill, and a
+// queue of complete input lines. Line editing (echo, <backspace>,
+// <enter>) happens in the interrupt, so a line typed or pasted at full
+// baud rate is never lost while a long thread (the camera) is running.
+// Set up by pt_uart_init, or on the first serial_read/serial_write.
+// From then on printf and the rest of stdio also go through the TX ring
+// (with stdio_uart they would write the uart directly, in the middle of
+// what the ring is sending), so don't call uart_putc on uart0 yourself.
+//
+#define pt_tx_ring_size 1024  // power of 2
+#define pt_rx_lines 4         // power of 2, one slot is the line being typed
+static char pt_tx_ring[pt_tx_ring_size];
+static volatile unsigned int pt_tx_head, pt_tx_tail ;
+static char pt_rx_line[pt_rx_lines][pt_buffer_size];
+static volatile unsigned int pt_rx_line_head, pt_rx_line_tail ;
+static volatile int pt_rx_count ;    // characters in the line being typed
+static volatile char pt_uart_irq_on = 0 ;
+// overflow counters
+volatile unsigned int pt_uart_tx_dropped = 0 ;   // bytes that did not fit in the TX ring
+volatile unsigned int pt_uart_rx_dropped = 0 ;   // characters past the end of a line
+volatile unsigned int pt_uart_line_dropped = 0 ; // lines lost because the queue was full
+// optional filter run on each received byte before line editing, returns
+// nonzero if it consumed the byte (e.g. a binary command frame)
+int (*volatile pt_uart_rx_hook)(char ch) = NULL ;
+
+// free space in the TX ring
+static inline int pt_tx_free(void) {
+  return pt_tx_ring_size - 1 - ((pt_tx_head - pt_tx_tail) & (pt_tx_ring_size - 1));
+}
+
+// move ring bytes into the uart FIFO, turn the TX interrupt off when empty
+// (call with the uart interrupt masked)
+static inline void pt_tx_fill_fifo(void) {
+  while ((pt_tx_tail != pt_tx_head) && uart_is_writable(UART_ID)) {
+    uart_putc_raw(UART_ID, pt_tx_ring[pt_tx_tail]);
+    pt_tx_tail = (pt_tx_tail + 1) & (pt_tx_ring_size - 1);
+  }
+  uart_set_irq_enables(UART_ID, true, pt_tx_tail != pt_tx_head);
+}
+
+// queue one byte for output from inside the interrupt (echo)
+static inline void pt_tx_put_irq(char ch) {
+  if (pt_tx_free() > 0) {
+    pt_tx_ring[pt_tx_head] = ch;
+    pt_tx_head = (pt_tx_head + 1) & (pt_tx_ring_size - 1);
+  }
+  else pt_uart_tx_dropped++ ;
+}
+
+static void pt_uart_irq_handler(void) {
+  while (uart_is_readable(UART_ID)) {
+    char ch = uart_getc(UART_ID);
+    if (pt_uart_rx_hook && pt_uart_rx_hook(ch)) continue ;
+    char *line = pt_rx_line[pt_rx_line_head & (pt_rx_lines - 1)];
+    // echo it back to terminal
+    // NOTE this assumes a human is typing!!
+    pt_tx_put_irq(ch);
+    if (ch == '\r') {
+      // <enter> terminates the line and advances the cursor
+      pt_tx_put_irq('\n');
+      line[pt_rx_count] = 0;
+      if ((pt_rx_line_head - pt_rx_line_tail) < pt_rx_lines - 1) pt_rx_line_head++ ;
+      else pt_uart_line_dropped++ ;
+      pt_rx_count = 0;
+    }
+    else if (ch == pt_backspace) {
+      pt_tx_put_irq(' ');
+      pt_tx_put_irq(pt_backspace);
+      if (pt_rx_count > 0) pt_rx_count-- ;
+    }
+    else if (pt_rx_count < pt_buffer_size - 1) {
+      line[pt_rx_count++] = ch;
+    }
+    else pt_uart_rx_dropped++ ;
+  }
+  pt_tx_fill_fifo();
+}
+
+int pt_serial_write_nb(const char *buf, int len);
+
+#if LIB_PICO_STDIO_UART
+// stdio output driver in place of stdio_uart: queue what fits in the TX
+// ring, count the rest as dropped like echo
+static stdio_driver_t pt_stdio_driver;
+static void pt_stdio_out_chars(const char *buf, int len) {
+  int n = pt_serial_write_nb(buf, len);
+  irq_set_enabled(UART0_IRQ, false);
+  pt_uart_tx_dropped += len - n;
+  irq_set_enabled(UART0_IRQ, true);
+}
+#endif
+
+// take over uart0 with the interrupt driven buffers
+// baud = 0 keeps the current baud rate
+void pt_uart_init(unsigned int baud) {
+  if (baud) uart_set_baudrate(UART_ID, baud);
+  pt_tx_head = pt_tx_tail = 0;
+  pt_rx_line_head = pt_rx_line_tail = 0;
+  pt_rx_count = 0;
+  irq_set_exclusive_handler(UART0_IRQ, pt_uart_irq_handler);
+  irq_set_enabled(UART0_IRQ, true);
+  uart_set_irq_enables(UART_ID, true, false);
+  pt_uart_irq_on = 1;
+#if LIB_PICO_STDIO_UART
+  pt_stdio_driver.out_chars = pt_stdio_out_chars;
+#if PICO_STDIO_ENABLE_CRLF_SUPPORT
+  pt_stdio_driver.crlf_enabled = PICO_STDIO_DEFAULT_CRLF;
+#endif
+  stdio_set_driver_enabled(&stdio_uart, false);
+  stdio_set_driver_enabled(&pt_stdio_driver, true);
+#endif
+}
+
+// non-blocking write: queue up to len bytes, returns the number queued
+int pt_serial_write_nb(const char *buf, int len) {
+  int n, free;
+  if (!pt_uart_irq_on) pt_uart_init(0);
+  // the interrupt queues echo into the same ring, so the free space,
+  // the copy and the head move all happen with it masked
+  irq_set_enabled(UART0_IRQ, false);
+  free = pt_tx_free();
+  if (len > free) len = free;
+  for (n = 0; n < len; n++) {
+    pt_tx_ring[(pt_tx_head + n) & (pt_tx_ring_size - 1)] = buf[n];
+  }
+  // publish the bytes, then prime the FIFO (the TX interrupt only fires
+  // when the FIFO drains, so an idle uart has to be started by hand)
+  pt_tx_head = (pt_tx_head + len) & (pt_tx_ring_size - 1);
+  pt_tx_fill_fifo();
+  irq_set_enabled(UART0_IRQ, true);
+  return len;
+}
+
+// non-blocking read: copy the oldest complete line into buf
+// (pt_buffer_size bytes), returns 0 if no line is waiting
+int pt_serial_read_nb(char *buf) {
+  if (!pt_uart_irq_on) pt_uart_init(0);
+  if (pt_rx_line_head == pt_rx_line_tail) return 0;
+  memcpy(buf, pt_rx_line[pt_rx_line_tail & (pt_rx_lines - 1)], pt_buffer_size);
+  pt_rx_line_tail++ ;
+  return 1;
+}
+
+// ================================================================
+// === buffered serial threads
+// yield (instead of polling the uart) until there is room/a line
+static PT_THREAD (pt_serialout_buffered(struct pt *pt)){
+    static int num_send_chars, len ;
+    PT_BEGIN(pt);
+    num_send_chars = 0;
+    len = strlen(pt_serial_out_buffer);
+    while (num_send_chars < len){
+        num_send_chars += pt_serial_write_nb(&pt_serial_out_buffer[num_send_chars], len - num_send_chars);
+        if (num_send_chars < len) PT_YIELD(pt);
+    }
+    // kill this output thread, to allow spawning thread to execute
+    PT_EXIT(pt);
+    PT_END(pt);
+}
+
+static PT_THREAD (pt_serialin_buffered(struct pt *pt)){
+    PT_BEGIN(pt);
+    PT_YIELD_UNTIL(pt, pt_serial_read_nb(pt_serial_in_buffer));
+    // kill this input thread, to allow spawning thread to execute
+    PT_EXIT(pt);
+    PT_END(pt);
+}
+
 // ================================================================
 // package the spawn read/write macros to make them look better
-#define serial_write do{PT_SPAWN(pt,&pt_serialout,pt_serialout_polled(&pt_serialout));}while(0)
-#define serial_read  do{PT_SPAWN(pt,&pt_serialin,pt_serialin_polled(&pt_serialin));}while(0)
+// (the polled threads above are still available for use without the
+// uart interrupt)
+#define serial_write do{PT_SPAWN(pt,&pt_serialout,pt_serialout_buffered(&pt_serialout));}while(0)
+#define serial_read  do{PT_SPAWN(pt,&pt_serialin,pt_serialin_buffered(&pt_serialin));}while(0)
 //
 // ======
 // END
@@ -0,0 +1,77 @@
+/**
+ * Event trace, see trace.h
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "trace.h"
+
+const char *const trace_event_names[TR_IDS] = {
+    "call", "return", "capture start", "capture done", "frame end",
+    "scanout", "blit", "command frame", "command", "menu"
+} ;
+
+void traceInit(trace_log *t) {
+    memset(t, 0, sizeof(*t)) ;
+    for (int c = 0; c < TRACE_CORES; c++) {
+        t->ring[2 * c].events = t->thread_events[c] ;
+        t->ring[2 * c].size = TRACE_EVENTS ;
+        t->ring[2 * c + 1].events = t->irq_events[c] ;
+        t->ring[2 * c + 1].size = TRACE_IRQ_EVENTS ;
+    }
+    t->enabled = 1 ;
+}
+
+void traceClear(trace_log *t) {
+    for (int r = 0; r < TRACE_RINGS; r++) t->ring[r].count = 0 ;
+}
+
+uint32_t traceHeld(const trace_ring *r) {
+    return r->count < r->size ? r->count : r->size ;
+}
+
+uint32_t traceLost(const trace_ring *r) {
+    return r->count - traceHeld(r) ;
+}
+
+int traceFormatEvents(const trace_ring *r, uint32_t i, char *buf, int len) {
+    uint32_t held = traceHeld(r) ;
+    uint32_t first = r->count - held ;      // oldest event held
+    int n = 0, used = 0 ;
+    buf[0] = 0 ;
+    while (n < TRACE_PER_LINE && i + n < held && used + 16 < len) {
+        const trace_event *e = &r->events[(first + i + n) & (r->size - 1)] ;
+        used += snprintf(buf + used, len - used, "%s%08lx%02x%04x", n ? " " : "",
+                         (unsigned long)e->time, e->id, e->arg) ;
+        n++ ;
+    }
+    return n ;
+}
+
+static int hexDigits(const char *s, int n, uint32_t *v) {
+    *v = 0 ;
+    for (int i = 0; i < n; i++) {
+        char c = s[i] ;
+        int d = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1 ;
+        if (d < 0) return 0 ;
+        *v = (*v << 4) | d ;
+    }
+    return 1 ;
+}
+
+int traceParseEvents(const char *line, int core, trace_event *out, int max) {
+    int n = 0 ;
+    while (n < max) {
+        // the firmware ends lines with "\n\r", so a line can start with '\r'
+        while (*line == ' ' || *line == '\r' || *line == '\t') line++ ;
+        uint32_t time, id, arg ;
+        if (!hexDigits(line, 8, &time) || !hexDigits(line + 8, 2, &id) || !hexDigits(line + 10, 4, &arg)) break ;
+        out[n].time = time ;
+        out[n].id = id ;
+        out[n].core = core ;
+        out[n].arg = arg ;
+        n++ ;
+        line += 14 ;
+    }
+    return n ;
+}
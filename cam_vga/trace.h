@@ -0,0 +1,121 @@
+/**
+ * Event trace
+ *
+ * A fixed ring of small binary events in SRAM (time, event id, core and a
+ * 16 bit argument) recorded from the scheduler, the camera thread and
+ * interrupt handlers, dumped over serial as hex and turned into a
+ * Chrome/Perfetto trace on the host (host/trace2json).
+ *
+ * There is one ring per core for thread code and one per core for
+ * interrupt handlers, so every ring has a single writer and recording
+ * needs no lock, atomic or interrupt masking (the M0+ has no atomic read
+ * modify write): write the slot, then publish it by bumping the count.
+ * Interrupts of the same priority don't preempt each other, so the
+ * interrupt ring has a single writer too. That holds only while
+ * UART0_IRQ (command frames) and DMA_IRQ_0 (scanout), which both write
+ * ring 2 * core + 1, keep the same priority; raising either one's with
+ * irq_set_priority would let it preempt the other mid-record. Each ring keeps its newest
+ * events; older ones are overwritten and counted as lost. Recording is
+ * paused while the rings are dumped.
+ *
+ * Memory: 8 bytes per event, (TRACE_EVENTS + TRACE_IRQ_EVENTS) per core,
+ * 10 KB by default. Cost per event is about a dozen instructions: the
+ * time and core reads, an enabled check and the stores.
+ *
+ * Plain C with no pico dependencies, the caller passes the time and core.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef TRACE_EVENTS
+#define TRACE_EVENTS 512            // per core, thread code, power of 2
+#endif
+#ifndef TRACE_IRQ_EVENTS
+#define TRACE_IRQ_EVENTS 128        // per core, interrupt handlers, power of 2
+#endif
+#define TRACE_CORES 2
+#define TRACE_RINGS (2 * TRACE_CORES)   // ring 2 * core + irq
+
+// Events, arg in brackets
+enum {
+    TR_THREAD_CALL,             // scheduler calls a thread (thread number)
+    TR_THREAD_RETURN,           // and it returns (thread number)
+    TR_CAPTURE_START,           // frame started (frame number)
+    TR_CAPTURE_DONE,            // frame ready to read (frame number)
+    TR_FRAME_END,               // frame processed and drawn (edges)
+    TR_SCANOUT,                 // VGA DMA sent the last line of the screen (frame number)
+    TR_BLIT,                    // blitter DMA copy finished (words)
+    TR_CMD_FRAME,               // command frame received (sequence number)
+    TR_COMMAND,                 // setting applied (opcode << 8 | argument)
+    TR_MENU,                    // serial menu command (character)
+    TR_IDS
+} ;
+
+extern const char *const trace_event_names[TR_IDS] ;
+
+typedef struct {
+    uint32_t time ;             // usec
+    uint8_t id ;
+    uint8_t core ;
+    uint16_t arg ;
+} trace_event ;
+
+typedef struct {
+    trace_event *events ;
+    uint32_t size ;             // power of 2
+    volatile uint32_t count ;   // events ever recorded
+} trace_ring ;
+
+typedef struct {
+    trace_ring ring[TRACE_RINGS] ;
+    trace_event thread_events[TRACE_CORES][TRACE_EVENTS] ;
+    trace_event irq_events[TRACE_CORES][TRACE_IRQ_EVENTS] ;
+    volatile uint8_t enabled ;
+} trace_log ;
+
+void traceInit(trace_log *t) ;
+// Forget everything recorded
+void traceClear(trace_log *t) ;
+
+static inline void traceRecord(trace_log *t, int core, int irq, uint32_t time, uint8_t id, uint16_t arg) {
+    if (!t->enabled) return ;
+    trace_ring *r = &t->ring[2 * core + irq] ;
+    uint32_t n = r->count ;
+    trace_event *e = &r->events[n & (r->size - 1)] ;
+    e->time = time ;
+    e->id = id ;
+    e->core = core ;
+    e->arg = arg ;
+    r->count = n + 1 ;
+}
+
+// Events held by a ring, and the ones overwritten
+uint32_t traceHeld(const trace_ring *r) ;
+uint32_t traceLost(const trace_ring *r) ;
+
+// Dump format, one line each:
+//   "trace ring <ring> <events held> <lost>"
+//   then the held events oldest first, TRACE_PER_LINE to a line, each as
+//   8 hex digits of time, 2 of id and 4 of arg
+//   "trace thread <core> <number> <name>" names a thread
+//   "trace end"
+#define TRACE_PER_LINE 5
+// Events i.. of ring r, up to TRACE_PER_LINE, into buf. Returns the
+// number written.
+int traceFormatEvents(const trace_ring *r, uint32_t i, char *buf, int len) ;
+// Parse one line of event hex, core filled in from the ring. Returns the
+// number of events read.
+int traceParseEvents(const char *line, int core, trace_event *out, int max) ;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,42 @@
+/**
+ * Varint (LEB128) and zigzag helpers shared by the export encoders
+ */
+
+#ifndef VARINT_H
+#define VARINT_H
+
+#include <stdint.h>
+
+static inline uint32_t zigzag(int v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31) ;
+}
+
+static inline int unzigzag(uint32_t v) {
+    return (int)(v >> 1) ^ -(int)(v & 1) ;
+}
+
+// Returns the bytes written, 0 if there is no room
+static inline int putVarint(uint8_t *out, int room, uint32_t v) {
+    int n = 0 ;
+    do {
+        if (n >= room) return 0 ;
+        out[n++] = (v & 0x7f) | ((v > 0x7f) ? 0x80 : 0) ;
+        v >>= 7 ;
+    } while (v) ;
+    return n ;
+}
+
+// Returns the bytes read, 0 if the varint runs past the end
+static inline int getVarint(const uint8_t *in, uint32_t room, uint32_t *v) {
+    uint32_t result = 0 ;
+    for (uint32_t n = 0; n < room && n < 5; n++) {
+        result |= (uint32_t)(in[n] & 0x7f) << (7 * n) ;
+        if (!(in[n] & 0x80)) {
+            *v = result ;
+            return n + 1 ;
+        }
+    }
+    return 0 ;
+}
+
+#endif
@@ -0,0 +1,303 @@
+/**
+ * Edge vectoriser, see vectorize.h
+ */
+
+#include "vectorize.h"
+#include "varint.h"
+
+// 8 neighbours clockwise (y down), starting west
+static const signed char dir_x[8] = { -1, -1, 0, 1, 1, 1, 0, -1 } ;
+static const signed char dir_y[8] = { 0, -1, -1, -1, 0, 1, 1, 1 } ;
+
+static inline int dirOf(int dx, int dy) {
+    for (int d = 0; d < 8; d++) {
+        if (dir_x[d] == dx && dir_y[d] == dy) return d ;
+    }
+    return 0 ;
+}
+
+static uint32_t isqrt(uint32_t v) {
+    uint32_t root = 0, bit = 1u << 30 ;
+    while (bit > v) bit >>= 2 ;
+    while (bit) {
+        if (v >= root + bit) {
+            v -= root + bit ;
+            root = (root >> 1) + bit ;
+        }
+        else root >>= 1 ;
+        bit >>= 2 ;
+    }
+    return root ;
+}
+
+static inline uint32_t dist2(vec_point a, vec_point b) {
+    int dx = a.x - b.x, dy = a.y - b.y ;
+    return dx * dx + dy * dy ;
+}
+
+static inline uint32_t dist(vec_point a, vec_point b) {
+    return isqrt(dist2(a, b)) ;
+}
+
+// ==================================================
+// === Contour tracing
+// ==================================================
+
+// Moore-neighbour trace of the contour through s, stopping when s is
+// left in the same direction a second time (Jacob's criterion).
+// s must have no edge pixel to its west. Returns the contour length.
+static int traceContour(const vec_image *img, vec_point s, vec_point *out, int max) {
+    vec_point c = s ;
+    int back = 0 ;      // direction from c to the last background pixel
+    int first = -1 ;    // direction of the first move out of s
+    int n = 0 ;
+    out[n++] = s ;
+    while (n < max) {
+        int found = -1, d = back ;
+        for (int k = 1; k <= 8; k++) {
+            d = (back + k) & 7 ;
+            if (img->get(img->ctx, c.x + dir_x[d], c.y + dir_y[d])) {
+                found = d ;
+                break ;
+            }
+        }
+        if (found < 0) break ;      // isolated pixel
+        if (c.x == s.x && c.y == s.y) {
+            if (found == first) break ;
+            if (first < 0) first = found ;
+        }
+        // the neighbour checked before found is background, seen from the
+        // new pixel it becomes the backtrack direction
+        int prev = (found + 7) & 7 ;
+        vec_point next = { c.x + dir_x[found], c.y + dir_y[found] } ;
+        back = dirOf(dir_x[prev] - dir_x[found], dir_y[prev] - dir_y[found]) ;
+        c = next ;
+        out[n++] = c ;
+    }
+    return n ;
+}
+
+// ==================================================
+// === Douglas-Peucker
+// ==================================================
+
+// Simplify in[0..n-1] onto the end of r->points. Iterative, segments
+// wait on r->stack as (a << 16) | b, left halves on top so points come
+// out in order. Returns 0 if the points array is full.
+static int simplify(vec_result *r, const vec_point *in, int n, int epsilon) {
+    int sp = 0 ;
+    int64_t eps2 = (int64_t)epsilon * epsilon ;
+    if (n > 1) r->stack[sp++] = (uint32_t)(n - 1) ;
+    while (sp > 0) {
+        uint32_t seg = r->stack[--sp] ;
+        int a = seg >> 16, b = seg & 0xffff ;
+        int dx = in[b].x - in[a].x, dy = in[b].y - in[a].y ;
+        int64_t len2 = (int64_t)dx * dx + (int64_t)dy * dy ;
+        int64_t best = -1 ;
+        int k = -1 ;
+        for (int i = a + 1; i < b; i++) {
+            int px = in[i].x - in[a].x, py = in[i].y - in[a].y ;
+            int64_t d ;
+            if (len2) {
+                // squared perpendicular distance times len2
+                int64_t cross = (int64_t)dx * py - (int64_t)dy * px ;
+                d = cross * cross ;
+            }
+            else d = (int64_t)px * px + (int64_t)py * py ;
+            if (d > best) {
+                best = d ;
+                k = i ;
+            }
+        }
+        if (k >= 0 && best > eps2 * (len2 ? len2 : 1) && sp + 2 <= r->stack_max) {
+            r->stack[sp++] = ((uint32_t)k << 16) | b ;
+            r->stack[sp++] = ((uint32_t)a << 16) | k ;
+        }
+        else {
+            if (r->n_points >= r->points_max) return 0 ;
+            r->points[r->n_points++] = in[a] ;
+        }
+    }
+    if (r->n_points >= r->points_max) return 0 ;
+    r->points[r->n_points++] = in[n - 1] ;
+    return 1 ;
+}
+
+// ==================================================
+// === Tracing every contour
+// ==================================================
+
+int vecTrace(const vec_image *img, vec_result *r, int min_pixels, int epsilon) {
+    r->n_points = 0 ;
+    r->n_paths = 0 ;
+    r->contours_dropped = 0 ;
+    if (r->contour_max > 0xffff) r->contour_max = 0xffff ;
+    for (short y = 0; y < img->height; y++) {
+        for (short x = 0; x < img->width; x++) {
+            if (!img->get(img->ctx, x, y)) continue ;
+            vec_point s = { x, y } ;
+            int n = traceContour(img, s, r->contour, r->contour_max) ;
+            for (int i = 0; i < n; i++) img->clear(img->ctx, r->contour[i].x, r->contour[i].y) ;
+            if (n < min_pixels) continue ;
+            // a one pixel wide open line is traced out and back, keep one way
+            int same = 0 ;
+            while (same < n / 2 && r->contour[same].x == r->contour[n - 1 - same].x &&
+                   r->contour[same].y == r->contour[n - 1 - same].y) same++ ;
+            if (same >= n / 2) n = n / 2 + 1 ;
+
+            int start = r->n_points ;
+            if (r->n_paths >= r->paths_max || !simplify(r, r->contour, n, epsilon)) {
+                r->n_points = start ;
+                r->contours_dropped++ ;
+                continue ;
+            }
+            vec_path *p = &r->paths[r->n_paths++] ;
+            p->start = start ;
+            p->count = r->n_points - start ;
+            p->reversed = 0 ;
+        }
+    }
+    r->travel_before = vecTravel(r) ;
+    r->travel_after = r->travel_before ;
+    return r->n_paths ;
+}
+
+// ==================================================
+// === Path ordering
+// ==================================================
+
+static inline vec_point entryOf(const vec_result *r, const vec_path *p) {
+    return r->points[p->reversed ? p->start + p->count - 1 : p->start] ;
+}
+
+static inline vec_point exitOf(const vec_result *r, const vec_path *p) {
+    return r->points[p->reversed ? p->start : p->start + p->count - 1] ;
+}
+
+uint32_t vecTravel(const vec_result *r) {
+    vec_point pen = { 0, 0 } ;
+    uint32_t total = 0 ;
+    for (int i = 0; i < r->n_paths; i++) {
+        total += dist(pen, entryOf(r, &r->paths[i])) ;
+        pen = exitOf(r, &r->paths[i]) ;
+    }
+    return total ;
+}
+
+void vecOrder(vec_result *r, int window, int passes) {
+    vec_path *paths = r->paths ;
+    int n = r->n_paths ;
+    vec_point pen = { 0, 0 } ;
+
+    // nearest neighbour, either end of a path may be the entry
+    for (int i = 0; i < n; i++) {
+        int best = i, best_rev = 0 ;
+        uint32_t best_d = 0xffffffff ;
+        for (int j = i; j < n; j++) {
+            uint32_t ds = dist2(pen, r->points[paths[j].start]) ;
+            uint32_t de = dist2(pen, r->points[paths[j].start + paths[j].count - 1]) ;
+            if (ds < best_d) {
+                best_d = ds ;
+                best = j ;
+                best_rev = 0 ;
+            }
+            if (de < best_d) {
+                best_d = de ;
+                best = j ;
+                best_rev = 1 ;
+            }
+        }
+        vec_path t = paths[i] ;
+        paths[i] = paths[best] ;
+        paths[best] = t ;
+        paths[i].reversed = best_rev ;
+        pen = exitOf(r, &paths[i]) ;
+    }
+
+    // 2-opt: drawing paths i..j in the opposite order, each one backwards,
+    // only changes the two pen-up moves at the ends of the run
+    for (int pass = 0; pass < passes; pass++) {
+        int improved = 0 ;
+        for (int i = 0; i < n - 1; i++) {
+            vec_point before = i ? exitOf(r, &paths[i - 1]) : (vec_point){ 0, 0 } ;
+            int last = (i + window < n) ? i + window : n - 1 ;
+            for (int j = i + 1; j <= last; j++) {
+                vec_point a = entryOf(r, &paths[i]) ;
+                vec_point b = exitOf(r, &paths[j]) ;
+                uint32_t old_cost = dist(before, a) ;
+                uint32_t new_cost = dist(before, b) ;
+                if (j + 1 < n) {
+                    vec_point after = entryOf(r, &paths[j + 1]) ;
+                    old_cost += dist(b, after) ;
+                    new_cost += dist(a, after) ;
+                }
+                if (new_cost >= old_cost) continue ;
+                for (int lo = i, hi = j; lo <= hi; lo++, hi--) {
+                    vec_path t = paths[lo] ;
+                    paths[lo] = paths[hi] ;
+                    paths[hi] = t ;
+                    paths[lo].reversed ^= 1 ;
+                    if (lo != hi) paths[hi].reversed ^= 1 ;
+                }
+                improved = 1 ;
+            }
+        }
+        if (!improved) break ;
+    }
+    r->travel_after = vecTravel(r) ;
+}
+
+// ==================================================
+// === Path list coding
+// ==================================================
+
+int vecEncodePaths(const vec_result *r, uint8_t *out, int cap, uint32_t *len) {
+    int used = 0, px = 0, py = 0, i ;
+    for (i = 0; i < r->n_paths; i++) {
+        const vec_path *p = &r->paths[i] ;
+        int pos = used, x = px, y = py, ok ;
+        ok = putVarint(&out[pos], cap - pos, p->count) ;
+        pos += ok ;
+        for (int k = 0; ok && k < p->count; k++) {
+            vec_point q = r->points[p->reversed ? p->start + p->count - 1 - k : p->start + k] ;
+            int a = putVarint(&out[pos], cap - pos, zigzag(q.x - x)) ;
+            int b = a ? putVarint(&out[pos + a], cap - pos - a, zigzag(q.y - y)) : 0 ;
+            ok = a && b ;
+            pos += a + b ;
+            x = q.x ;
+            y = q.y ;
+        }
+        if (!ok) break ;
+        used = pos ;
+        px = x ;
+        py = y ;
+    }
+    *len = used ;
+    return i ;
+}
+
+int vecDecodePaths(const uint8_t *in, uint32_t len, short *xs, short *ys, uint16_t *path_of, int max) {
+    uint32_t pos = 0, v, count ;
+    int n = 0, x = 0, y = 0 ;
+    for (uint16_t path = 0; pos < len; path++) {
+        int a = getVarint(&in[pos], len - pos, &count) ;
+        if (!a) return -1 ;
+        pos += a ;
+        for (uint32_t k = 0; k < count; k++) {
+            if (n >= max) return n ;
+            a = getVarint(&in[pos], len - pos, &v) ;
+            if (!a) return -1 ;
+            pos += a ;
+            x += unzigzag(v) ;
+            a = getVarint(&in[pos], len - pos, &v) ;
+            if (!a) return -1 ;
+            pos += a ;
+            y += unzigzag(v) ;
+            xs[n] = x ;
+            ys[n] = y ;
+            path_of[n] = path ;
+            n++ ;
+        }
+    }
+    return n ;
+}
@@ -0,0 +1,92 @@
+/**
+ * Edge vectoriser
+ *
+ * Turns a binary edge image into an ordered list of polylines for a pen
+ * plotter or robot arm:
+ *
+ *  - vecTrace links set pixels into contours with Moore-neighbour tracing
+ *    (8-connected), erasing each contour as it goes so nothing is traced
+ *    twice, and simplifies each one with Douglas-Peucker
+ *  - vecOrder orders the polylines, and picks the end each one is drawn
+ *    from, with a nearest-neighbour tour improved by 2-opt to cut pen-up
+ *    travel
+ *  - vecEncodePaths packs the result into a compact byte list
+ *
+ * All storage is supplied by the caller through vec_result, nothing is
+ * allocated. Integer only, there is no FPU on the RP2040.
+ *
+ * Plain C with no pico dependencies, shared with the host tools.
+ */
+
+#ifndef VECTORIZE_H
+#define VECTORIZE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Pixel access. get returns nonzero for an edge pixel (and 0 off the
+// image), clear erases one.
+typedef struct {
+    int (*get)(void *ctx, short x, short y) ;
+    void (*clear)(void *ctx, short x, short y) ;
+    void *ctx ;
+    short width, height ;
+} vec_image ;
+
+typedef struct {
+    short x, y ;
+} vec_point ;
+
+typedef struct {
+    uint16_t start ;    // first point in vec_result.points
+    uint16_t count ;
+    uint8_t reversed ;  // draw from the last point to the first
+} vec_path ;
+
+typedef struct {
+    // caller supplied storage
+    vec_point *contour ;    // scratch for one raw contour
+    int contour_max ;
+    uint32_t *stack ;       // Douglas-Peucker scratch
+    int stack_max ;
+    vec_point *points ;
+    int points_max ;
+    vec_path *paths ;
+    int paths_max ;
+    // results
+    int n_points ;
+    int n_paths ;
+    uint32_t contours_dropped ;     // no room in points or paths
+    uint32_t travel_before ;        // pen-up travel in pixels, as traced
+    uint32_t travel_after ;         // after vecOrder
+} vec_result ;
+
+// Trace and simplify every contour of at least min_pixels pixels,
+// keeping points within epsilon pixels of the original contour.
+// Returns the number of paths.
+int vecTrace(const vec_image *img, vec_result *r, int min_pixels, int epsilon) ;
+
+// Order the paths to shorten pen-up travel from (0, 0). 2-opt looks at
+// most window paths ahead and makes at most passes passes.
+void vecOrder(vec_result *r, int window, int passes) ;
+
+// Pen-up travel from (0, 0) through the paths in their current order
+uint32_t vecTravel(const vec_result *r) ;
+
+// Pack the ordered paths: for each path varint(count), then its points
+// in drawing order as zigzag varint deltas (x then y) from the previous
+// point, starting at (0, 0). Returns the number of paths that fit and
+// sets *len to the bytes used.
+int vecEncodePaths(const vec_result *r, uint8_t *out, int cap, uint32_t *len) ;
+// Unpack into at most max points. path_of[i] is the path of point i.
+// Returns the number of points, or -1 on malformed input.
+int vecDecodePaths(const uint8_t *in, uint32_t len, short *xs, short *ys, uint16_t *path_of, int max) ;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
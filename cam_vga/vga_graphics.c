@@ -1,5 +1,10 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+// VGA_HOST builds the drawing code alone for a host, with no PIO or DMA:
+// the screen is just vga_data_array and initVGA clears it
+#ifndef VGA_HOST
 #include "pico/stdlib.h"
 #include "hardware/pio.h"
 #include "hardware/dma.h"
@@ -8,6 +13,7 @@
 #include "hsync.pio.h"
 #include "vsync.pio.h"
 #include "rgb.pio.h"
+#endif
 // Header file
 #include "vga_graphics.h"
 // Font file
@@ -25,13 +31,20 @@
 // Pixel color array that is DMA's to the PIO machines and
 // a pointer to the ADDRESS of this color array.
 // Note that this array is automatically initialized to all 0's (black)
-unsigned char vga_data_array[TXCOUNT];
+unsigned char vga_data_array[TXCOUNT] __attribute__((aligned(4)));
+#ifndef VGA_HOST
 char * address_pointer = &vga_data_array[0] ;
+#endif
 
 // Bit masks for drawPixel routine
 #define TOPMASK 0b11000111
 #define BOTTOMMASK 0b11111000
 
+// DMA channel used by the blitter for large memory-to-memory copies
+#define BLIT_DMA_CHAN 2
+// Copies shorter than this (in bytes) are done by the CPU
+#define BLIT_DMA_MIN 64
+
 // For drawLine
 #define swap(a, b) { short t = a; a = b; b = t; }
 
@@ -49,6 +62,25 @@ char textcolor, textbgcolor, wrap;
 #define _width 640
 #define _height 480
 
+// One bit per screen row, set whenever a drawing routine touches the row.
+// Rows are cleared by writeRowIfChanged/clearDirtyRows.
+static unsigned char vga_dirty_rows[_height/8] ;
+#define markDirtyRow(y) (vga_dirty_rows[(y)>>3] |= (1 << ((y) & 7)))
+
+// Hash of the packed row last written by writeRowIfChanged
+static uint32_t vga_row_hash[_height] ;
+
+// Rows written/skipped by writeRowIfChanged, reset by the caller
+unsigned int vga_rows_written = 0 ;
+unsigned int vga_rows_skipped = 0 ;
+
+#ifdef VGA_HOST
+void initVGA() {
+    memset(vga_data_array, 0, sizeof(vga_data_array)) ;
+    memset(vga_dirty_rows, 0, sizeof(vga_dirty_rows)) ;
+    memset(vga_row_hash, 0, sizeof(vga_row_hash)) ;
+}
+#else
 void initVGA() {
         // Choose which PIO instance to use (there are two instances, each with 4 state machines)
     PIO pio = pio0;
@@ -144,7 +176,15 @@ void initVGA() {
     // To change the contents of the screen, we need only change the contents
     // of that array.
     dma_start_channel_mask((1u << rgb_chan_0)) ;
+
+    // Channel Two (blitter memory-to-memory copies, started on demand)
+    dma_channel_config c2 = dma_channel_get_default_config(BLIT_DMA_CHAN);
+    channel_config_set_transfer_data_size(&c2, DMA_SIZE_32);              // 32-bit txfers
+    channel_config_set_read_increment(&c2, true);                         // yes read incrementing
+    channel_config_set_write_increment(&c2, true);                        // yes write incrementing
+    dma_channel_set_config(BLIT_DMA_CHAN, &c2, false);
 }
+#endif
 
 
 // A function for drawing a pixel with a specified color.
@@ -158,6 +198,8 @@ void drawPixel(short x, short y, char color) {
     if (y < 0) y = 0 ;
     if (y > 479) y = 479 ;
 
+    markDirtyRow(y) ;
+
     // Which pixel is it?
     int pixel = ((640 * y) + x) ;
 
@@ -172,6 +214,271 @@ void drawPixel(short x, short y, char color) {
     }
 }
 
+// ==================================================
+// === Blitter
+// ==================================================
+// The blit routines clip their rectangle against the screen once, then run
+// unchecked inner loops directly on vga_data_array. Two pixels share each
+// byte: even pixels in bits 0-2, odd pixels in bits 3-5.
+
+// Mark rows y0..y1 as dirty
+void markDirtyRows(short y0, short y1) {
+    if (y0 < 0) y0 = 0 ;
+    if (y1 > _height - 1) y1 = _height - 1 ;
+    for (short y = y0; y <= y1; y++) {
+        markDirtyRow(y) ;
+    }
+}
+
+// Write one pixel without range checks. pixel = (640 * y) + x
+static inline void putPixelUnchecked(int pixel, char color) {
+    if (pixel & 1) {
+        vga_data_array[pixel>>1] = (vga_data_array[pixel>>1] & TOPMASK) | (color << 3) ;
+    }
+    else {
+        vga_data_array[pixel>>1] = (vga_data_array[pixel>>1] & BOTTOMMASK) | (color) ;
+    }
+}
+
+// Read one pixel without range checks
+static inline char getPixelUnchecked(const unsigned char *row, int pixel) {
+    return (pixel & 1) ? ((row[pixel>>1] >> 3) & 0x7) : (row[pixel>>1] & 0x7) ;
+}
+
+// Write one pixel if it is on screen, otherwise drop it
+static inline void putPixelClipped(short x, short y, char color) {
+    if (((unsigned short)x < _width) && ((unsigned short)y < _height)) {
+        markDirtyRow(y) ;
+        putPixelUnchecked((_width * y) + x, color) ;
+    }
+}
+
+// Read one pixel, off screen reads as BLACK
+char readPixel(short x, short y) {
+    if (((unsigned short)x >= _width) || ((unsigned short)y >= _height)) return BLACK ;
+    return getPixelUnchecked(vga_data_array, (_width * y) + x) ;
+}
+
+// Clip (x,y,w,h) against the screen. The number of columns/rows removed
+// from the left/top is returned through sx/sy so that callers can offset
+// their source data. Returns 0 if nothing is left to draw.
+static int clipRect(short *x, short *y, short *w, short *h, short *sx, short *sy) {
+    *sx = 0 ;
+    *sy = 0 ;
+    if (*x < 0) { *sx = -*x ; *w += *x ; *x = 0 ; }
+    if (*y < 0) { *sy = -*y ; *h += *y ; *y = 0 ; }
+    if (*x + *w > _width)  *w = _width  - *x ;
+    if (*y + *h > _height) *h = _height - *y ;
+    return (*w > 0) && (*h > 0) ;
+}
+
+void (*volatile vga_blit_hook)(int words) = NULL ;
+
+// Copy n bytes. Large word-aligned copies go through the blitter DMA
+// channel, everything else through memcpy.
+static void copyBytes(unsigned char *dst, const unsigned char *src, int n) {
+#ifndef VGA_HOST
+    if ((n >= BLIT_DMA_MIN) && !(((uintptr_t)dst | (uintptr_t)src | n) & 3)) {
+        dma_channel_set_read_addr(BLIT_DMA_CHAN, src, false) ;
+        dma_channel_set_write_addr(BLIT_DMA_CHAN, dst, false) ;
+        dma_channel_set_trans_count(BLIT_DMA_CHAN, n >> 2, true) ;
+        dma_channel_wait_for_finish_blocking(BLIT_DMA_CHAN) ;
+        if (vga_blit_hook) vga_blit_hook(n >> 2) ;
+        return ;
+    }
+#endif
+    memcpy(dst, src, n) ;
+}
+
+// Fill n pixels of one row starting at pixel index 'pixel'. The bulk of
+// the span is written as aligned 32-bit words.
+static void fillSpan(int pixel, int n, char color) {
+    unsigned char pair = color | (color << 3) ;
+    uint32_t word = pair * 0x01010101u ;
+    unsigned char *p ;
+    int bytes ;
+
+    if (n <= 0) return ;
+    if (pixel & 1) {
+        putPixelUnchecked(pixel++, color) ;
+        if (--n == 0) return ;
+    }
+    p = &vga_data_array[pixel>>1] ;
+    bytes = n >> 1 ;
+    while (bytes && ((uintptr_t)p & 3)) {
+        *p++ = pair ;
+        bytes-- ;
+    }
+    while (bytes >= 4) {
+        *(uint32_t *)p = word ;
+        p += 4 ;
+        bytes -= 4 ;
+    }
+    while (bytes--) {
+        *p++ = pair ;
+    }
+    if (n & 1) putPixelUnchecked(pixel + n - 1, color) ;
+}
+
+// Copy n packed pixels from src (starting at source pixel sp) to the
+// screen (starting at pixel index dp)
+static void copySpan(int dp, const unsigned char *src, int sp, int n) {
+    if (n <= 0) return ;
+    if ((dp & 1) == (sp & 1)) {
+        // Same nibble parity, the middle of the run is a straight byte copy
+        if (dp & 1) {
+            putPixelUnchecked(dp++, getPixelUnchecked(src, sp++)) ;
+            n-- ;
+        }
+        copyBytes(&vga_data_array[dp>>1], &src[sp>>1], n >> 1) ;
+        if (n & 1) putPixelUnchecked(dp + n - 1, getPixelUnchecked(src, sp + n - 1)) ;
+    }
+    else {
+        // Opposite parity, every output byte is spliced from two input bytes
+        if (dp & 1) {
+            putPixelUnchecked(dp++, getPixelUnchecked(src, sp++)) ;
+            n-- ;
+        }
+        // dp is now even and sp is odd
+        unsigned char *d = &vga_data_array[dp>>1] ;
+        const unsigned char *s = &src[sp>>1] ;
+        for (int k = n >> 1; k > 0; k--, s++) {
+            *d++ = ((s[0] >> 3) & 0x7) | ((s[1] & 0x7) << 3) ;
+        }
+        if (n & 1) putPixelUnchecked(dp + n - 1, getPixelUnchecked(src, sp + n - 1)) ;
+    }
+}
+
+// For each combination of two 1-bit pixels (bit 0 = even pixel, bit 1 =
+// odd pixel), the bits of the screen byte to keep and the bits to OR in.
+// bg == color makes clear bits transparent.
+static void buildPairLUT(char color, char bg, unsigned char keep[4], unsigned char val[4]) {
+    for (int b = 0; b < 4; b++) {
+        char c0 = (b & 1) ? color : bg ;
+        char c1 = (b & 2) ? color : bg ;
+        keep[b] = 0xc0 ;
+        val[b] = c0 | (c1 << 3) ;
+        if (bg == color) {
+            if (!(b & 1)) { keep[b] |= 0x07 ; val[b] &= ~0x07 ; }
+            if (!(b & 2)) { keep[b] |= 0x38 ; val[b] &= ~0x38 ; }
+        }
+    }
+}
+
+void blitPacked(short x, short y, short w, short h, const unsigned char *src, short stride) {
+/* Copy a rectangle of packed 3-bit pixels (same layout as the screen,
+ * two pixels per byte, even pixel in the low bits) onto the screen
+ * Parameters:
+ *      x, y:   top-left corner on the screen
+ *      w, h:   size of the rectangle in pixels
+ *      src:    packed source pixels, first pixel of the first row
+ *      stride: bytes between successive source rows
+ * Returns: Nothing
+ */
+  short sx, sy ;
+  if (!clipRect(&x, &y, &w, &h, &sx, &sy)) return ;
+  markDirtyRows(y, y + h - 1) ;
+  src += sy * stride ;
+
+  // Whole screen rows from a matching buffer are one contiguous copy
+  if ((x == 0) && (w == _width) && (stride == (_width >> 1)) && (sx == 0)) {
+    copyBytes(&vga_data_array[(_width * y) >> 1], src, h * stride) ;
+    return ;
+  }
+  for (int j = 0; j < h; j++, src += stride) {
+    copySpan((_width * (y + j)) + x, src, sx, w) ;
+  }
+}
+
+void blitMask(short x, short y, short w, short h, const unsigned char *mask, short stride, char color, char bg) {
+/* Draw a 1-bit mask onto the screen. Set bits are drawn in color, clear
+ * bits in bg. As with drawChar, bg == color leaves clear bits untouched
+ * Parameters:
+ *      x, y:   top-left corner on the screen
+ *      w, h:   size of the mask in pixels
+ *      mask:   1 bit per pixel, most significant bit is leftmost
+ *      stride: bytes between successive mask rows
+ *      color:  3-bit color for set bits
+ *      bg:     3-bit color for clear bits
+ * Returns: Nothing
+ */
+  unsigned char keep[4], val[4] ;
+  char transparent = (bg == color) ;
+  short sx, sy ;
+
+  buildPairLUT(color, bg, keep, val) ;
+  if (!clipRect(&x, &y, &w, &h, &sx, &sy)) return ;
+  markDirtyRows(y, y + h - 1) ;
+  mask += sy * stride ;
+
+  for (int j = 0; j < h; j++, mask += stride) {
+    int dp = (_width * (y + j)) + x ;
+    int sp = sx ;
+    int n = w ;
+    #define MASKBIT(i) ((mask[(i)>>3] >> (7 - ((i) & 7))) & 1)
+    if (dp & 1) {
+      if (MASKBIT(sp)) putPixelUnchecked(dp, color) ;
+      else if (!transparent) putPixelUnchecked(dp, bg) ;
+      dp++ ; sp++ ; n-- ;
+    }
+    unsigned char *d = &vga_data_array[dp>>1] ;
+    for (; n >= 2; n -= 2, sp += 2, d++) {
+      int b = MASKBIT(sp) | (MASKBIT(sp + 1) << 1) ;
+      *d = (*d & keep[b]) | val[b] ;
+    }
+    if (n) {
+      int b = MASKBIT(sp) ;
+      *d = (*d & (keep[b] | 0x38)) | (val[b] & 0x07) ;
+    }
+    #undef MASKBIT
+  }
+}
+
+void scrollRegion(short x, short y, short w, short h, short dy, char fill) {
+/* Scroll a rectangle of the screen vertically, filling the rows that
+ * are uncovered with a solid color
+ * Parameters:
+ *      x, y:   top-left corner of the region
+ *      w, h:   size of the region in pixels
+ *      dy:     rows to move the contents by; positive moves down,
+ *              negative moves up
+ *      fill:   3-bit color for the uncovered rows
+ * Returns: Nothing
+ */
+  short sx, sy ;
+  if (!clipRect(&x, &y, &w, &h, &sx, &sy)) return ;
+  if (dy >= h || -dy >= h) {
+    fillRect(x, y, w, h, fill) ;
+    return ;
+  }
+  if (dy == 0) return ;
+  markDirtyRows(y, y + h - 1) ;
+
+  // Moving up copies rows top to bottom, moving down bottom to top
+  int rows = h - abs(dy) ;
+  int step = (dy < 0) ? 1 : -1 ;
+  int dst = (dy < 0) ? y : y + h - 1 ;
+  if ((x == 0) && (w == _width)) {
+    // Full width rows are contiguous. DMA copies in ascending order, so
+    // it is only safe for the upward (dst below src) direction.
+    unsigned char *d = &vga_data_array[(_width * ((dy < 0) ? y : y + dy)) >> 1] ;
+    unsigned char *s = &vga_data_array[(_width * ((dy < 0) ? y - dy : y)) >> 1] ;
+    if (dy < 0) copyBytes(d, s, rows * (_width >> 1)) ;
+    else memmove(d, s, rows * (_width >> 1)) ;
+  }
+  else {
+    for (int j = 0; j < rows; j++, dst += step) {
+      int dp = (_width * dst) + x ;
+      int sp = (_width * (dst - dy)) + x ;
+      // Source and destination share x, so the parity always matches
+      copySpan(dp, vga_data_array, sp, w) ;
+    }
+  }
+  for (int j = 0; j < abs(dy); j++) {
+    fillSpan((_width * ((dy < 0) ? (y + h - 1 - j) : (y + j))) + x, w, fill) ;
+  }
+}
+
 // VGA routine to draw a cell
 void drawCell(short x, short y, char color) {
 
@@ -180,6 +487,8 @@ void drawCell(short x, short y, char color) {
 
     vga_data_array[pixel>>1] = (color | (color<<3)) ;
     vga_data_array[(pixel+640)>>1] = (color | (color<<3)) ;
+    markDirtyRow(y<<1) ;
+    markDirtyRow((y<<1)+1) ;
 
 }
 
@@ -202,15 +511,25 @@ int isAlive(short x, short y) {
 
 
 void drawVLine(short x, short y, short h, char color) {
-    for (short i=y; i<(y+h); i++) {
-        drawPixel(x, i, color) ;
+    short w = 1, sx, sy ;
+    if (!clipRect(&x, &y, &w, &h, &sx, &sy)) return ;
+    markDirtyRows(y, y + h - 1) ;
+
+    // Walk down one column: the nibble parity never changes
+    unsigned char *d = &vga_data_array[((_width * y) + x) >> 1] ;
+    if (x & 1) {
+        for (; h > 0; h--, d += (_width >> 1)) *d = (*d & TOPMASK) | (color << 3) ;
+    }
+    else {
+        for (; h > 0; h--, d += (_width >> 1)) *d = (*d & BOTTOMMASK) | color ;
     }
 }
 
 void drawHLine(short x, short y, short w, char color) {
-    for (short i=x; i<(x+w); i++) {
-        drawPixel(i, y, color) ;
-    }
+    short h = 1, sx, sy ;
+    if (!clipRect(&x, &y, &w, &h, &sx, &sy)) return ;
+    markDirtyRow(y) ;
+    fillSpan((_width * y) + x, w, color) ;
 }
 
 // Bresenham's algorithm - thx wikipedia and thx Bruce!
@@ -227,42 +546,97 @@ void drawLine(short x0, short y0, short x1, short y1, char color) {
  *          the top-left of the screen is 0. It increases to the bottom.
  *      color: 3-bit color value for line
  */
-      short steep = abs(y1 - y0) > abs(x1 - x0);
-      if (steep) {
-        swap(x0, y0);
-        swap(x1, y1);
-      }
-
-      if (x0 > x1) {
-        swap(x0, x1);
-        swap(y0, y1);
-      }
-
-      short dx, dy;
-      dx = x1 - x0;
-      dy = abs(y1 - y0);
-
-      short err = dx / 2;
-      short ystep;
-
-      if (y0 < y1) {
-        ystep = 1;
-      } else {
-        ystep = -1;
+  // Bresenham with the longer (major) axis as 'a' and the other as 'b'.
+  // The endpoints are normalized exactly as in the classic version so the
+  // same pixels come out, then the line is clipped to the screen once by
+  // working out which steps land on screen.
+  int steep = abs(y1 - y0) > abs(x1 - x0);
+  int a0 = steep ? y0 : x0, b0 = steep ? x0 : y0 ;
+  int a1 = steep ? y1 : x1, b1 = steep ? x1 : y1 ;
+  if (a0 > a1) {
+    int t ;
+    t = a0 ; a0 = a1 ; a1 = t ;
+    t = b0 ; b0 = b1 ; b1 = t ;
+  }
+  int da = a1 - a0 ;
+  int db = abs(b1 - b0) ;
+  int bstep = (b0 < b1) ? 1 : -1 ;
+  int e0 = da / 2 ;
+  int amax = steep ? (_height - 1) : (_width - 1) ;
+  int bmax = steep ? (_width - 1) : (_height - 1) ;
+
+  // After k steps the pixel is (a0 + k, b0 + bstep*m(k)) with
+  // m(k) = ceil((k*db - e0) / da). Find the steps [klo, khi] where both
+  // a and b are on screen.
+  int klo = (a0 < 0) ? -a0 : 0 ;
+  int khi = (a1 > amax) ? (amax - a0) : da ;
+  int mlo = (bstep > 0) ? -b0 : (b0 - bmax) ;
+  int mhi = (bstep > 0) ? (bmax - b0) : b0 ;
+  if (mlo < 0) mlo = 0 ;
+  if (mhi < 0) return ;
+  if (db == 0) {
+    if (mlo > 0) return ;
+  }
+  else {
+    if (mlo > 0) {
+      int k = (((mlo - 1) * da) + e0) / db + 1 ;
+      if (k > klo) klo = k ;
+    }
+    int k = ((mhi * da) + e0) / db ;
+    if (k < khi) khi = k ;
+  }
+  if (klo > khi) return ;
+
+  // Bresenham state at step klo
+  int m = (da > 0) ? ((klo * db) - e0 + da - 1) / da : 0 ;
+  int err = e0 - (klo * db) + (m * da) ;
+  int a = a0 + klo ;
+  int b = b0 + (bstep * m) ;
+  int n = khi - klo + 1 ;
+
+  if (!steep) {
+    // Shallow line: every run of pixels on one row is a horizontal span
+    int mend = (da > 0) ? ((khi * db) - e0 + da - 1) / da : 0 ;
+    int bend = b0 + (bstep * mend) ;
+    markDirtyRows((b < bend) ? b : bend, (b < bend) ? bend : b) ;
+    int start = (_width * b) + a ;
+    int len = 0 ;
+    while (n--) {
+      len++ ;
+      err -= db ;
+      if (err < 0) {
+        err += da ;
+        fillSpan(start, len, color) ;
+        start += len + (bstep * _width) ;
+        len = 0 ;
       }
-
-      for (; x0<=x1; x0++) {
-        if (steep) {
-          drawPixel(y0, x0, color);
-        } else {
-          drawPixel(x0, y0, color);
+    }
+    if (len) fillSpan(start, len, color) ;
+  }
+  else {
+    // Steep line: step down the rows with a byte pointer, moving one
+    // nibble left or right on each minor step
+    markDirtyRows(a, a + n - 1) ;
+    unsigned char *d = &vga_data_array[((_width * a) + b) >> 1] ;
+    int odd = b & 1 ;
+    while (n--) {
+      if (odd) *d = (*d & TOPMASK) | (color << 3) ;
+      else *d = (*d & BOTTOMMASK) | color ;
+      d += (_width >> 1) ;
+      err -= db ;
+      if (err < 0) {
+        err += da ;
+        if (bstep > 0) {
+          if (odd) d++ ;
+          odd ^= 1 ;
         }
-        err -= dy;
-        if (err < 0) {
-          y0 += ystep;
-          err += dx;
+        else {
+          if (!odd) d-- ;
+          odd ^= 1 ;
         }
       }
+    }
+  }
 }
 
 // Draw a rectangle
@@ -285,6 +659,17 @@ void drawRect(short x, short y, short w, short h, char color) {
   drawVLine(x+w-1, y, h, color);
 }
 
+// Is the whole circle (x0,y0,r) on screen?
+static inline char circleInside(short x0, short y0, short r) {
+  return (r >= 0) && (x0 - r >= 0) && (x0 + r < _width) && (y0 - r >= 0) && (y0 + r < _height);
+}
+
+// Plot one circle point, 'inside' and 'color' come from the caller
+#define CIRCLE_PLOT(px, py) do { \
+    if (inside) putPixelUnchecked((_width * (py)) + (px), color); \
+    else putPixelClipped((px), (py), color); \
+  } while (0)
+
 void drawCircle(short x0, short y0, short r, char color) {
 /* Draw a circle outline with center (x0,y0) and radius r, with given color
  * Parameters:
@@ -303,10 +688,15 @@ void drawCircle(short x0, short y0, short r, char color) {
   short x = 0;
   short y = r;
 
-  drawPixel(x0  , y0+r, color);
-  drawPixel(x0  , y0-r, color);
-  drawPixel(x0+r, y0  , color);
-  drawPixel(x0-r, y0  , color);
+  // Clip once: a circle that is fully on screen skips all range checks,
+  // otherwise points that fall off screen are dropped
+  char inside = circleInside(x0, y0, r);
+  if (inside) markDirtyRows(y0-r, y0+r);
+
+  CIRCLE_PLOT(x0  , y0+r);
+  CIRCLE_PLOT(x0  , y0-r);
+  CIRCLE_PLOT(x0+r, y0  );
+  CIRCLE_PLOT(x0-r, y0  );
 
   while (x<y) {
     if (f >= 0) {
@@ -318,14 +708,14 @@ void drawCircle(short x0, short y0, short r, char color) {
     ddF_x += 2;
     f += ddF_x;
 
-    drawPixel(x0 + x, y0 + y, color);
-    drawPixel(x0 - x, y0 + y, color);
-    drawPixel(x0 + x, y0 - y, color);
-    drawPixel(x0 - x, y0 - y, color);
-    drawPixel(x0 + y, y0 + x, color);
-    drawPixel(x0 - y, y0 + x, color);
-    drawPixel(x0 + y, y0 - x, color);
-    drawPixel(x0 - y, y0 - x, color);
+    CIRCLE_PLOT(x0 + x, y0 + y);
+    CIRCLE_PLOT(x0 - x, y0 + y);
+    CIRCLE_PLOT(x0 + x, y0 - y);
+    CIRCLE_PLOT(x0 - x, y0 - y);
+    CIRCLE_PLOT(x0 + y, y0 + x);
+    CIRCLE_PLOT(x0 - y, y0 + x);
+    CIRCLE_PLOT(x0 + y, y0 - x);
+    CIRCLE_PLOT(x0 - y, y0 - x);
   }
 }
 
@@ -336,6 +726,8 @@ void drawCircleHelper( short x0, short y0, short r, unsigned char cornername, ch
   short ddF_y = -2 * r;
   short x     = 0;
   short y     = r;
+  char inside = circleInside(x0, y0, r);
+  if (inside) markDirtyRows(y0-r, y0+r);
 
   while (x<y) {
     if (f >= 0) {
@@ -347,20 +739,20 @@ void drawCircleHelper( short x0, short y0, short r, unsigned char cornername, ch
     ddF_x += 2;
     f     += ddF_x;
     if (cornername & 0x4) {
-      drawPixel(x0 + x, y0 + y, color);
-      drawPixel(x0 + y, y0 + x, color);
+      CIRCLE_PLOT(x0 + x, y0 + y);
+      CIRCLE_PLOT(x0 + y, y0 + x);
     }
     if (cornername & 0x2) {
-      drawPixel(x0 + x, y0 - y, color);
-      drawPixel(x0 + y, y0 - x, color);
+      CIRCLE_PLOT(x0 + x, y0 - y);
+      CIRCLE_PLOT(x0 + y, y0 - x);
     }
     if (cornername & 0x8) {
-      drawPixel(x0 - y, y0 + x, color);
-      drawPixel(x0 - x, y0 + y, color);
+      CIRCLE_PLOT(x0 - y, y0 + x);
+      CIRCLE_PLOT(x0 - x, y0 + y);
     }
     if (cornername & 0x1) {
-      drawPixel(x0 - y, y0 - x, color);
-      drawPixel(x0 - x, y0 - y, color);
+      CIRCLE_PLOT(x0 - y, y0 - x);
+      CIRCLE_PLOT(x0 - x, y0 - y);
     }
   }
 }
@@ -376,8 +768,46 @@ void fillCircle(short x0, short y0, short r, char color) {
  *      color: 16-bit color value for the circle
  * Returns: Nothing
  */
-  drawVLine(x0, y0-r, 2*r+1, color);
-  fillCircleHelper(x0, y0, r, 3, 0, color);
+  // The classic version draws vertical lines at columns x0+-x (half height
+  // y) and x0+-y (half height x). Collect the half height of every column
+  // offset, then fill the same pixels row by row as horizontal spans.
+  static short half_height[_width];
+  if (r < 0) return;
+  if (r >= _width) {
+    drawVLine(x0, y0-r, 2*r+1, color);
+    fillCircleHelper(x0, y0, r, 3, 0, color);
+    return;
+  }
+
+  short f     = 1 - r;
+  short ddF_x = 1;
+  short ddF_y = -2 * r;
+  short x     = 0;
+  short y     = r;
+
+  memset(half_height, 0xff, (r+1) * sizeof(short));
+  half_height[0] = r;
+  while (x<y) {
+    if (f >= 0) {
+      y--;
+      ddF_y += 2;
+      f     += ddF_y;
+    }
+    x++;
+    ddF_x += 2;
+    f     += ddF_x;
+    if (y > half_height[x]) half_height[x] = y;
+    if (x > half_height[y]) half_height[y] = x;
+  }
+
+  // Half heights shrink away from the center, so each row offset t covers
+  // columns x0-d..x0+d for the largest d with half_height[d] >= t
+  short d = r;
+  for (short t = 0; t <= r; t++) {
+    while (half_height[d] < t) d--;
+    drawHLine(x0-d, y0-t, 2*d+1, color);
+    if (t) drawHLine(x0-d, y0+t, 2*d+1, color);
+  }
 }
 
 void fillCircleHelper(short x0, short y0, short r, unsigned char cornername, short delta, char color) {
@@ -461,18 +891,126 @@ void fillRect(short x, short y, short w, short h, char color) {
  * Returns:     Nothing
  */
 
-  // rudimentary clipping (drawChar w/big text requires this)
-  // if((x >= _width) || (y >= _height)) return;
-  // if((x + w - 1) >= _width)  w = _width  - x;
-  // if((y + h - 1) >= _height) h = _height - y;
+  // clip once, then fill each row as a span
+  short sx, sy;
+  if (!clipRect(&x, &y, &w, &h, &sx, &sy)) return;
+  markDirtyRows(y, y + h - 1);
+
+  for(int j=y; j<(y+h); j++) {
+    fillSpan((_width * j) + x, w, color);
+  }
+}
+
+// ==================================================
+// === Incremental row updates
+// ==================================================
 
-  // tft_setAddrWindow(x, y, x+w-1, y+h-1);
+int isRowDirty(short y) {
+    return (vga_dirty_rows[y>>3] >> (y & 7)) & 1 ;
+}
 
-  for(int i=x; i<(x+w); i++) {
-    for(int j=y; j<(y+h); j++) {
-        drawPixel(i, j, color);
+void clearDirtyRows(short y0, short y1) {
+    for (short y = y0; y <= y1; y++) {
+        vga_dirty_rows[y>>3] &= ~(1 << (y & 7)) ;
     }
-  }
+}
+
+int writeRowIfChanged(short y, const unsigned char *row) {
+/* Write one full row of packed pixels, skipping the write if the row is
+ * the same as the one written last time and nothing has drawn over it
+ * since. Skipped rows keep the scanout DMA from competing with the CPU
+ * for the pixel array.
+ * Parameters:
+ *      y:      screen row, 0-479
+ *      row:    320 bytes of packed pixels, 4-byte aligned
+ * Returns: 1 if the row was written, 0 if it was skipped
+ */
+    const uint32_t *words = (const uint32_t *)row ;
+    uint32_t hash = 2166136261u ;
+    // FNV-1a over words, the row buffer lives outside the pixel array so
+    // hashing it does not touch the memory the scanout is reading
+    for (int i = 0; i < (_width >> 3); i++) {
+        hash = (hash ^ words[i]) * 16777619u ;
+    }
+    if ((hash == vga_row_hash[y]) && !isRowDirty(y)) {
+        vga_rows_skipped++ ;
+        return 0 ;
+    }
+    copyBytes(&vga_data_array[(_width * y) >> 1], row, _width >> 1) ;
+    vga_row_hash[y] = hash ;
+    clearDirtyRows(y, y) ;
+    vga_rows_written++ ;
+    return 1 ;
+}
+
+// ==================================================
+// === Glyph cache
+// ==================================================
+// The font is stored column by column (5 bytes per character). For fast
+// text it is transposed once into 8 rows of 6-bit masks per character
+// (bit i = column i, column 5 is the blank spacing column). A row is then
+// expanded to packed pixels for the current color pair through a 4-entry
+// LUT, one screen byte (two pixels) per lookup.
+static unsigned char glyph_rows[256][8] ;
+static char glyph_rows_ready = 0 ;
+
+// Color pair the text LUT was last built for
+static char text_lut_color = -1, text_lut_bg = -1 ;
+static unsigned char text_keep[4], text_val[4] ;
+
+static void buildGlyphCache(void) {
+    for (int c = 0; c < 256; c++) {
+        for (int j = 0; j < 8; j++) {
+            unsigned char row = 0 ;
+            for (int i = 0; i < 5; i++) {
+                if (pgm_read_byte(font+(c*5)+i) & (1 << j)) row |= (1 << i) ;
+            }
+            glyph_rows[c][j] = row ;
+        }
+    }
+    glyph_rows_ready = 1 ;
+}
+
+// Draw a size 1 character that is known to be fully on screen. Each glyph
+// row is written as whole bytes with masked stores.
+static void drawCharFast(short x, short y, unsigned char c, char color, char bg) {
+    if (!glyph_rows_ready) buildGlyphCache() ;
+    if ((color != text_lut_color) || (bg != text_lut_bg)) {
+        buildPairLUT(color, bg, text_keep, text_val) ;
+        text_lut_color = color ;
+        text_lut_bg = bg ;
+    }
+    const unsigned char *rows = glyph_rows[c] ;
+    markDirtyRows(y, y + 7) ;
+    unsigned char *d = &vga_data_array[((_width * y) + x) >> 1] ;
+
+    if (!(x & 1)) {
+        // Even x: 6 pixels are exactly 3 bytes
+        for (int j = 0; j < 8; j++, d += (_width >> 1)) {
+            unsigned char r = rows[j] ;
+            d[0] = (d[0] & text_keep[r & 3]) | text_val[r & 3] ;
+            d[1] = (d[1] & text_keep[(r >> 2) & 3]) | text_val[(r >> 2) & 3] ;
+            d[2] = (d[2] & text_keep[(r >> 4) & 3]) | text_val[(r >> 4) & 3] ;
+        }
+    }
+    else {
+        // Odd x: half a byte, two full bytes, half a byte. Shifting the row
+        // left by one puts column 0 in the odd half of the first byte.
+        for (int j = 0; j < 8; j++, d += (_width >> 1)) {
+            unsigned int r = rows[j] << 1 ;
+            d[0] = (d[0] & (text_keep[r & 3] | 0x07)) | (text_val[r & 3] & 0x38) ;
+            d[1] = (d[1] & text_keep[(r >> 2) & 3]) | text_val[(r >> 2) & 3] ;
+            d[2] = (d[2] & text_keep[(r >> 4) & 3]) | text_val[(r >> 4) & 3] ;
+            d[3] = (d[3] & (text_keep[(r >> 6) & 3] | 0x38)) | (text_val[(r >> 6) & 3] & 0x07) ;
+        }
+    }
+}
+
+// The 5 column bytes of c in the 5x7 font, bit 0 at the top. For code
+// that renders text somewhere other than the screen, so the font is only
+// in flash once.
+const unsigned char *fontGlyph(unsigned char c) {
+    return &font[c * 5] ;
 }
 
 // Draw a character
@@ -484,6 +1022,12 @@ void drawChar(short x, short y, unsigned char c, char color, char bg, unsigned c
      ((y + 8 * size - 1) < 0))   // Clip top
     return;
 
+  // Fully visible default size text goes through the glyph cache
+  if ((size == 1) && (x >= 0) && (y >= 0) && (x + 6 <= _width) && (y + 8 <= _height)) {
+    drawCharFast(x, y, c, color, bg);
+    return;
+  }
+
   for (i=0; i<6; i++ ) {
     unsigned char line;
     if (i == 5)
@@ -580,4 +1124,52 @@ inline void writeString(char* str){
     while (*str){
         tft_write(*str++);
     }
+}
+
+void writeStringN(char* str, int len){
+/* Print at most len characters of str onto screen
+ * Call tft_setCursor(), tft_setTextColor(), tft_setTextSize()
+ *  as necessary before printing
+ */
+    while (len-- > 0 && *str){
+        tft_write(*str++);
+    }
+}
+
+void initTextLine(text_line *line, short x, short y, unsigned char len, unsigned char size, char color, char bg){
+/* Set up a fixed position line of text that only redraws the characters
+ * that change between updates
+ * Parameters:
+ *      line:   text line to set up
+ *      x, y:   top-left of the first character
+ *      len:    number of character cells (at most TEXT_LINE_MAX)
+ *      size:   text size (1 being smallest)
+ *      color:  3-bit text color
+ *      bg:     3-bit background color. Must differ from color, since
+ *              a transparent background cannot erase the old character
+ */
+    line->x = x;
+    line->y = y;
+    line->len = (len > TEXT_LINE_MAX) ? TEXT_LINE_MAX : len;
+    line->size = (size > 0) ? size : 1;
+    line->color = color;
+    line->bg = bg;
+    // 0 is never stored by updateTextLine, so every cell starts dirty
+    memset(line->cells, 0, TEXT_LINE_MAX);
+}
+
+int updateTextLine(text_line *line, const char *str){
+/* Draw str into a text line. Cells past the end of str are blanked.
+ * Returns: the number of characters that were redrawn
+ */
+    int redrawn = 0;
+    for (int i = 0; i < line->len; i++) {
+        char c = *str ? *str++ : ' ';
+        if (line->cells[i] != c) {
+            drawChar(line->x + i*6*line->size, line->y, c, line->color, line->bg, line->size);
+            line->cells[i] = c;
+            redrawn++;
+        }
+    }
+    return redrawn;
 }
\ No newline at end of file
@@ -31,6 +31,7 @@ enum colors {BLACK, RED, GREEN, YELLOW, BLUE, MAGENTA, CYAN, WHITE} ;
 // VGA primitives - usable in main
 void initVGA(void) ;
 void drawPixel(short x, short y, char color) ;
+char readPixel(short x, short y) ;
 
 // Augmentations
 void drawCell(short x, short y, char color) ;
@@ -48,11 +49,43 @@ void fillCircleHelper(short x0, short y0, short r, unsigned char cornername, sho
 void drawRoundRect(short x, short y, short w, short h, short r, char color) ;
 void fillRoundRect(short x, short y, short w, short h, short r, char color) ;
 void fillRect(short x, short y, short w, short h, char color) ;
+
+// Blitter - clips once per call, then writes the pixel array directly
+void blitPacked(short x, short y, short w, short h, const unsigned char *src, short stride) ;
+void blitMask(short x, short y, short w, short h, const unsigned char *mask, short stride, char color, char bg) ;
+void scrollRegion(short x, short y, short w, short h, short dy, char fill) ;
 void drawChar(short x, short y, unsigned char c, char color, char bg, unsigned char size) ;
+const unsigned char *fontGlyph(unsigned char c) ;
 void setCursor(short x, short y);
 void setTextColor(char c);
 void setTextColor2(char c, char bg);
 void setTextSize(unsigned char s);
 void setTextWrap(char w);
 void tft_write(unsigned char c) ;
-void writeString(char* str) ;
\ No newline at end of file
+void writeString(char* str) ;
+void writeStringN(char* str, int len) ;
+
+// Packed pixels being scanned out, 320 bytes per row (read only for users)
+extern unsigned char vga_data_array[] ;
+
+// Called after every blitter DMA copy with its length in words, if set
+extern void (*volatile vga_blit_hook)(int words) ;
+
+// Dirty row tracking and incremental updates
+extern unsigned int vga_rows_written ;
+extern unsigned int vga_rows_skipped ;
+int isRowDirty(short y) ;
+void markDirtyRows(short y0, short y1) ;
+void clearDirtyRows(short y0, short y1) ;
+int writeRowIfChanged(short y, const unsigned char *row) ;
+
+// Fixed position text that only redraws the characters that changed
+#define TEXT_LINE_MAX 64
+typedef struct {
+    short x, y ;
+    unsigned char len, size ;
+    char color, bg ;
+    char cells[TEXT_LINE_MAX] ;
+} text_line ;
+void initTextLine(text_line *line, short x, short y, unsigned char len, unsigned char size, char color, char bg) ;
+int updateTextLine(text_line *line, const char *str) ;
@@ -0,0 +1,245 @@
+/**
+ * ArduCAM OV5642 board simulator, see arduchip_sim.h
+ */
+
+#include <string.h>
+#include "arduchip_sim.h"
+
+// ArduChip registers and commands, as in ArduCAM.h
+#define REG_TEST1 0x00
+#define REG_FIFO 0x04
+#define FIFO_CLEAR 0x01
+#define FIFO_START 0x02
+#define FIFO_RDPTR_RST 0x10
+#define FIFO_WRPTR_RST 0x20
+#define BURST_READ 0x3C
+#define SINGLE_READ 0x3D
+#define REG_REV 0x40
+#define REG_TRIG 0x41
+#define CAP_DONE 0x08
+#define REG_SIZE1 0x42
+#define REG_SIZE2 0x43
+#define REG_SIZE3 0x44
+#define WRITE_BIT 0x80
+
+// OV5642 registers
+#define OV_SYSTEM_CTRL 0x3008
+#define OV_SOFT_RESET 0x80
+#define OV_CHIPID_HIGH 0x300A
+#define OV_CHIPID_LOW 0x300B
+
+// What the bytes of an SPI transaction do
+enum {
+    SPI_COMMAND,                // next byte is a command
+    SPI_WRITE,                  // next byte is written to addr
+    SPI_READ,                   // reads return register addr
+    SPI_SINGLE,                 // one FIFO byte, repeated
+    SPI_BURST,                  // FIFO bytes in turn
+    SPI_DONE                    // ignore the rest
+} ;
+
+static void sensorReset(arduchip_sim *s) {
+    memset(s->sensor, 0, sizeof(s->sensor)) ;
+    s->sensor[OV_CHIPID_HIGH] = 0x56 ;
+    s->sensor[OV_CHIPID_LOW] = 0x42 ;
+    s->sensor_ptr = 0 ;
+}
+
+void arduSimInit(arduchip_sim *s, uint32_t spi_hz) {
+    memset(s, 0, sizeof(*s)) ;
+    s->spi_hz = spi_hz ;
+    s->i2c_hz = 100000 ;
+    s->cs_ns = 1000 ;
+    s->frame_us = 33333 ;
+    s->regs[REG_REV] = 0x73 ;
+    sensorReset(s) ;
+}
+
+void arduSimFrames(arduchip_sim *s, const uint8_t *frames, uint32_t frame_bytes, int n_frames) {
+    s->frames = frames ;
+    s->frame_bytes = frame_bytes ;
+    s->n_frames = n_frames ;
+    s->next_frame = 0 ;
+}
+
+void arduSimClearCounters(arduchip_sim *s) {
+    s->spi_ns = s->i2c_ns = s->delay_ns = 0 ;
+    s->spi_transactions = 0 ;
+    s->spi_bytes = s->fifo_bytes = 0 ;
+    s->fifo_overruns = 0 ;
+    s->reg_reads = s->reg_writes = 0 ;
+    s->i2c_transactions = 0 ;
+    s->i2c_bytes = 0 ;
+    s->i2c_nacks = 0 ;
+    s->captures = 0 ;
+}
+
+static void advance(arduchip_sim *s, uint64_t ns) {
+    s->now_ns += ns ;
+}
+
+// Finish the capture in progress once the clock reaches it
+static void updateCapture(arduchip_sim *s) {
+    if (!s->capturing || s->now_ns < s->done_ns) return ;
+    s->capturing = 0 ;
+    s->captures++ ;
+    if (s->n_frames > 0) {
+        s->fifo = &s->frames[(uint64_t)s->next_frame * s->frame_bytes] ;
+        s->fifo_len = s->frame_bytes ;
+        s->next_frame = (s->next_frame + 1) % s->n_frames ;
+    }
+    else {
+        s->fifo = NULL ;
+        s->fifo_len = 0 ;
+    }
+    s->fifo_pos = 0 ;
+    s->regs[REG_TRIG] |= CAP_DONE ;
+}
+
+static uint8_t readReg(arduchip_sim *s, uint8_t addr) {
+    updateCapture(s) ;
+    s->reg_reads++ ;
+    switch (addr) {
+        case REG_SIZE1: return s->fifo_len & 0xff ;
+        case REG_SIZE2: return (s->fifo_len >> 8) & 0xff ;
+        case REG_SIZE3: return (s->fifo_len >> 16) & 0x7f ;
+        default: return s->regs[addr] ;
+    }
+}
+
+static void writeReg(arduchip_sim *s, uint8_t addr, uint8_t value) {
+    s->reg_writes++ ;
+    if (addr != REG_FIFO) {
+        if (addr != REG_REV && addr != REG_TRIG) s->regs[addr] = value ;
+        return ;
+    }
+    // FIFO control bits act and don't stay set
+    if (value & FIFO_CLEAR) s->regs[REG_TRIG] &= ~CAP_DONE ;
+    if (value & FIFO_RDPTR_RST) s->fifo_pos = 0 ;
+    if (value & FIFO_WRPTR_RST) s->fifo_len = 0 ;
+    if (value & FIFO_START) {
+        s->capturing = 1 ;
+        s->done_ns = s->now_ns + (uint64_t)s->frame_us * 1000 ;
+    }
+}
+
+static uint8_t fifoByte(arduchip_sim *s) {
+    if (!s->fifo || s->fifo_pos >= s->fifo_len) {
+        s->fifo_overruns++ ;
+        return 0 ;
+    }
+    s->fifo_bytes++ ;
+    return s->fifo[s->fifo_pos++] ;
+}
+
+static void simSelect(void *ctx, int selected) {
+    arduchip_sim *s = (arduchip_sim *)ctx ;
+    if (selected && !s->selected) {
+        s->spi_transactions++ ;
+        s->spi_ns += s->cs_ns ;
+        advance(s, s->cs_ns) ;
+    }
+    // a new transaction starts with a command, even if select repeats
+    if (selected) s->state = SPI_COMMAND ;
+    s->selected = selected ;
+}
+
+static void simSpi(void *ctx, const uint8_t *tx, int tx_len, uint8_t *rx, int rx_len) {
+    arduchip_sim *s = (arduchip_sim *)ctx ;
+    uint64_t ns = (uint64_t)(tx_len + rx_len) * 8 * 1000000000ull / s->spi_hz ;
+    s->spi_bytes += tx_len + rx_len ;
+    s->spi_ns += ns ;
+    advance(s, ns) ;
+
+    for (int i = 0; i < tx_len; i++) {
+        uint8_t b = tx[i] ;
+        if (s->state == SPI_COMMAND) {
+            if (b & WRITE_BIT) {
+                s->addr = b & 0x7f ;
+                s->state = SPI_WRITE ;
+            }
+            else if (b == BURST_READ) s->state = SPI_BURST ;
+            else if (b == SINGLE_READ) s->state = SPI_SINGLE ;
+            else {
+                s->addr = b ;
+                s->state = SPI_READ ;
+            }
+        }
+        else if (s->state == SPI_WRITE) {
+            writeReg(s, s->addr, b) ;
+            s->state = SPI_DONE ;
+        }
+    }
+
+    if (rx_len && s->state == SPI_SINGLE) {
+        uint8_t b = fifoByte(s) ;
+        memset(rx, b, rx_len) ;
+        s->state = SPI_DONE ;
+    }
+    else if (s->state == SPI_BURST) {
+        for (int i = 0; i < rx_len; i++) rx[i] = fifoByte(s) ;
+    }
+    else if (rx_len && s->state == SPI_READ) {
+        memset(rx, readReg(s, s->addr), rx_len) ;
+    }
+    else if (rx_len) memset(rx, 0, rx_len) ;
+}
+
+// Start, address byte, len bytes and stop
+static void i2cTime(arduchip_sim *s, int len) {
+    uint64_t ns = ((uint64_t)(len + 1) * 9 + 2) * 1000000000ull / s->i2c_hz ;
+    s->i2c_transactions++ ;
+    s->i2c_bytes += len + 1 ;
+    s->i2c_ns += ns ;
+    advance(s, ns) ;
+}
+
+static int simI2cWrite(void *ctx, uint8_t addr, const uint8_t *buf, int len, int nostop) {
+    arduchip_sim *s = (arduchip_sim *)ctx ;
+    (void)nostop ;
+    if (addr != SIM_SENSOR_ADDR) {
+        i2cTime(s, 0) ;
+        s->i2c_nacks++ ;
+        return -1 ;
+    }
+    i2cTime(s, len) ;
+    // 16 bit register address, then data from there on
+    if (len >= 1) s->sensor_ptr = buf[0] ;
+    if (len >= 2) s->sensor_ptr = (buf[0] << 8) | buf[1] ;
+    for (int i = 2; i < len; i++) {
+        if (s->sensor_ptr == OV_SYSTEM_CTRL && (buf[i] & OV_SOFT_RESET)) {
+            sensorReset(s) ;
+            continue ;
+        }
+        if (s->sensor_ptr != OV_CHIPID_HIGH && s->sensor_ptr != OV_CHIPID_LOW) s->sensor[s->sensor_ptr] = buf[i] ;
+        s->sensor_ptr++ ;
+    }
+    return len ;
+}
+
+static int simI2cRead(void *ctx, uint8_t addr, uint8_t *buf, int len) {
+    arduchip_sim *s = (arduchip_sim *)ctx ;
+    if (addr != SIM_SENSOR_ADDR) {
+        i2cTime(s, 0) ;
+        s->i2c_nacks++ ;
+        return -1 ;
+    }
+    i2cTime(s, len) ;
+    for (int i = 0; i < len; i++) buf[i] = s->sensor[s->sensor_ptr++] ;
+    return len ;
+}
+
+static void simDelay(void *ctx, uint32_t ms) {
+    arduchip_sim *s = (arduchip_sim *)ctx ;
+    s->delay_ns += (uint64_t)ms * 1000000 ;
+    advance(s, (uint64_t)ms * 1000000) ;
+}
+
+void arduSimTransport(arduchip_sim *s, cam_transport *t) {
+    t->ctx = s ;
+    t->select = simSelect ;
+    t->spi = simSpi ;
+    t->i2c_write = simI2cWrite ;
+    t->i2c_read = simI2cRead ;
+    t->delay_ms = simDelay ;
+}
@@ -0,0 +1,94 @@
+/**
+ * arduchip_sim: an ArduCAM OV5642 board on the host
+ *
+ * A cam_transport (cam_vga/ArduCAM/cam_transport.h) that answers the
+ * ArduCAM driver the way the board does, so the camera's bring-up and
+ * capture sequence run on the host:
+ *
+ *  - ArduChip registers over SPI. TEST1 and the others read back what was
+ *    written. Writing FIFO_CLEAR_MASK to ARDUCHIP_FIFO clears CAP_DONE,
+ *    FIFO_START_MASK starts a capture that is done frame_us later on the
+ *    modelled clock, FIFO_RDPTR_RST_MASK rewinds the read pointer.
+ *    ARDUCHIP_TRIG has CAP_DONE_MASK set once a capture is done and
+ *    FIFO_SIZE1..3 give its length. Single (SINGLE_FIFO_READ) and burst
+ *    (BURST_FIFO_READ) reads return the frame a byte at a time; zeros
+ *    past the end are counted as overruns.
+ *  - OV5642 registers over I2C at 0x3C with 16 bit register addresses:
+ *    a plain register file, chip ID 0x5642 at 0x300A/0x300B, cleared by
+ *    a soft reset (bit 7 of 0x3008). Other addresses don't answer.
+ *  - Counters of transactions and bytes on both buses, and a modelled
+ *    clock: 8 SPI clocks per byte at spi_hz plus cs_ns per transaction,
+ *    9 I2C clocks per byte (address byte included) plus 2 for start and
+ *    stop at i2c_hz, and every delay its length. Captures finish on this
+ *    clock, so polling for CAP_DONE costs what it would on the board.
+ *
+ * Each capture takes the next of the caller's frames, in turn. Sensor
+ * settings have no effect on them.
+ *
+ * Plain C with no pico dependencies.
+ */
+
+#ifndef ARDUCHIP_SIM_H
+#define ARDUCHIP_SIM_H
+
+#include <stdint.h>
+#include "cam_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIM_SENSOR_ADDR 0x3C
+
+typedef struct {
+    // settings
+    uint32_t spi_hz ;
+    uint32_t i2c_hz ;
+    uint32_t cs_ns ;            // chip select and call overhead per SPI transaction
+    uint32_t frame_us ;         // start of capture to CAP_DONE
+    const uint8_t *frames ;     // n_frames of frame_bytes, back to back
+    uint32_t frame_bytes ;
+    int n_frames ;
+    // ArduChip
+    uint8_t regs[0x80] ;
+    int capturing ;
+    uint64_t done_ns ;          // when the capture in progress is done
+    const uint8_t *fifo ;       // frame in the FIFO, NULL for none
+    uint32_t fifo_len, fifo_pos ;
+    int next_frame ;
+    // SPI transaction in progress
+    int selected ;
+    int state ;
+    uint8_t addr ;
+    // OV5642
+    uint8_t sensor[65536] ;
+    uint16_t sensor_ptr ;
+    // modelled clock and counters
+    uint64_t now_ns ;
+    uint64_t spi_ns, i2c_ns, delay_ns ;
+    uint32_t spi_transactions ;
+    uint64_t spi_bytes ;
+    uint64_t fifo_bytes ;
+    uint32_t fifo_overruns ;
+    uint32_t reg_reads, reg_writes ;
+    uint32_t i2c_transactions ;
+    uint64_t i2c_bytes ;
+    uint32_t i2c_nacks ;
+    uint32_t captures ;
+} arduchip_sim ;
+
+// Power on, with an SPI clock of spi_hz and the other settings defaulted
+// (100 kHz I2C, 1 us per transaction, 30 frames per second)
+void arduSimInit(arduchip_sim *s, uint32_t spi_hz) ;
+// Frames captures return, kept by the caller
+void arduSimFrames(arduchip_sim *s, const uint8_t *frames, uint32_t frame_bytes, int n_frames) ;
+// Fill t with the transport of s
+void arduSimTransport(arduchip_sim *s, cam_transport *t) ;
+// Zero the counters, the modelled clock keeps running
+void arduSimClearCounters(arduchip_sim *s) ;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
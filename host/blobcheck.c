@@ -0,0 +1,240 @@
+/**
+ * blobcheck: the streaming blob labeller against a flood fill reference
+ *
+ *   blobcheck [-s seed]
+ *
+ * Feeds masks to blob.c a row at a time, top down and bottom up as the
+ * camera does with the image flipped, and compares the blobs of each
+ * frame with the 8-connected components a flood fill finds in the whole
+ * mask. Masks are speckle, discs, rings, combs and staircases (which
+ * only join through corners and merge many labels into one), with and
+ * without rows skipped, which must close every blob as an empty row
+ * would. Checks:
+ *
+ *  - area, bounding box and raw moments of every blob reported
+ *  - nothing below the minimum area, and as many blobs as there are
+ *    components, up to BLOB_MAX_OUT, keeping the largest
+ *  - no run, label or blob overflow where the mask stays within limits
+ *  - blobEndFrame forgets the last frame
+ *
+ * Exits 1 on the first difference.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "blob.h"
+
+#define WIDTH 640
+#define HEIGHT 240
+#define KINDS 6
+
+static uint8_t in[HEIGHT][WIDTH] ;
+static int label[HEIGHT][WIDTH] ;
+static blob_stats ref[WIDTH * HEIGHT] ;
+static int n_ref ;
+static int stack[WIDTH * HEIGHT][2] ;
+
+static const char *const kind_names[] = { "speckle", "discs", "rings", "combs", "staircases", "full" } ;
+
+static void disc(int cx, int cy, int r, int hole) {
+    for (int y = cy - r; y <= cy + r; y++) {
+        for (int x = cx - r; x <= cx + r; x++) {
+            int d = (x - cx) * (x - cx) + (y - cy) * (y - cy) ;
+            if (y >= 0 && y < HEIGHT && x >= 0 && x < WIDTH && d <= r * r && d >= hole * hole) in[y][x] = 1 ;
+        }
+    }
+}
+
+static void makeMask(int kind) {
+    memset(in, 0, sizeof(in)) ;
+    switch (kind) {
+        case 0:                 // speckle, many small components
+            for (int y = 0; y < HEIGHT; y++) {
+                for (int x = 0; x < WIDTH; x++) in[y][x] = rand() % 14 == 0 ;
+            }
+            break ;
+        case 1:                 // discs, some touching and across the edges
+            for (int b = 0; b < 25; b++) disc(rand() % (WIDTH + 40) - 20, rand() % (HEIGHT + 40) - 20, 3 + rand() % 30, 0) ;
+            break ;
+        case 2:                 // rings, open at both ends in either direction
+            for (int b = 0; b < 12; b++) {
+                int r = 10 + rand() % 40 ;
+                disc(rand() % WIDTH, rand() % HEIGHT, r, r - 2 - rand() % 5) ;
+            }
+            break ;
+        case 3:                 // combs: teeth that only join at the back
+            for (int c = 0; c < 6; c++) {
+                int x0 = c * 100 + 5, top = c & 1 ;
+                for (int y = 20; y < 220; y++) {
+                    for (int x = x0; x < x0 + 90; x++) {
+                        int back = top ? y < 26 : y >= 214 ;
+                        if (back || (x - x0) % 6 < 2) in[y][x] = 1 ;
+                    }
+                }
+            }
+            break ;
+        case 4:                 // staircases joined only through corners
+            for (int s = 0; s < 8; s++) {
+                int x = rand() % WIDTH, y = rand() % HEIGHT, dx = rand() & 1 ? 1 : -1 ;
+                for (int i = 0; i < 150 && x >= 0 && x < WIDTH && y < HEIGHT; i++, x += dx, y++) in[y][x] = 1 ;
+            }
+            break ;
+        default:                // one blob filling the frame, with holes
+            memset(in, 1, sizeof(in)) ;
+            for (int h = 0; h < 40; h++) in[rand() % HEIGHT][rand() % WIDTH] = 0 ;
+            break ;
+    }
+}
+
+static void refAdd(blob_stats *s, int x, int y) {
+    if (x < s->x0) s->x0 = x ;
+    if (x > s->x1) s->x1 = x ;
+    if (y < s->y0) s->y0 = y ;
+    if (y > s->y1) s->y1 = y ;
+    s->area++ ;
+    s->sum_x += x ;
+    s->sum_y += y ;
+    s->sum_xx += (uint64_t)x * x ;
+    s->sum_yy += (uint64_t)y * y ;
+    s->sum_xy += (uint64_t)x * y ;
+}
+
+// Components of in[] with the rows in skip[] cleared
+static void refLabel(const uint8_t *skip) {
+    memset(label, 0, sizeof(label)) ;
+    n_ref = 0 ;
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            if (!in[y][x] || skip[y] || label[y][x]) continue ;
+            blob_stats *s = &ref[n_ref++] ;
+            memset(s, 0, sizeof(*s)) ;
+            s->x0 = s->y0 = 0x7fff ;
+            s->x1 = s->y1 = -1 ;
+            int n = 0 ;
+            label[y][x] = n_ref ;
+            stack[n][0] = x ;
+            stack[n++][1] = y ;
+            while (n) {
+                n-- ;
+                int px = stack[n][0], py = stack[n][1] ;
+                refAdd(s, px, py) ;
+                for (int dy = -1; dy <= 1; dy++) {
+                    for (int dx = -1; dx <= 1; dx++) {
+                        int qx = px + dx, qy = py + dy ;
+                        if (qx < 0 || qx >= WIDTH || qy < 0 || qy >= HEIGHT) continue ;
+                        if (!in[qy][qx] || skip[qy] || label[qy][qx]) continue ;
+                        label[qy][qx] = n_ref ;
+                        stack[n][0] = qx ;
+                        stack[n++][1] = qy ;
+                    }
+                }
+            }
+        }
+    }
+}
+
+static int sameStats(const blob_stats *a, const blob_stats *b) {
+    return a->area == b->area && a->x0 == b->x0 && a->y0 == b->y0 && a->x1 == b->x1 && a->y1 == b->y1 &&
+           a->sum_x == b->sum_x && a->sum_y == b->sum_y && a->sum_xx == b->sum_xx &&
+           a->sum_yy == b->sum_yy && a->sum_xy == b->sum_xy ;
+}
+
+static int check(blob_labeler *b, int kind, int up, int skipping, uint32_t min_area) {
+    char what[80] ;
+    sprintf(what, "%s %s%s min area %u", kind_names[kind], up ? "bottom up" : "top down",
+            skipping ? " skipping rows" : "", min_area) ;
+    uint8_t skip[HEIGHT] ;
+    for (int y = 0; y < HEIGHT; y++) skip[y] = skipping && y % 37 == 11 ;
+    refLabel(skip) ;
+
+    b->min_area = min_area ;
+    uint8_t mask[WIDTH / 8] ;
+    for (int i = 0; i < HEIGHT; i++) {
+        int y = up ? HEIGHT - 1 - i : i ;
+        if (skip[y]) continue ;
+        memset(mask, 0, sizeof(mask)) ;
+        for (int x = 0; x < WIDTH; x++) mask[x >> 3] |= in[y][x] << (x & 7) ;
+        blobRow(b, y, mask, WIDTH) ;
+    }
+    blobEndFrame(b) ;
+    if (b->runs_dropped || b->labels_exhausted) {
+        printf("%s: %u runs dropped, labels exhausted %u times\n", what, b->runs_dropped, b->labels_exhausted) ;
+        return -1 ;
+    }
+
+    // every blob reported is a component, once
+    static uint8_t matched[WIDTH * HEIGHT] ;
+    memset(matched, 0, n_ref) ;
+    uint32_t smallest = 0xffffffff ;
+    for (int i = 0; i < b->n_blobs; i++) {
+        const blob_stats *s = &b->blobs[i] ;
+        int c = 0 ;
+        while (c < n_ref && (matched[c] || !sameStats(s, &ref[c]))) c++ ;
+        if (c == n_ref) {
+            printf("%s: blob %d (area %u box %d,%d-%d,%d) is no component\n",
+                   what, i, s->area, s->x0, s->y0, s->x1, s->y1) ;
+            return -1 ;
+        }
+        if (s->area < min_area) {
+            printf("%s: blob %d area %u below the minimum\n", what, i, s->area) ;
+            return -1 ;
+        }
+        matched[c] = 1 ;
+        if (s->area < smallest) smallest = s->area ;
+    }
+    // and the ones left out are too small, or smaller than every one kept
+    int big = 0 ;
+    for (int c = 0; c < n_ref; c++) {
+        if (ref[c].area < min_area) continue ;
+        big++ ;
+        if (!matched[c] && b->n_blobs < BLOB_MAX_OUT) {
+            printf("%s: component area %u box %d,%d-%d,%d not reported\n",
+                   what, ref[c].area, ref[c].x0, ref[c].y0, ref[c].x1, ref[c].y1) ;
+            return -1 ;
+        }
+        if (!matched[c] && ref[c].area > smallest) {
+            printf("%s: component area %u dropped for a smaller one of %u\n", what, ref[c].area, smallest) ;
+            return -1 ;
+        }
+    }
+    if (b->n_blobs != (big < BLOB_MAX_OUT ? big : BLOB_MAX_OUT)) {
+        printf("%s: %d blobs, should be %d\n", what, b->n_blobs, big < BLOB_MAX_OUT ? big : BLOB_MAX_OUT) ;
+        return -1 ;
+    }
+    return 0 ;
+}
+
+int main(int argc, char **argv) {
+    unsigned int seed = 1 ;
+    int opt ;
+    while ((opt = getopt(argc, argv, "s:")) != -1) {
+        switch (opt) {
+            case 's': seed = strtoul(optarg, NULL, 0) ; break ;
+            default:
+                fprintf(stderr, "usage: %s [-s seed]\n", argv[0]) ;
+                return 2 ;
+        }
+    }
+    srand(seed) ;
+    blob_labeler *b = (blob_labeler *)malloc(sizeof(blob_labeler)) ;
+    blobInit(b, 0) ;
+    static const uint32_t min_areas[] = { 0, 1, 5, 200 } ;
+    int checks = 0 ;
+    for (int f = 0; f < 3; f++) {
+        for (int kind = 0; kind < KINDS; kind++) {
+            makeMask(kind) ;
+            for (int up = 0; up < 2; up++) {
+                for (int skipping = 0; skipping < 2; skipping++) {
+                    for (int m = 0; m < 4; m++, checks++) {
+                        if (check(b, kind, up, skipping, min_areas[m]) < 0) return 1 ;
+                    }
+                }
+            }
+        }
+    }
+    free(b) ;
+    printf("%d frames, blobs match\n", checks) ;
+    return 0 ;
+}
@@ -0,0 +1,136 @@
+/**
+ * camctl: reconfigure the camera in one round trip
+ *
+ *   camctl [-p port] [-b baud] [-t timeout_ms] setting=value ...
+ *
+ * Every setting on the command line goes into a single command frame,
+ * applied in order. Frames are read on the camera's uart (the menu
+ * port), so the default port is a USB serial adapter on GPIO 0/1, not
+ * the board's USB CDC port (/dev/ttyACM0). Settings:
+ *
+ *   mode=bw|color|simple|lookback   threshold=N   dither=N
+ *   contrast=0-8   brightness=0-8   flip=0-3   light=0-5   pattern=0-3
+ *   stream=0|1   edges=0|1   vector=0|1   blobs=0|1   motion=0-2
+ *   bw=0-3   autothr=0-99   local=0-99   morph=0-4   shape=0-3
+ *   iterations=1-3   timing=0|1   source=0-5   ping
+ *
+ * Exits 0 if the device acked every setting.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "cmd_client.h"
+
+static const struct {
+    const char *name ;
+    uint8_t opcode ;
+} settings[] = {
+    { "mode", CMD_SET_MODE },
+    { "threshold", CMD_SET_THRESHOLD },
+    { "dither", CMD_SET_DITHER },
+    { "contrast", CMD_SET_CONTRAST },
+    { "brightness", CMD_SET_BRIGHTNESS },
+    { "flip", CMD_SET_MIRROR_FLIP },
+    { "light", CMD_SET_LIGHT_MODE },
+    { "pattern", CMD_SET_TEST_PATTERN },
+    { "ping", CMD_PING },
+    { "stream", CMD_SET_STREAM },
+    { "edges", CMD_SET_EDGE_EXPORT },
+    { "vector", CMD_SET_VECTORIZE },
+    { "blobs", CMD_SET_BLOBS },
+    { "motion", CMD_SET_MOTION },
+    { "bw", CMD_SET_BW_METHOD },
+    { "autothr", CMD_SET_AUTO_THRESHOLD },
+    { "local", CMD_SET_LOCAL_THRESHOLD },
+    { "morph", CMD_SET_MORPH },
+    { "shape", CMD_SET_MORPH_SHAPE },
+    { "iterations", CMD_SET_MORPH_ITERATIONS },
+    { "timing", CMD_SET_TIMING_HUD },
+    { "source", CMD_SET_SOURCE },
+} ;
+
+static const char *modes[] = { "bw", "color", "simple", "lookback" } ;
+
+static const char *status_names[] = { "ok", "bad opcode", "bad argument", "bad length" } ;
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-p port] [-b baud] [-t timeout_ms] setting=value ...\n", prog) ;
+    fprintf(stderr, "settings: mode=bw|color|simple|lookback threshold dither contrast brightness flip light pattern stream edges vector blobs motion bw autothr local morph shape iterations timing source ping\n") ;
+    exit(2) ;
+}
+
+// Parse one setting=value argument into the batch
+static int addSetting(cmd_batch *b, const char *arg) {
+    const char *eq = strchr(arg, '=') ;
+    size_t name_len = eq ? (size_t)(eq - arg) : strlen(arg) ;
+    const char *value = eq ? eq + 1 : "0" ;
+    for (size_t i = 0; i < sizeof(settings) / sizeof(settings[0]); i++) {
+        if (strlen(settings[i].name) != name_len || strncmp(settings[i].name, arg, name_len)) continue ;
+        long v = -1 ;
+        if (settings[i].opcode == CMD_SET_MODE) {
+            for (int m = 0; m < 4; m++) {
+                if (!strcmp(value, modes[m])) v = m ;
+            }
+        }
+        if (v < 0) {
+            char *end ;
+            v = strtol(value, &end, 0) ;
+            if (*value == 0 || *end != 0) v = -1 ;
+        }
+        if (v < 0 || v > 255) {
+            fprintf(stderr, "bad value for %s: %s\n", settings[i].name, value) ;
+            return -1 ;
+        }
+        if (cmdBatchAdd(b, settings[i].opcode, (uint8_t)v) < 0) {
+            fprintf(stderr, "too many settings for one frame\n") ;
+            return -1 ;
+        }
+        return 0 ;
+    }
+    fprintf(stderr, "unknown setting: %s\n", arg) ;
+    return -1 ;
+}
+
+int main(int argc, char **argv) {
+    const char *port = "/dev/ttyUSB0" ;
+    int baud = 921600 ;
+    int timeout_ms = 1000 ;
+    int opt ;
+    while ((opt = getopt(argc, argv, "p:b:t:")) != -1) {
+        switch (opt) {
+            case 'p': port = optarg ; break ;
+            case 'b': baud = atoi(optarg) ; break ;
+            case 't': timeout_ms = atoi(optarg) ; break ;
+            default: usage(argv[0]) ;
+        }
+    }
+    if (optind >= argc) usage(argv[0]) ;
+
+    cmd_batch batch ;
+    cmdBatchInit(&batch) ;
+    for (int i = optind; i < argc; i++) {
+        if (addSetting(&batch, argv[i]) < 0) return 2 ;
+    }
+
+    cmd_client client ;
+    if (cmdClientOpen(&client, port, baud) < 0) {
+        fprintf(stderr, "%s: %s\n", port, strerror(errno)) ;
+        return 1 ;
+    }
+    int seq = cmdClientSend(&client, &batch) ;
+    cmd_ack ack ;
+    if (seq < 0 || cmdClientWaitAck(&client, seq, &ack, timeout_ms) < 0) {
+        fprintf(stderr, "no ack from %s\n", port) ;
+        cmdClientClose(&client) ;
+        return 1 ;
+    }
+    cmdClientClose(&client) ;
+
+    int total = batch.len / (1 + CMD_ARG_BYTES) ;
+    printf("%s, %d of %d applied\n",
+           ack.status < 4 ? status_names[ack.status] : "error", ack.applied, total) ;
+    return ack.status == CMD_OK ? 0 : 1 ;
+}
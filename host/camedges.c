@@ -0,0 +1,177 @@
+/**
+ * camedges: receive edge points exported by the camera over USB CDC
+ *
+ *   camedges [-p port | -i file] [-o points.txt] [-n frames]
+ *
+ * Export is switched on from the menu ('x') or with camctl edges=1, in
+ * either edge detection mode. Each frame's points are decoded and, with
+ * -o, written as "frame x y" lines. With the vectoriser on (camctl
+ * vector=1) frames carry ordered polylines instead, written as
+ * "frame x y path" lines in drawing order. Throughput in points/s is
+ * reported once a second and at the end.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "edge_export.h"
+#include "vectorize.h"
+#include "serial_port.h"
+
+// Largest frame the device can send, one byte per point at best
+#define MAX_POINTS EDGE_EXPORT_BYTES
+
+static uint8_t encoded[EDGE_EXPORT_BYTES] ;
+static short xs[MAX_POINTS], ys[MAX_POINTS] ;
+static uint16_t path_of[MAX_POINTS] ;
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-p port | -i file] [-o points.txt] [-n frames]\n", prog) ;
+    exit(2) ;
+}
+
+static double nowSec(void) {
+    struct timespec ts ;
+    clock_gettime(CLOCK_MONOTONIC, &ts) ;
+    return ts.tv_sec + ts.tv_nsec * 1e-9 ;
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24) ;
+}
+
+int main(int argc, char **argv) {
+    const char *port = "/dev/ttyACM0" ;
+    const char *input = NULL ;
+    const char *output = NULL ;
+    long max_frames = -1 ;
+    int opt ;
+    while ((opt = getopt(argc, argv, "p:i:o:n:")) != -1) {
+        switch (opt) {
+            case 'p': port = optarg ; break ;
+            case 'i': input = optarg ; break ;
+            case 'o': output = optarg ; break ;
+            case 'n': max_frames = atol(optarg) ; break ;
+            default: usage(argv[0]) ;
+        }
+    }
+
+    int fd ;
+    if (input) fd = strcmp(input, "-") ? open(input, O_RDONLY) : 0 ;
+    else fd = serialOpen(port, 115200) ;
+    if (fd < 0) {
+        fprintf(stderr, "%s: %s\n", input ? input : port, strerror(errno)) ;
+        return 1 ;
+    }
+    FILE *out = NULL ;
+    if (output) {
+        out = strcmp(output, "-") ? fopen(output, "w") : stdout ;
+        if (!out) {
+            fprintf(stderr, "%s: %s\n", output, strerror(errno)) ;
+            return 1 ;
+        }
+    }
+
+    fs_parser parser ;
+    fsParserReset(&parser) ;
+    // frame being reassembled
+    int in_frame = 0 ;
+    uint16_t frame_no = 0 ;
+    uint8_t frame_type = 0 ;
+    uint32_t points = 0, len = 0, got = 0 ;
+
+    long frames = 0, lost = 0, bad = 0 ;
+    long long total_points = 0, total_bytes = 0 ;
+    long long window_points = 0 ;
+    long path_frames = 0 ;
+    double total_travel = 0 ;
+    double start = nowSec(), window = start ;
+    uint8_t buf[4096] ;
+    while (max_frames < 0 || frames < max_frames) {
+        ssize_t n = read(fd, buf, sizeof(buf)) ;
+        if (n < 0 && errno == EINTR) continue ;
+        if (n <= 0) break ;
+        for (ssize_t i = 0; i < n && (max_frames < 0 || frames < max_frames); i++) {
+            int result = fsParserFeed(&parser, buf[i]) ;
+            if (result == FS_PARSE_ERROR) bad++ ;
+            if (result != FS_PARSE_PACKET) continue ;
+            if ((parser.type == FS_PKT_EDGE_FRAME || parser.type == FS_PKT_PATH_FRAME) &&
+                parser.len == EDGE_FRAME_INFO_BYTES) {
+                if (in_frame) lost++ ;
+                frame_no = parser.frame ;
+                frame_type = parser.type ;
+                points = get32(&parser.payload[0]) ;
+                len = get32(&parser.payload[4]) ;
+                got = 0 ;
+                in_frame = len <= EDGE_EXPORT_BYTES ;
+                if (!in_frame) bad++ ;
+            }
+            else if (parser.type == frame_type + 1 && in_frame && parser.frame == frame_no) {
+                // chunks arrive in order, a gap means a packet was lost
+                if ((uint32_t)parser.row * FS_MAX_PAYLOAD != got || got + parser.len > len) {
+                    in_frame = 0 ;
+                    lost++ ;
+                    continue ;
+                }
+                memcpy(&encoded[got], parser.payload, parser.len) ;
+                got += parser.len ;
+            }
+            else continue ;
+
+            if (!in_frame || got < len) continue ;
+            in_frame = 0 ;
+            int decoded ;
+            if (frame_type == FS_PKT_EDGE_FRAME) {
+                decoded = edgeDecode(encoded, len, xs, ys, MAX_POINTS) ;
+                if (decoded != (int)points) {
+                    bad++ ;
+                    continue ;
+                }
+                if (out) {
+                    for (int p = 0; p < decoded; p++) fprintf(out, "%u %d %d\n", frame_no, xs[p], ys[p]) ;
+                }
+            }
+            else {
+                decoded = vecDecodePaths(encoded, len, xs, ys, path_of, MAX_POINTS) ;
+                if (decoded < 0 || (decoded && path_of[decoded - 1] + 1 != (int)points)) {
+                    bad++ ;
+                    continue ;
+                }
+                // pen-up travel: from (0, 0) to each path's first point
+                double px = 0, py = 0 ;
+                for (int p = 0; p < decoded; p++) {
+                    if (p == 0 || path_of[p] != path_of[p - 1]) total_travel += hypot(xs[p] - px, ys[p] - py) ;
+                    px = xs[p] ;
+                    py = ys[p] ;
+                }
+                path_frames++ ;
+                if (out) {
+                    for (int p = 0; p < decoded; p++) fprintf(out, "%u %d %d %u\n", frame_no, xs[p], ys[p], path_of[p]) ;
+                }
+            }
+            frames++ ;
+            total_points += decoded ;
+            total_bytes += len ;
+            window_points += decoded ;
+        }
+        double now = nowSec() ;
+        if (now - window >= 1.0) {
+            fprintf(stderr, "%.0f points/s\n", window_points / (now - window)) ;
+            window = now ;
+            window_points = 0 ;
+        }
+    }
+
+    double elapsed = nowSec() - start ;
+    fprintf(stderr, "%ld frames, %lld points, %.2f bytes/point, %.0f points/s, %ld lost, %ld bad\n",
+            frames, total_points, total_points ? (double)total_bytes / total_points : 0.0,
+            elapsed > 0 ? total_points / elapsed : 0.0, lost, bad) ;
+    if (path_frames) fprintf(stderr, "%.0f px pen-up travel per path frame\n", total_travel / path_frames) ;
+    if (out && out != stdout) fclose(out) ;
+    return 0 ;
+}
@@ -0,0 +1,209 @@
+/**
+ * camsim: the camera's capture sequence against a simulated ArduCAM
+ *
+ *   camsim [-c spi_hz] [-f frame_us] [-n frames] [-m mode] [frames.raw]
+ *
+ * Runs the ArduCAM driver, built for the host (ARDUCAM_HOST), over the
+ * simulated board of arduchip_sim.h: first the firmware's bring-up (CPLD
+ * reset, TEST1 check, chip ID, RAW format and sensor settings), then
+ * captures as the camera thread makes them, the FIFO read a byte at a
+ * time with single reads as the firmware does and then a row at a time
+ * with burst reads. Each frame read is checked against the one the
+ * simulator was given, and with -m also run through pipe_frame.h in that
+ * mode.
+ *
+ * Prints the bus counters and the modelled time of each phase per frame
+ * at the SPI clock of -c (4 MHz by default, as Arducam_init sets), and
+ * the host time of the pipeline. Frames come from the RAW file (640x480
+ * frames of FIFO bytes, back to back) or are synthetic.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ArduCAM.h"
+#include "ov5642_regs.h"
+#include "arduchip_sim.h"
+#include "pipe_frame.h"
+
+#define SYNTH_FRAMES 4
+
+enum { READ_SINGLE, READ_BURST, READ_MODES } ;
+static const char *const read_names[READ_MODES] = { "single", "burst" } ;
+
+static arduchip_sim sim ;
+static cam_transport bus ;
+static ArduCAM cam(OV5642, 5) ;
+static uint8_t raw[PF_FRAME_BYTES] ;
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-c spi_hz] [-f frame_us] [-n frames] [-m mode] [frames.raw]\n", prog) ;
+    exit(2) ;
+}
+
+static double nowSec(void) {
+    struct timespec ts ;
+    clock_gettime(CLOCK_MONOTONIC, &ts) ;
+    return ts.tv_sec + ts.tv_nsec * 1e-9 ;
+}
+
+static uint8_t *readFile(const char *path, long *size) {
+    FILE *f = fopen(path, "rb") ;
+    if (!f) return NULL ;
+    fseek(f, 0, SEEK_END) ;
+    *size = ftell(f) ;
+    fseek(f, 0, SEEK_SET) ;
+    uint8_t *buf = (uint8_t *)malloc(*size > 0 ? *size : 1) ;
+    if (buf && fread(buf, 1, *size, f) != (size_t)*size) {
+        free(buf) ;
+        buf = NULL ;
+    }
+    fclose(f) ;
+    return buf ;
+}
+
+// main() of the firmware up to the capture loop. Returns 0 if the board
+// answers as it should.
+static int bringUp(void) {
+    uint8_t vid = 0, pid = 0 ;
+    cam.Arducam_init() ;
+    cam.write_reg(0x07, 0x80) ;
+    bus.delay_ms(bus.ctx, 100) ;
+    cam.write_reg(0x07, 0x00) ;
+    bus.delay_ms(bus.ctx, 100) ;
+
+    cam.write_reg(ARDUCHIP_TEST1, 0x55) ;
+    if (cam.read_reg(ARDUCHIP_TEST1) != 0x55) {
+        printf("SPI interface error\n") ;
+        return 1 ;
+    }
+    cam.wrSensorReg16_8(0xff, 0x01) ;
+    cam.rdSensorReg16_8(OV5642_CHIPID_HIGH, &vid) ;
+    cam.rdSensorReg16_8(OV5642_CHIPID_LOW, &pid) ;
+    if (vid != 0x56 || pid != 0x42) {
+        printf("can't find OV5642 module, chip ID %02x%02x\n", vid, pid) ;
+        return 1 ;
+    }
+
+    cam.set_format(RAW) ;
+    cam.InitCAM() ;
+    cam.write_reg(ARDUCHIP_TIM, VSYNC_LEVEL_MASK) ;
+    cam.OV5642_set_Contrast(Contrast_4) ;
+    cam.OV5642_set_Color_Saturation(Saturation_4) ;
+    bus.delay_ms(bus.ctx, 1000) ;
+    cam.write_reg(ARDUCHIP_FRAMES, 0x00) ;
+    return 0 ;
+}
+
+static void printCounters(const char *what) {
+    printf("%s: %u SPI transactions, %llu bytes; %u I2C transactions, %llu bytes; %.3f s modelled\n",
+           what, sim.spi_transactions, (unsigned long long)sim.spi_bytes, sim.i2c_transactions,
+           (unsigned long long)sim.i2c_bytes, (sim.spi_ns + sim.i2c_ns + sim.delay_ns) * 1e-9) ;
+}
+
+// n captures as the camera thread makes them, the FIFO read the given
+// way. Returns the frames that came back different.
+static int captures(int how, int n, const uint8_t *frames, int n_frames, int mode) {
+    uint64_t phase[3] = { 0, 0, 0 } ;     // capture, length, drain
+    double host = 0 ;
+    int bad = 0 ;
+    arduSimFrames(&sim, frames, PF_FRAME_BYTES, n_frames) ;
+    arduSimClearCounters(&sim) ;
+    pfInit() ;
+    for (int f = 0; f < n; f++) {
+        uint64_t t0 = sim.now_ns ;
+        cam.flush_fifo() ;
+        cam.clear_fifo_flag() ;
+        cam.start_capture() ;
+        while (cam.get_bit(ARDUCHIP_TRIG, CAP_DONE_MASK) == 0) {}
+        uint64_t t1 = sim.now_ns ;
+        uint32_t length = cam.read_fifo_length() ;
+        uint64_t t2 = sim.now_ns ;
+        int rows = length / PF_WIDTH < PF_HEIGHT ? length / PF_WIDTH : PF_HEIGHT ;
+        memset(raw, 0, sizeof(raw)) ;
+        for (int r = 0; r < rows; r++) {
+            uint8_t *row = &raw[r * PF_WIDTH] ;
+            if (how == READ_BURST) cam.read_fifo_burst(row, PF_WIDTH) ;
+            else for (int j = 0; j < PF_WIDTH; j++) row[j] = cam.read_fifo() ;
+        }
+        uint64_t t3 = sim.now_ns ;
+        phase[0] += t1 - t0 ;
+        phase[1] += t2 - t1 ;
+        phase[2] += t3 - t2 ;
+        bad += memcmp(raw, &frames[(size_t)(f % n_frames) * PF_FRAME_BYTES], PF_FRAME_BYTES) != 0 ;
+        if (mode >= 0) {
+            double h0 = nowSec() ;
+            pfFrame(mode, raw) ;
+            host += nowSec() - h0 ;
+        }
+    }
+
+    double total = (phase[0] + phase[1] + phase[2]) * 1e-6 / n ;
+    printf("%-8s %9.2f %9.3f %9.2f %9.2f %6.2f %12.0f %12.0f", read_names[how],
+           phase[0] * 1e-6 / n, phase[1] * 1e-6 / n, phase[2] * 1e-6 / n, total, 1000 / total,
+           (double)sim.spi_transactions / n, (double)sim.spi_bytes / n) ;
+    if (mode >= 0) printf(" %9.2f", host * 1e3 / n) ;
+    printf("\n") ;
+    return bad ;
+}
+
+int main(int argc, char **argv) {
+    uint32_t spi_hz = 4000000, frame_us = 33333 ;
+    int n = 10, mode = -1 ;
+    int opt ;
+    while ((opt = getopt(argc, argv, "c:f:n:m:")) != -1) {
+        switch (opt) {
+            case 'c': spi_hz = strtoul(optarg, NULL, 0) ; break ;
+            case 'f': frame_us = strtoul(optarg, NULL, 0) ; break ;
+            case 'n': n = atoi(optarg) ; break ;
+            case 'm':
+                for (mode = 0; mode < PF_MODES && strcmp(optarg, pf_mode_names[mode]); mode++) ;
+                if (mode == PF_MODES) {
+                    fprintf(stderr, "modes:") ;
+                    for (int m = 0; m < PF_MODES; m++) fprintf(stderr, " %s", pf_mode_names[m]) ;
+                    fprintf(stderr, "\n") ;
+                    exit(2) ;
+                }
+                break ;
+            default: usage(argv[0]) ;
+        }
+    }
+    if (n < 1 || spi_hz == 0 || optind + 1 < argc) usage(argv[0]) ;
+
+    uint8_t *frames ;
+    int n_frames ;
+    if (optind < argc) {
+        long size = 0 ;
+        frames = readFile(argv[optind], &size) ;
+        if (!frames || size < PF_FRAME_BYTES) {
+            fprintf(stderr, "%s: not a RAW file of 640x480 frames\n", argv[optind]) ;
+            return 1 ;
+        }
+        n_frames = size / PF_FRAME_BYTES ;
+    }
+    else {
+        n_frames = SYNTH_FRAMES ;
+        frames = (uint8_t *)malloc((size_t)n_frames * PF_FRAME_BYTES) ;
+        if (!frames) return 1 ;
+        for (int f = 0; f < n_frames; f++) pfSynthFrame(&frames[(size_t)f * PF_FRAME_BYTES], f) ;
+    }
+
+    arduSimInit(&sim, spi_hz) ;
+    sim.frame_us = frame_us ;
+    arduSimTransport(&sim, &bus) ;
+    cam.set_transport(&bus) ;
+    if (bringUp()) return 1 ;
+    printCounters("bring-up") ;
+
+    printf("\nSPI %.2f MHz, %d frames each, modelled ms per frame\n", spi_hz * 1e-6, n) ;
+    printf("%-8s %9s %9s %9s %9s %6s %12s %12s%s\n", "read", "capture", "length", "drain", "total", "fps",
+           "transactions", "SPI bytes", mode >= 0 ? "   host ms" : "") ;
+    int bad = 0 ;
+    for (int how = 0; how < READ_MODES; how++) bad += captures(how, n, frames, n_frames, mode) ;
+    if (sim.fifo_overruns) printf("%u reads past the end of the FIFO\n", sim.fifo_overruns) ;
+    if (bad) printf("%d frames read back wrong\n", bad) ;
+    free(frames) ;
+    return bad != 0 ;
+}
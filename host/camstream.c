@@ -0,0 +1,136 @@
+/**
+ * camstream: receive frames streamed by the camera over USB CDC
+ *
+ *   camstream [-p port | -i file] [-o output] [-n frames]
+ *
+ * Streaming is switched on from the menu ('v') or with camctl stream=1.
+ * Each complete frame is written as a binary PPM. The output is a printf
+ * pattern (default frame_%05d.ppm), or - for a PPM stream on stdout, e.g.
+ * for a live window:
+ *
+ *   camstream -p /dev/ttyACM0 -o - | ffplay -f image2pipe -vcodec ppm -
+ *
+ * -i reads a recorded stream instead of a port (- for stdin).
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "frame_stream.h"
+#include "serial_port.h"
+
+// Packed frame as the device has it, rows not sent keep their old pixels
+static uint8_t image[FS_HEIGHT][FS_ROW_BYTES] ;
+static uint8_t rgb[FS_HEIGHT][FS_WIDTH][3] ;
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-p port | -i file] [-o output] [-n frames]\n", prog) ;
+    exit(2) ;
+}
+
+// 3 bit VGA color (bit 0 red, bit 1 green, bit 2 blue) to 8 bit RGB
+static void writePpm(FILE *f) {
+    for (int y = 0; y < FS_HEIGHT; y++) {
+        for (int x = 0; x < FS_WIDTH; x++) {
+            uint8_t c = (x & 1) ? (image[y][x >> 1] >> 3) & 7 : image[y][x >> 1] & 7 ;
+            rgb[y][x][0] = (c & 1) ? 255 : 0 ;
+            rgb[y][x][1] = (c & 2) ? 255 : 0 ;
+            rgb[y][x][2] = (c & 4) ? 255 : 0 ;
+        }
+    }
+    fprintf(f, "P6\n%d %d\n255\n", FS_WIDTH, FS_HEIGHT) ;
+    fwrite(rgb, sizeof(rgb), 1, f) ;
+    fflush(f) ;
+}
+
+static int saveFrame(const char *output, int index) {
+    if (!strcmp(output, "-")) {
+        writePpm(stdout) ;
+        return 0 ;
+    }
+    char path[4096] ;
+    snprintf(path, sizeof(path), output, index) ;
+    FILE *f = fopen(path, "wb") ;
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno)) ;
+        return -1 ;
+    }
+    writePpm(f) ;
+    fclose(f) ;
+    return 0 ;
+}
+
+int main(int argc, char **argv) {
+    const char *port = "/dev/ttyACM0" ;
+    const char *input = NULL ;
+    const char *output = "frame_%05d.ppm" ;
+    long max_frames = -1 ;
+    int opt ;
+    while ((opt = getopt(argc, argv, "p:i:o:n:")) != -1) {
+        switch (opt) {
+            case 'p': port = optarg ; break ;
+            case 'i': input = optarg ; break ;
+            case 'o': output = optarg ; break ;
+            case 'n': max_frames = atol(optarg) ; break ;
+            default: usage(argv[0]) ;
+        }
+    }
+
+    int fd ;
+    if (input) fd = strcmp(input, "-") ? open(input, O_RDONLY) : 0 ;
+    else fd = serialOpen(port, 115200) ;
+    if (fd < 0) {
+        fprintf(stderr, "%s: %s\n", input ? input : port, strerror(errno)) ;
+        return 1 ;
+    }
+
+    fs_parser parser ;
+    fsParserReset(&parser) ;
+    long frames = 0, rows = 0, bad = 0, bytes = 0 ;
+    int have_keyframe = 0 ;
+    uint8_t buf[4096] ;
+    while (max_frames < 0 || frames < max_frames) {
+        ssize_t n = read(fd, buf, sizeof(buf)) ;
+        if (n < 0 && errno == EINTR) continue ;
+        if (n <= 0) break ;
+        bytes += n ;
+        for (ssize_t i = 0; i < n && (max_frames < 0 || frames < max_frames); i++) {
+            int result = fsParserFeed(&parser, buf[i]) ;
+            if (result == FS_PARSE_ERROR) bad++ ;
+            if (result != FS_PARSE_PACKET) continue ;
+            switch (parser.type) {
+                case FS_PKT_FRAME:
+                    if (parser.len >= 1 && (parser.payload[0] & FS_FLAG_KEYFRAME)) have_keyframe = 1 ;
+                    break ;
+                case FS_PKT_ROW_RAW:
+                    if (parser.row < FS_HEIGHT && parser.len == FS_ROW_BYTES) {
+                        memcpy(image[parser.row], parser.payload, FS_ROW_BYTES) ;
+                        rows++ ;
+                    }
+                    else bad++ ;
+                    break ;
+                case FS_PKT_ROW_RLE:
+                    if (parser.row < FS_HEIGHT &&
+                        fsRleDecode(parser.payload, parser.len, image[parser.row], FS_ROW_BYTES) == FS_ROW_BYTES) {
+                        rows++ ;
+                    }
+                    else bad++ ;
+                    break ;
+                case FS_PKT_END:
+                    // frames before the first keyframe are incomplete
+                    if (!have_keyframe) break ;
+                    if (saveFrame(output, frames) < 0) return 1 ;
+                    frames++ ;
+                    break ;
+            }
+        }
+    }
+
+    fprintf(stderr, "%ld frames, %ld rows, %ld bytes (%.1f%% of raw), %ld bad packets\n",
+            frames, rows, bytes,
+            frames ? 100.0 * bytes / ((double)frames * FS_HEIGHT * FS_ROW_BYTES) : 0.0, bad) ;
+    return 0 ;
+}
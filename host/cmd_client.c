@@ -0,0 +1,99 @@
+/**
+ * Host side of the binary command protocol, see cmd_client.h
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include "cmd_client.h"
+#include "serial_port.h"
+
+int cmdClientOpen(cmd_client *c, const char *path, int baud) {
+    int fd = serialOpen(path, baud) ;
+    if (fd < 0) return -1 ;
+    cmdClientAttach(c, fd) ;
+    return 0 ;
+}
+
+void cmdClientAttach(cmd_client *c, int fd) {
+    c->fd = fd ;
+    c->next_seq = 0 ;
+    cmdParserReset(&c->parser) ;
+}
+
+void cmdClientClose(cmd_client *c) {
+    if (c->fd >= 0) close(c->fd) ;
+    c->fd = -1 ;
+}
+
+void cmdBatchInit(cmd_batch *b) {
+    b->len = 0 ;
+}
+
+int cmdBatchAdd(cmd_batch *b, uint8_t opcode, uint8_t arg) {
+    if (b->len + 1 + CMD_ARG_BYTES > CMD_MAX_PAYLOAD) return -1 ;
+    b->payload[b->len++] = opcode ;
+    b->payload[b->len++] = arg ;
+    return 0 ;
+}
+
+int cmdClientSend(cmd_client *c, const cmd_batch *b) {
+    uint8_t frame[CMD_MAX_FRAME] ;
+    uint8_t seq = c->next_seq++ ;
+    int len = cmdEncodeFrame(seq, b->payload, b->len, frame) ;
+    for (int sent = 0; sent < len; ) {
+        ssize_t n = write(c->fd, frame + sent, len - sent) ;
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue ;
+            return -1 ;
+        }
+        sent += n ;
+    }
+    return seq ;
+}
+
+static long long nowMs(void) {
+    struct timespec ts ;
+    clock_gettime(CLOCK_MONOTONIC, &ts) ;
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000 ;
+}
+
+int cmdClientPoll(cmd_client *c, cmd_ack *ack, int timeout_ms) {
+    long long deadline = nowMs() + timeout_ms ;
+    uint8_t buf[1] ;
+    for (;;) {
+        long long left = deadline - nowMs() ;
+        if (left < 0) left = 0 ;
+        struct pollfd pfd = { c->fd, POLLIN, 0 } ;
+        int ready = poll(&pfd, 1, (int)left) ;
+        if (ready < 0) {
+            if (errno == EINTR) continue ;
+            return -1 ;
+        }
+        if (ready == 0) return -1 ;
+        // one byte at a time, so bytes after an ack stay in the port for
+        // the next call
+        ssize_t n = read(c->fd, buf, 1) ;
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue ;
+            return -1 ;
+        }
+        if (n == 0) return -1 ;
+        if (cmdParserFeed(&c->parser, buf[0]) != CMD_PARSE_FRAME) continue ;
+        if (c->parser.len < 3 || c->parser.payload[0] != CMD_ACK) continue ;
+        ack->seq = c->parser.seq ;
+        ack->status = c->parser.payload[1] ;
+        ack->applied = c->parser.payload[2] ;
+        return 0 ;
+    }
+}
+
+int cmdClientWaitAck(cmd_client *c, int seq, cmd_ack *ack, int timeout_ms) {
+    long long deadline = nowMs() + timeout_ms ;
+    for (;;) {
+        long long left = deadline - nowMs() ;
+        if (left < 0 || cmdClientPoll(c, ack, (int)left) < 0) return -1 ;
+        if (ack->seq == (uint8_t)seq) return 0 ;
+    }
+}
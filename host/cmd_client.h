@@ -0,0 +1,52 @@
+/**
+ * Host side of the binary command protocol (cam_vga/cmd_protocol.h)
+ *
+ * Talks to the camera over its serial port. Commands are collected into
+ * a batch and sent as one frame; acks come back asynchronously and are
+ * matched to frames by sequence number. Text the device prints between
+ * frames (menu prompts, printf) is skipped.
+ */
+
+#ifndef CMD_CLIENT_H
+#define CMD_CLIENT_H
+
+#include <stdint.h>
+#include "cmd_protocol.h"
+
+typedef struct {
+    int fd ;
+    uint8_t next_seq ;
+    cmd_parser parser ;
+} cmd_client ;
+
+typedef struct {
+    uint8_t len ;
+    uint8_t payload[CMD_MAX_PAYLOAD] ;
+} cmd_batch ;
+
+typedef struct {
+    uint8_t seq ;
+    uint8_t status ;    // CMD_OK or CMD_ERR_*
+    uint8_t applied ;   // commands run before the first failure
+} cmd_ack ;
+
+// Open a serial port in raw mode. Returns 0, or -1 with errno set
+int cmdClientOpen(cmd_client *c, const char *path, int baud) ;
+// Use an already open descriptor (e.g. one end of a pty)
+void cmdClientAttach(cmd_client *c, int fd) ;
+void cmdClientClose(cmd_client *c) ;
+
+void cmdBatchInit(cmd_batch *b) ;
+// Returns 0, or -1 if the batch is full
+int cmdBatchAdd(cmd_batch *b, uint8_t opcode, uint8_t arg) ;
+
+// Send a batch as one frame. Returns its sequence number, or -1
+int cmdClientSend(cmd_client *c, const cmd_batch *b) ;
+
+// Wait up to timeout_ms for the next ack of any frame. Returns 0, or -1
+// on timeout or error
+int cmdClientPoll(cmd_client *c, cmd_ack *ack, int timeout_ms) ;
+// Wait for the ack of frame seq, dropping acks of other frames
+int cmdClientWaitAck(cmd_client *c, int seq, cmd_ack *ack, int timeout_ms) ;
+
+#endif
@@ -0,0 +1,273 @@
+/**
+ * cmdcheck: the command client against the firmware's frame parser over
+ * a pty
+ *
+ *   cmdcheck
+ *
+ * cmd_client.c opens the slave side of a pseudo terminal through
+ * serialOpen, as camctl opens the camera's uart. The master side plays
+ * the camera: every byte goes through cmdParserFeedAt as in the uart
+ * interrupt's rx hook, bytes outside frames count as menu keys, and each
+ * frame is answered with an ack frame the way protothread_command does,
+ * with menu text and printf output around it. Checks:
+ *
+ *  - a batch arrives intact, with the ack matched to it
+ *  - menu keys typed between frames are not taken as frame bytes
+ *  - several frames in flight, acked in reverse order with a corrupt
+ *    ack and text between them: polled in arrival order, and waiting on
+ *    one seq drops the others
+ *  - two acks in one write are returned by two polls
+ *  - a stray CMD_SYNC0 just before a frame, either way, loses nothing
+ *  - a frame cut short is dropped after CMD_FRAME_GAP_US and does not
+ *    swallow the key and frame that follow it
+ *  - a full batch, and sequence numbers wrapping past 255
+ *  - no answer times out
+ *
+ * Exits 1 on the first failure.
+ */
+
+#define _XOPEN_SOURCE 600
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "cmd_client.h"
+
+#define TIMEOUT_MS 500
+#define BAD_OPCODE 0x7f         // no command has it, the device refuses it
+
+// The camera end of the pty
+typedef struct {
+    int fd ;
+    cmd_parser parser ;
+    int frames, bad, keys ;
+    uint8_t seq[8] ;            // frames received since the last answer
+    uint8_t applied[8] ;
+    uint8_t status[8] ;
+    int pending ;
+} device ;
+
+static device dev ;
+
+static void fail(const char *what) {
+    printf("%s\n", what) ;
+    exit(1) ;
+}
+
+static void devWrite(const void *buf, size_t len) {
+    if (write(dev.fd, buf, len) != (ssize_t)len) fail("write to pty failed") ;
+}
+
+static void devText(const char *s) {
+    devWrite(s, strlen(s)) ;
+}
+
+static int devAck(uint8_t seq, uint8_t status, uint8_t applied, uint8_t *out) {
+    uint8_t reply[3] = { CMD_ACK, status, applied } ;
+    return cmdEncodeFrame(seq, reply, sizeof(reply), out) ;
+}
+
+static uint32_t nowUs(void) {
+    struct timespec ts ;
+    clock_gettime(CLOCK_MONOTONIC, &ts) ;
+    return (uint32_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000 ;
+}
+
+// Take one read of what the client sent, 0 if nothing came in 10 ms
+static int devRead(void) {
+    struct pollfd pfd = { dev.fd, POLLIN, 0 } ;
+    if (poll(&pfd, 1, 10) <= 0) return 0 ;
+    uint8_t buf[256] ;
+    ssize_t n = read(dev.fd, buf, sizeof(buf)) ;
+    if (n <= 0) fail("read from pty failed") ;
+    uint32_t now = nowUs() ;
+    for (ssize_t i = 0; i < n; i++) {
+        // as cmd_rx_hook: frame bytes are taken, the rest go to the menu
+        int result = cmdParserFeedAt(&dev.parser, buf[i], now) ;
+        if (result == CMD_PARSE_IDLE) dev.keys++ ;
+        else if (result == CMD_PARSE_ERROR) dev.bad++ ;
+        else if (result == CMD_PARSE_FRAME) {
+            if (dev.pending == 8) fail("too many frames in flight") ;
+            uint8_t status = CMD_OK, applied = 0 ;
+            if (dev.parser.len % (1 + CMD_ARG_BYTES)) status = CMD_ERR_LENGTH ;
+            else {
+                for (int c = 0; c < dev.parser.len; c += 1 + CMD_ARG_BYTES) {
+                    if (dev.parser.payload[c] == 0 || dev.parser.payload[c] == BAD_OPCODE) {
+                        status = CMD_ERR_OPCODE ;
+                        break ;
+                    }
+                    applied++ ;
+                }
+            }
+            dev.seq[dev.pending] = dev.parser.seq ;
+            dev.status[dev.pending] = status ;
+            dev.applied[dev.pending] = applied ;
+            dev.pending++ ;
+            dev.frames++ ;
+        }
+    }
+    return 1 ;
+}
+
+// Read what the client sent until want frames are complete
+static void devReceive(int want) {
+    long long waited = 0 ;
+    while (dev.pending < want) {
+        if (!devRead() && (waited += 10) > TIMEOUT_MS) fail("frames did not reach the device") ;
+    }
+}
+
+static void checkAck(const cmd_ack *ack, int seq, int status, int applied) {
+    if (ack->seq != (uint8_t)seq) fail("ack for the wrong frame") ;
+    if (ack->status != status) fail("ack status wrong") ;
+    if (ack->applied != applied) fail("ack applied count wrong") ;
+}
+
+static long long nowMs(void) {
+    struct timespec ts ;
+    clock_gettime(CLOCK_MONOTONIC, &ts) ;
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000 ;
+}
+
+int main(void) {
+    dev.fd = posix_openpt(O_RDWR | O_NOCTTY) ;
+    if (dev.fd < 0 || grantpt(dev.fd) < 0 || unlockpt(dev.fd) < 0) {
+        printf("no pty: %s\n", strerror(errno)) ;
+        return 1 ;
+    }
+    cmdParserReset(&dev.parser) ;
+    cmd_client client ;
+    if (cmdClientOpen(&client, ptsname(dev.fd), 921600) < 0) {
+        printf("%s: %s\n", ptsname(dev.fd), strerror(errno)) ;
+        return 1 ;
+    }
+    uint8_t frame[4 * CMD_MAX_FRAME] ;
+    cmd_ack ack ;
+    cmd_batch b ;
+
+    // one batch, the ack after the menu prompt
+    cmdBatchInit(&b) ;
+    cmdBatchAdd(&b, CMD_SET_MODE, CMD_MODE_EDGE_LOOKBACK) ;
+    cmdBatchAdd(&b, CMD_SET_THRESHOLD, 3) ;
+    cmdBatchAdd(&b, CMD_SET_DITHER, 1) ;
+    int seq = cmdClientSend(&client, &b) ;
+    devReceive(1) ;
+    if (dev.parser.len != b.len || memcmp(dev.parser.payload, b.payload, b.len)) fail("batch changed on the way") ;
+    devText("\n\rinput a command: ") ;
+    devWrite(frame, devAck(dev.seq[0], dev.status[0], dev.applied[0], frame)) ;
+    dev.pending = 0 ;
+    if (cmdClientWaitAck(&client, seq, &ack, TIMEOUT_MS) < 0) fail("no ack for one batch") ;
+    checkAck(&ack, seq, CMD_OK, 3) ;
+
+    // menu keys around and between frames
+    if (write(client.fd, "z\r", 2) != 2) fail("write to pty failed") ;
+    cmdBatchInit(&b) ;
+    cmdBatchAdd(&b, CMD_PING, 0) ;
+    cmdBatchAdd(&b, BAD_OPCODE, 0) ;
+    seq = cmdClientSend(&client, &b) ;
+    if (write(client.fd, "i", 1) != 1) fail("write to pty failed") ;
+    cmdBatchInit(&b) ;
+    cmdBatchAdd(&b, CMD_PING, 0) ;
+    int seq2 = cmdClientSend(&client, &b) ;
+    devReceive(2) ;
+    if (dev.keys != 3 || dev.bad) fail("menu keys mixed up with frame bytes") ;
+    for (int i = 0; i < 2; i++) devWrite(frame, devAck(dev.seq[i], dev.status[i], dev.applied[i], frame)) ;
+    dev.pending = 0 ;
+    if (cmdClientWaitAck(&client, seq, &ack, TIMEOUT_MS) < 0) fail("no ack after menu keys") ;
+    checkAck(&ack, seq, CMD_ERR_OPCODE, 1) ;
+    if (cmdClientWaitAck(&client, seq2, &ack, TIMEOUT_MS) < 0) fail("no ack after menu keys") ;
+    checkAck(&ack, seq2, CMD_OK, 1) ;
+
+    // three in flight, acked in reverse with a corrupt ack and text between
+    int seqs[3] ;
+    for (int i = 0; i < 3; i++) {
+        cmdBatchInit(&b) ;
+        for (int c = 0; c <= i; c++) cmdBatchAdd(&b, CMD_SET_CONTRAST, c) ;
+        seqs[i] = cmdClientSend(&client, &b) ;
+    }
+    devReceive(3) ;
+    int len = devAck(dev.seq[2], CMD_OK, 3, frame) ;
+    frame[len - 1] ^= 0x40 ;
+    devWrite(frame, len) ;
+    devText("frame 12 edges 3401\n\r") ;
+    for (int i = 2; i >= 0; i--) {
+        devWrite(frame, devAck(dev.seq[i], dev.status[i], dev.applied[i], frame)) ;
+        devText("\n\rinput a command: ") ;
+    }
+    dev.pending = 0 ;
+    if (cmdClientPoll(&client, &ack, TIMEOUT_MS) < 0) fail("no ack polled") ;
+    checkAck(&ack, seqs[2], CMD_OK, 3) ;
+    if (cmdClientWaitAck(&client, seqs[0], &ack, TIMEOUT_MS) < 0) fail("ack dropped while waiting") ;
+    checkAck(&ack, seqs[0], CMD_OK, 1) ;
+    if (cmdClientPoll(&client, &ack, 50) == 0) fail("ack of another frame not dropped") ;
+
+    // two acks in one write
+    seqs[0] = cmdClientSend(&client, &b) ;
+    seqs[1] = cmdClientSend(&client, &b) ;
+    devReceive(2) ;
+    len = devAck(dev.seq[0], CMD_OK, 3, frame) ;
+    len += devAck(dev.seq[1], CMD_OK, 3, frame + len) ;
+    devWrite(frame, len) ;
+    dev.pending = 0 ;
+    for (int i = 0; i < 2; i++) {
+        if (cmdClientPoll(&client, &ack, TIMEOUT_MS) < 0) fail("second ack in a write lost") ;
+        checkAck(&ack, seqs[i], CMD_OK, 3) ;
+    }
+
+    // a stray CMD_SYNC0 in front of a frame, on the way there and back
+    uint8_t sync0 = CMD_SYNC0 ;
+    if (write(client.fd, &sync0, 1) != 1) fail("write to pty failed") ;
+    seq = cmdClientSend(&client, &b) ;
+    devReceive(1) ;
+    devWrite(&sync0, 1) ;
+    devWrite(frame, devAck(dev.seq[0], dev.status[0], dev.applied[0], frame)) ;
+    dev.pending = 0 ;
+    if (cmdClientWaitAck(&client, seq, &ack, TIMEOUT_MS) < 0) fail("no ack after a stray sync byte") ;
+    checkAck(&ack, seq, CMD_OK, 3) ;
+
+    // half a frame, then after a pause a menu key and a whole frame
+    int keys = dev.keys ;
+    len = cmdEncodeFrame(0, b.payload, b.len, frame) / 2 ;
+    if (write(client.fd, frame, len) != len) fail("write to pty failed") ;
+    if (!devRead()) fail("half frame did not reach the device") ;
+    usleep(2 * CMD_FRAME_GAP_US) ;
+    if (write(client.fd, "z", 1) != 1) fail("write to pty failed") ;
+    seq = cmdClientSend(&client, &b) ;
+    devReceive(1) ;
+    if (dev.keys != keys + 1) fail("key after a cut frame taken as frame bytes") ;
+    devWrite(frame, devAck(dev.seq[0], dev.status[0], dev.applied[0], frame)) ;
+    dev.pending = 0 ;
+    if (cmdClientWaitAck(&client, seq, &ack, TIMEOUT_MS) < 0) fail("no ack after a cut frame") ;
+    checkAck(&ack, seq, CMD_OK, 3) ;
+
+    // a full batch, then sequence numbers through the wrap
+    cmdBatchInit(&b) ;
+    int full = 0 ;
+    while (cmdBatchAdd(&b, CMD_SET_BRIGHTNESS, full & 7) == 0) full++ ;
+    if (full != CMD_MAX_PAYLOAD / (1 + CMD_ARG_BYTES)) fail("batch does not hold a full frame") ;
+    for (int i = 0; i < 300; i++) {
+        seq = cmdClientSend(&client, &b) ;
+        devReceive(1) ;
+        devWrite(frame, devAck(dev.seq[0], dev.status[0], dev.applied[0], frame)) ;
+        dev.pending = 0 ;
+        if (cmdClientWaitAck(&client, seq, &ack, TIMEOUT_MS) < 0) fail("no ack for a full batch") ;
+        checkAck(&ack, seq, CMD_OK, full) ;
+    }
+
+    // no answer
+    seq = cmdClientSend(&client, &b) ;
+    long long start = nowMs() ;
+    if (cmdClientWaitAck(&client, seq, &ack, 100) == 0) fail("ack with no answer") ;
+    long long took = nowMs() - start ;
+    if (took < 100 || took > 100 + TIMEOUT_MS) fail("timeout not kept") ;
+
+    cmdClientClose(&client) ;
+    close(dev.fd) ;
+    if (dev.bad) fail("frames corrupted on the way") ;
+    printf("%d frames over a pty ok\n", dev.frames) ;
+    return 0 ;
+}
@@ -0,0 +1,191 @@
+/**
+ * kernelcheck: the fused row kernels against the loop they replaced
+ *
+ *   kernelcheck [-s seed]
+ *
+ * Runs frames through the color, B/W dark and simple edge kernels of
+ * cam_vga/pixel_pipeline.hpp and through the camera thread's per-pixel
+ * loop from before the pipelines (also timed by pipebench as "branchy"),
+ * bottom row first as the camera reads them. Frames are a noisy gradient
+ * with a dark disc and an inverted bar, random bytes, and all dark, whose
+ * single run crosses every row and the 9999 pixel count wrap. Checks, row
+ * by row:
+ *
+ *  - every byte of the packed row
+ *  - the histogram tap's bins
+ *  - the simple edge count and points, the run count carried across
+ *    rows, and with an edge list small enough to wrap
+ *  - the B/W and lookback masks have the dark pixels set
+ *
+ * Exits 1 on the first difference.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "pixel_pipeline.hpp"
+
+using namespace pipeline ;
+
+#define HEIGHT 480
+#define FRAME_BYTES (WIDTH * HEIGHT)
+#define FRAMES 6
+#define MAX_EDGES 20000
+
+static uint8_t frames[FRAMES][FRAME_BYTES] ;
+static uint8_t row[WIDTH / 2], ref_row[WIDTH / 2], mask[WIDTH / 8] ;
+static short edge_x[MAX_EDGES], edge_y[MAX_EDGES], ref_x[MAX_EDGES], ref_y[MAX_EDGES] ;
+static histogram hist, ref_hist ;
+
+enum { COLOR, BW_DARK, EDGES, LOOKBACK, KERNELS } ;
+static const char *const kernel_names[] = { "color", "bw dark", "edges simple", "edges lookback" } ;
+
+// The camera thread's pixel loop before the pipelines, as in pipebench
+// with the mode flags as arguments
+static void branchyRow(context &c, short y, const uint8_t *raw, int color_enabled, int edge_detection_en) {
+    for (int j = 0; j < WIDTH; j++) {
+        uint8_t color = raw[j] ;
+        uint8_t red = (int)(color>>6)>>1 ;
+        uint8_t green = (int)((color-(red<<6))>>4)>>1 ;
+        uint8_t blue = (int)((color>>2)%4)>>1 ;
+        int x = WIDTH - 1 - j ;
+        if (!edge_detection_en) histAdd(c.hist, color) ;
+        if (color_enabled) {
+            uint8_t v = (red<<2)+(green<<1)+blue ;
+            if (x & 1) c.row[x>>1] = (c.row[x>>1] & 0x07) | (v << 3) ;
+            else c.row[x>>1] = (c.row[x>>1] & 0x38) | v ;
+        }
+        else if (edge_detection_en == 1) {
+            if ((red<<2)+(green<<1)+blue == 0) {
+                if (c.consecutive == c.threshold) {
+                    c.edge_x[c.num_edges] = x + 1 ;
+                    c.edge_y[c.num_edges] = y + 1 ;
+                    if (++c.num_edges >= c.max_edges) c.num_edges = 0 ;
+                }
+                if (++c.consecutive >= 9999) c.consecutive = 0 ;
+            }
+            else c.consecutive = 0 ;
+        }
+        else {
+            uint8_t v = (red<<2)+(green<<1)+blue == 0 ? PIX_WHITE : PIX_BLACK ;
+            if (x & 1) c.row[x>>1] = (c.row[x>>1] & 0x07) | (v << 3) ;
+            else c.row[x>>1] = (c.row[x>>1] & 0x38) | v ;
+        }
+    }
+}
+
+// FIFO order: bottom row first, right to left
+static void makeFrames(void) {
+    for (int f = 0; f < 4; f++) {
+        for (int y = 0; y < HEIGHT; y++) {
+            for (int x = 0; x < WIDTH; x++) {
+                int v = (x + y) * 255 / (WIDTH + HEIGHT) + rand() % 16 ;
+                int dx = x - 200 - 4 * f, dy = y - 240 ;
+                if (dx * dx + dy * dy < 80 * 80) v = rand() % 8 ;
+                if (x > 420 && x < 520 && y > 100 + 2 * f && y < 380) v = 255 - v ;
+                frames[f][(HEIGHT - 1 - y) * WIDTH + WIDTH - 1 - x] = v > 255 ? 255 : v ;
+            }
+        }
+    }
+    for (int i = 0; i < FRAME_BYTES; i++) frames[4][i] = rand() ;
+    memset(frames[5], 0, FRAME_BYTES) ;
+}
+
+static void setUp(context &c, uint8_t *out, histogram *h, short *xs, short *ys, int threshold, int max_edges) {
+    memset(&c, 0, sizeof(c)) ;
+    c.row = out ;
+    c.mask = mask ;
+    c.hist = h ;
+    c.edge_x = xs ;
+    c.edge_y = ys ;
+    c.max_edges = max_edges ;
+    c.threshold = threshold ;
+    histInit(h, 63) ;
+}
+
+static int check(int kernel, int f, int threshold, int max_edges) {
+    static const row_kernel kernels[] = {
+        modes<stage>::color::row, modes<stage>::bw_dark::row, edge_simple_mode::row, edge_lookback_mode::row
+    } ;
+    context c, ref ;
+    setUp(c, row, &hist, edge_x, edge_y, threshold, max_edges) ;
+    setUp(ref, ref_row, &ref_hist, ref_x, ref_y, threshold, max_edges) ;
+    memset(edge_x, 0, sizeof(edge_x)) ;
+    memset(edge_y, 0, sizeof(edge_y)) ;
+    memset(ref_x, 0, sizeof(ref_x)) ;
+    memset(ref_y, 0, sizeof(ref_y)) ;
+    const uint8_t *frame = frames[f] ;
+    for (int r = 0; r < HEIGHT; r++) {
+        short y = HEIGHT - 1 - r ;
+        const uint8_t *raw = &frame[r * WIDTH] ;
+        kernels[kernel](c, y, raw) ;
+        if (kernel != LOOKBACK) branchyRow(ref, y, raw, kernel == COLOR, kernel == EDGES) ;
+        if ((kernel == COLOR || kernel == BW_DARK) && memcmp(row, ref_row, sizeof(row))) {
+            int i = 0 ;
+            while (row[i] == ref_row[i]) i++ ;
+            printf("%s frame %d: row %d byte %d is %#x, should be %#x\n",
+                   kernel_names[kernel], f, y, i, row[i], ref_row[i]) ;
+            return -1 ;
+        }
+        if (kernel == BW_DARK || kernel == LOOKBACK) {
+            for (int x = 0; x < WIDTH; x++) {
+                int dark = tables<>::color_of[raw[WIDTH - 1 - x]] == 0 ;
+                if (((mask[x >> 3] >> (x & 7)) & 1) != dark) {
+                    printf("%s frame %d: mask bit %d,%d is not %d\n", kernel_names[kernel], f, x, y, dark) ;
+                    return -1 ;
+                }
+            }
+        }
+        if (kernel == EDGES && (c.num_edges != ref.num_edges || c.consecutive != ref.consecutive)) {
+            printf("%s frame %d threshold %d: %d edges and a run of %d after row %d, should be %d and %d\n",
+                   kernel_names[kernel], f, threshold, c.num_edges, c.consecutive, y, ref.num_edges, ref.consecutive) ;
+            return -1 ;
+        }
+    }
+    if (kernel != EDGES && kernel != LOOKBACK && memcmp(hist.bins, ref_hist.bins, sizeof(hist.bins))) {
+        printf("%s frame %d: histogram differs\n", kernel_names[kernel], f) ;
+        return -1 ;
+    }
+    for (int i = 0; i < max_edges; i++) {
+        if (edge_x[i] != ref_x[i] || edge_y[i] != ref_y[i]) {
+            printf("%s frame %d threshold %d: edge %d is %d,%d, should be %d,%d\n",
+                   kernel_names[kernel], f, threshold, i, edge_x[i], edge_y[i], ref_x[i], ref_y[i]) ;
+            return -1 ;
+        }
+    }
+    return 0 ;
+}
+
+int main(int argc, char **argv) {
+    unsigned int seed = 1 ;
+    int opt ;
+    while ((opt = getopt(argc, argv, "s:")) != -1) {
+        switch (opt) {
+            case 's': seed = strtoul(optarg, NULL, 0) ; break ;
+            default:
+                fprintf(stderr, "usage: %s [-s seed]\n", argv[0]) ;
+                return 2 ;
+        }
+    }
+    srand(seed) ;
+    initTables() ;
+    makeFrames() ;
+    int checks = 0 ;
+    for (int f = 0; f < FRAMES; f++) {
+        for (int kernel = 0; kernel < KERNELS; kernel++) {
+            if (kernel != EDGES) {
+                if (check(kernel, f, 7, MAX_EDGES) < 0) return 1 ;
+                checks++ ;
+                continue ;
+            }
+            // 7 is the firmware's default; every other run wraps the edge list
+            static const int thresholds[] = { 0, 1, 7, 100, 9998 } ;
+            for (int t = 0; t < 5; t++, checks++) {
+                if (check(kernel, f, thresholds[t], t & 1 ? 997 : MAX_EDGES) < 0) return 1 ;
+            }
+        }
+    }
+    printf("%d frames, kernels match the old loop\n", checks) ;
+    return 0 ;
+}
@@ -0,0 +1,157 @@
+/**
+ * lookbackcheck: the pipeline's lookback edge stage against the code it
+ * replaced
+ *
+ *   lookbackcheck [-s seed]
+ *
+ * Feeds random dark pixel masks, bottom row first as the camera reads
+ * them, to pipeline::lookbackRow and to the original detector, which
+ * copied each row into prev_3_rows and shifted the rows up after
+ * searching the middle one. Over a range of thresholds and dither
+ * settings, and with an edge list small enough to wrap, both must save
+ * the same points in the same order.
+ *
+ * Exits 1 on the first difference.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "pixel_pipeline.hpp"
+
+#define WIDTH 640
+#define HEIGHT 480
+#define MAX_EDGES 20000
+
+// === The original detector, from 2040camera.cpp ===
+static bool prev_3_rows[3][640] ;
+static short ref_edges[2][MAX_EDGES] ;
+static int consecutive_threshold, dithering_number, ref_max_edges ;
+
+static int lookback_edges(short y, int num_edges) {
+    int count_since_pixel = 0 ;
+    for (int j = 1; j <= 638; j++) {
+        if (prev_3_rows[0][j-1] + prev_3_rows[0][j] + prev_3_rows[0][j+1] + prev_3_rows[1][j-1] + prev_3_rows[1][j+1] +
+            prev_3_rows[2][j-1] + prev_3_rows[2][j] + prev_3_rows[2][j+1] > consecutive_threshold) {
+            if (count_since_pixel == 0) {
+                ref_edges[0][num_edges] = (j % 640) ;
+                ref_edges[1][num_edges] = y ;
+                num_edges = num_edges + 1 ;
+                if (num_edges >= ref_max_edges) {
+                    num_edges = 0 ;
+                }
+                count_since_pixel = count_since_pixel + 1 ;
+            }
+            else {
+                count_since_pixel = count_since_pixel + 1 ;
+                if (count_since_pixel >= dithering_number) {
+                    count_since_pixel = 0 ;
+                }
+            }
+        }
+        else {
+            count_since_pixel = 0 ;
+        }
+    }
+    for (int j = 0; j < 640; j++) {
+        prev_3_rows[0][j] = prev_3_rows[1][j] ;
+        prev_3_rows[1][j] = prev_3_rows[2][j] ;
+    }
+    return num_edges ;
+}
+
+static int lookback_mask_row(const uint8_t *mask, short y, int row, int num_edges) {
+    int r = row < 2 ? row : 2 ;
+    for (int j = 0; j < 640; j++) {
+        int x = 639 - j ;
+        prev_3_rows[r][j] = (mask[x >> 3] >> (x & 7)) & 1 ;
+    }
+    if (row >= 2) num_edges = lookback_edges(y + 1, num_edges) ;
+    return num_edges ;
+}
+
+// === Masks ===
+static uint8_t masks[HEIGHT][WIDTH / 8] ;
+
+static void makeMasks(int kind) {
+    int density = 1 + kind % 7 ;            // in eighths
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            int dark = rand() % 8 < density ;
+            // some frames have long dark runs, to exercise the dither
+            if (kind & 1 && (x / 50 + y / 40) % 3 == 0) dark = 1 ;
+            if (dark) masks[y][x >> 3] |= 1 << (x & 7) ;
+            else masks[y][x >> 3] &= ~(1 << (x & 7)) ;
+        }
+    }
+}
+
+static pipeline::lookback rows ;
+static short edge_x[MAX_EDGES], edge_y[MAX_EDGES] ;
+
+static int check(int threshold, int dither, int max_edges) {
+    pipeline::context c ;
+    memset(&c, 0, sizeof(c)) ;
+    c.edge_x = edge_x ;
+    c.edge_y = edge_y ;
+    c.max_edges = max_edges ;
+    c.threshold = threshold ;
+    c.dither = dither ;
+    consecutive_threshold = threshold ;
+    dithering_number = dither ;
+    ref_max_edges = max_edges ;
+    memset(edge_x, 0, sizeof(edge_x)) ;
+    memset(edge_y, 0, sizeof(edge_y)) ;
+    memset(ref_edges, 0, sizeof(ref_edges)) ;
+
+    pipeline::lookbackBeginFrame(rows) ;
+    int ref_num = 0 ;
+    for (int row = 0; row < HEIGHT; row++) {
+        short y = HEIGHT - 1 - row ;
+        pipeline::lookbackRow(rows, c, masks[y], y) ;
+        ref_num = lookback_mask_row(masks[y], y, row, ref_num) ;
+        if (c.num_edges != ref_num) {
+            printf("threshold %d dither %d: %d edges after row %d, should be %d\n",
+                   threshold, dither, c.num_edges, y, ref_num) ;
+            return -1 ;
+        }
+    }
+    for (int i = 0; i < max_edges; i++) {
+        if (edge_x[i] != ref_edges[0][i] || edge_y[i] != ref_edges[1][i]) {
+            printf("threshold %d dither %d: edge %d is %d,%d, should be %d,%d\n",
+                   threshold, dither, i, edge_x[i], edge_y[i], ref_edges[0][i], ref_edges[1][i]) ;
+            return -1 ;
+        }
+    }
+    return 0 ;
+}
+
+int main(int argc, char **argv) {
+    unsigned int seed = 1 ;
+    int opt ;
+    while ((opt = getopt(argc, argv, "s:")) != -1) {
+        switch (opt) {
+            case 's': seed = strtoul(optarg, NULL, 0) ; break ;
+            default:
+                fprintf(stderr, "usage: %s [-s seed]\n", argv[0]) ;
+                return 2 ;
+        }
+    }
+    srand(seed) ;
+    int checks = 0 ;
+    for (int kind = 0; kind < 8; kind++) {
+        makeMasks(kind) ;
+        for (int threshold = 0; threshold <= 8; threshold++) {
+            // threshold 7 and dither 3 are the firmware's defaults
+            static const int dithers[] = { 0, 1, 3, 7, 40 } ;
+            for (int d = 0; d < 5; d++, checks++) {
+                // every third run wraps the edge list
+                int max_edges = checks % 3 == 0 ? 997 : MAX_EDGES ;
+                if (check(threshold, dithers[d], max_edges) < 0) return 1 ;
+            }
+        }
+    }
+    printf("%d settings, edges match\n", checks) ;
+    return 0 ;
+}
@@ -0,0 +1,131 @@
+/**
+ * ltcheck: the local threshold against an integral image reference
+ *
+ *   ltcheck [-s seed]
+ *
+ * Binarises frames with local_threshold.c, a row at a time as the camera
+ * thread does, and compares every mask bit with a reference that takes
+ * the window total from an integral image of the whole frame (the
+ * textbook Bradley method): the pixel's row and the
+ * window - 1 rows above it (fewer at the top), radius columns either
+ * side (clipped at the edges), set when luma * count * 100 < sum *
+ * (100 - percent). Frames are noise, gradients, blocks and the extremes
+ * 0 and 255; settings are the firmware's and the limits of the window,
+ * radius and percent. Two frames per setting check that ltBeginFrame
+ * forgets the last one.
+ *
+ * Exits 1 on the first difference.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "local_threshold.h"
+
+#define HEIGHT 480
+
+static uint8_t frame[HEIGHT][LT_WIDTH] ;
+static uint8_t ring[LT_MAX_WINDOW * LT_WIDTH] ;
+// integral[y][x]: total of the pixels above and left of (x, y)
+static unsigned long long integral[HEIGHT + 1][LT_WIDTH + 1] ;
+
+static const struct {
+    uint8_t window, radius, percent ;
+} settings[] = {
+    { 16, 12, 15 },             // the firmware's LT_WINDOW, LT_RADIUS, LT_PERCENT
+    { 1, 0, 0 },
+    { 1, 5, 50 },
+    { 8, 0, 99 },
+    { 32, 40, 10 },
+    { LT_MAX_WINDOW, 255, 1 },
+    { LT_MAX_WINDOW, 3, 30 },
+} ;
+
+static void makeFrame(int kind) {
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < LT_WIDTH; x++) {
+            uint8_t v ;
+            switch (kind) {
+                case 0: v = rand() ; break ;
+                case 1: v = (x * 255 / (LT_WIDTH - 1) + y / 4) & 0xff ; break ;
+                case 2: v = (((x / 37) ^ (y / 23)) & 1) ? 200 + rand() % 56 : rand() % 60 ; break ;
+                default: v = ((x ^ y) & 1) ? 255 : 0 ; break ;
+            }
+            frame[y][x] = v ;
+        }
+    }
+}
+
+static void makeIntegral(void) {
+    for (int y = 0; y < HEIGHT; y++) {
+        unsigned long long row = 0 ;
+        for (int x = 0; x < LT_WIDTH; x++) {
+            row += frame[y][x] ;
+            integral[y + 1][x + 1] = integral[y][x + 1] + row ;
+        }
+    }
+}
+
+static int refPixel(int x, int y, int window, int radius, int percent) {
+    int y0 = y - window + 1 < 0 ? 0 : y - window + 1 ;
+    int x0 = x - radius < 0 ? 0 : x - radius ;
+    int x1 = x + radius > LT_WIDTH - 1 ? LT_WIDTH - 1 : x + radius ;
+    unsigned long long sum = integral[y + 1][x1 + 1] - integral[y0][x1 + 1] - integral[y + 1][x0] + integral[y0][x0] ;
+    unsigned long long count = (unsigned long long)(y - y0 + 1) * (x1 - x0 + 1) ;
+    return frame[y][x] * count * 100 < sum * (100 - percent) ;
+}
+
+static int checkFrame(local_threshold *t, int s) {
+    int window = settings[s].window, radius = settings[s].radius, percent = settings[s].percent ;
+    uint8_t mask[LT_WIDTH / 8] ;
+    makeIntegral() ;
+    ltBeginFrame(t) ;
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < LT_WIDTH; x++) ltPixel(t, x, frame[y][x]) ;
+        int set = ltRow(t, mask) ;
+        int ref_set = 0 ;
+        for (int x = 0; x < LT_WIDTH; x++) {
+            int bit = (mask[x >> 3] >> (x & 7)) & 1 ;
+            int ref = refPixel(x, y, window, radius, percent) ;
+            ref_set += ref ;
+            if (bit != ref) {
+                printf("window %d radius %d percent %d: pixel %d,%d is %d, should be %d\n",
+                       window, radius, percent, x, y, bit, ref) ;
+                return -1 ;
+            }
+        }
+        if (set != ref_set) {
+            printf("window %d radius %d percent %d: row %d counts %d pixels set, should be %d\n",
+                   window, radius, percent, y, set, ref_set) ;
+            return -1 ;
+        }
+    }
+    return 0 ;
+}
+
+int main(int argc, char **argv) {
+    unsigned int seed = 1 ;
+    int opt ;
+    while ((opt = getopt(argc, argv, "s:")) != -1) {
+        switch (opt) {
+            case 's': seed = strtoul(optarg, NULL, 0) ; break ;
+            default:
+                fprintf(stderr, "usage: %s [-s seed]\n", argv[0]) ;
+                return 2 ;
+        }
+    }
+    srand(seed) ;
+    local_threshold t ;
+    int n = sizeof(settings) / sizeof(settings[0]) ;
+    for (int s = 0; s < n; s++) {
+        ltInit(&t, ring, settings[s].window, settings[s].radius, settings[s].percent) ;
+        // two frames each, the second must not see the first
+        for (int f = 0; f < 2; f++) {
+            makeFrame((s + f) % 4) ;
+            if (checkFrame(&t, s) < 0) return 1 ;
+        }
+    }
+    printf("%d settings, masks match\n", n) ;
+    return 0 ;
+}
@@ -0,0 +1,168 @@
+/**
+ * morphcheck: the bit-parallel morphology against a pixel at a time
+ * reference
+ *
+ *   morphcheck [-s seed]
+ *
+ * Streams random masks (speckle, blobs and lines, with pixels in the
+ * first and last columns and rows) through morph.c for every operation,
+ * structuring element and iteration count, feeding the rows top down
+ * and bottom up as the camera does with the image flipped. Every row
+ * must come out exactly once, from morphRow or morphFlush, and match a
+ * reference that looks at each pixel's neighbours one by one, with
+ * outside the image counting as set for erosion and clear for dilation.
+ *
+ * Exits 1 on the first difference.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "morph.h"
+
+#define HEIGHT 96
+#define MASKS 4
+
+static uint8_t in[HEIGHT][MORPH_WIDTH], ref[HEIGHT][MORPH_WIDTH], tmp[HEIGHT][MORPH_WIDTH] ;
+static int seen[HEIGHT] ;
+
+static const char *const op_names[] = { "off", "erode", "dilate", "open", "close" } ;
+static const char *const shape_names[] = { "square", "cross", "hline", "vline" } ;
+
+static void makeMask(int kind) {
+    memset(in, 0, sizeof(in)) ;
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < MORPH_WIDTH; x++) {
+            switch (kind % 3) {
+                case 0: in[y][x] = rand() % 3 == 0 ; break ;
+                case 1: in[y][x] = rand() % 50 != 0 ; break ;      // pinholes
+                default: in[y][x] = (x % 7 == 0) || (y % 5 == 0) ; break ;
+            }
+        }
+    }
+    // blobs, some across the edges
+    for (int b = 0; b < 30; b++) {
+        int cx = rand() % (MORPH_WIDTH + 20) - 10, cy = rand() % (HEIGHT + 20) - 10, r = rand() % 12 ;
+        for (int y = cy - r; y <= cy + r; y++) {
+            for (int x = cx - r; x <= cx + r; x++) {
+                if (y >= 0 && y < HEIGHT && x >= 0 && x < MORPH_WIDTH) in[y][x] = kind & 1 ;
+            }
+        }
+    }
+}
+
+static int inElement(int shape, int dx, int dy) {
+    switch (shape) {
+        case MORPH_SQUARE: return 1 ;
+        case MORPH_CROSS: return dx == 0 || dy == 0 ;
+        case MORPH_HLINE: return dy == 0 ;
+        default: return dx == 0 ;
+    }
+}
+
+// One erosion or dilation of src into dst
+static void refStage(uint8_t (*src)[MORPH_WIDTH], uint8_t (*dst)[MORPH_WIDTH], int shape, int dilate) {
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < MORPH_WIDTH; x++) {
+            int v = !dilate ;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    int sx = x + dx, sy = y + dy ;
+                    if (!inElement(shape, dx, dy) || sx < 0 || sx >= MORPH_WIDTH || sy < 0 || sy >= HEIGHT) continue ;
+                    if (dilate && src[sy][sx]) v = 1 ;
+                    if (!dilate && !src[sy][sx]) v = 0 ;
+                }
+            }
+            dst[y][x] = v ;
+        }
+    }
+}
+
+static void refMorph(int op, int shape, int iterations) {
+    memcpy(ref, in, sizeof(ref)) ;
+    int stages[MORPH_MAX_STAGES], n = 0 ;
+    for (int i = 0; i < iterations && op != MORPH_OFF; i++) {
+        stages[n++] = op == MORPH_DILATE || op == MORPH_CLOSE ;
+    }
+    for (int i = 0; i < iterations && (op == MORPH_OPEN || op == MORPH_CLOSE); i++) {
+        stages[n++] = op == MORPH_OPEN ;
+    }
+    for (int s = 0; s < n; s++) {
+        refStage(ref, tmp, shape, stages[s]) ;
+        memcpy(ref, tmp, sizeof(ref)) ;
+    }
+}
+
+static int checkRow(const morph_filter *m, const char *what) {
+    int y = m->out_y ;
+    if (y < 0 || y >= HEIGHT || seen[y]++) {
+        printf("%s: row %d out of range or output twice\n", what, y) ;
+        return -1 ;
+    }
+    for (int x = 0; x < MORPH_WIDTH; x++) {
+        int bit = (m->out[x >> 5] >> (x & 31)) & 1 ;
+        if (bit != ref[y][x]) {
+            printf("%s: pixel %d,%d is %d, should be %d\n", what, x, y, bit, ref[y][x]) ;
+            return -1 ;
+        }
+    }
+    return 0 ;
+}
+
+static int check(morph_filter *m, int op, int shape, int iterations, int up) {
+    char what[80] ;
+    sprintf(what, "%s %s x%d %s", op_names[op], shape_names[shape], iterations, up ? "bottom up" : "top down") ;
+    morphInit(m, op, shape, iterations) ;
+    morphBeginFrame(m) ;
+    memset(seen, 0, sizeof(seen)) ;
+    uint32_t row[MORPH_WORDS] ;
+    for (int i = 0; i < HEIGHT; i++) {
+        int y = up ? HEIGHT - 1 - i : i ;
+        memset(row, 0, sizeof(row)) ;
+        for (int x = 0; x < MORPH_WIDTH; x++) row[x >> 5] |= (uint32_t)in[y][x] << (x & 31) ;
+        if (morphRow(m, y, row) && checkRow(m, what) < 0) return -1 ;
+    }
+    while (morphFlush(m)) {
+        if (checkRow(m, what) < 0) return -1 ;
+    }
+    for (int y = 0; y < HEIGHT; y++) {
+        if (!seen[y]) {
+            printf("%s: row %d never output\n", what, y) ;
+            return -1 ;
+        }
+    }
+    return 0 ;
+}
+
+int main(int argc, char **argv) {
+    unsigned int seed = 1 ;
+    int opt ;
+    while ((opt = getopt(argc, argv, "s:")) != -1) {
+        switch (opt) {
+            case 's': seed = strtoul(optarg, NULL, 0) ; break ;
+            default:
+                fprintf(stderr, "usage: %s [-s seed]\n", argv[0]) ;
+                return 2 ;
+        }
+    }
+    srand(seed) ;
+    morph_filter *m = (morph_filter *)malloc(sizeof(morph_filter)) ;
+    int checks = 0 ;
+    for (int k = 0; k < MASKS; k++) {
+        makeMask(k) ;
+        for (int op = 0; op < MORPH_OPS; op++) {
+            for (int shape = 0; shape < MORPH_SHAPES; shape++) {
+                for (int it = 1; it <= MORPH_MAX_ITERATIONS; it++) {
+                    refMorph(op, shape, it) ;
+                    for (int up = 0; up < 2; up++, checks++) {
+                        if (check(m, op, shape, it, up) < 0) return 1 ;
+                    }
+                }
+            }
+        }
+    }
+    free(m) ;
+    printf("%d filters, rows match\n", checks) ;
+    return 0 ;
+}
@@ -0,0 +1,130 @@
+/**
+ * The camera thread's frame processing on the host, see pipe_frame.h
+ */
+
+#include <string.h>
+#include "pixel_pipeline.hpp"
+extern "C" {
+#include "vga_graphics.h"
+}
+#include "pipe_frame.h"
+
+using namespace pipeline ;
+
+// Firmware defaults (2040camera.cpp)
+#define CONSECUTIVE_THRESHOLD 7
+#define DITHERING_NUMBER 3
+#define MAX_EDGES 10000
+#define HIST_INITIAL_THRESHOLD 63
+#define BG_ALPHA_SHIFT 4
+#define BG_K 10
+#define BG_MIN_DIFF 12
+#define LT_WINDOW 16
+#define LT_RADIUS 12
+#define LT_PERCENT 15
+
+const char *const pf_mode_names[PF_MODES] = {
+    "color", "bw_dark", "bw_background", "bw_auto", "bw_local", "edge_simple", "edge_lookback"
+} ;
+
+static uint8_t row_buffer[PF_WIDTH / 2] __attribute__((aligned(4))) ;
+static uint8_t mask_row[PF_WIDTH / 8] __attribute__((aligned(4))) ;
+// The firmware shares one buffer between these, only one is used at a time
+static short edge_locations[2][MAX_EDGES] ;
+static bg_cell bg_cells[BG_W * BG_H] ;
+static uint8_t lt_ring[LT_WINDOW * LT_WIDTH] ;
+static histogram luma_hist ;
+static bg_model background ;
+static local_threshold local_thr ;
+static lookback lookback_rows ;
+static context ctx ;
+
+void pfInit(void) {
+    initTables() ;
+    initVGA() ;
+    histInit(&luma_hist, HIST_INITIAL_THRESHOLD) ;
+    bgInit(&background, bg_cells, BG_ALPHA_SHIFT, BG_K, BG_MIN_DIFF) ;
+    ltInit(&local_thr, lt_ring, LT_WINDOW, LT_RADIUS, LT_PERCENT) ;
+    memset(&ctx, 0, sizeof(ctx)) ;
+    memset(edge_locations, 0, sizeof(edge_locations)) ;
+    ctx.row = row_buffer ;
+    ctx.mask = mask_row ;
+    ctx.lut = luma_hist.lut ;
+    ctx.hist = &luma_hist ;
+    ctx.background = &background ;
+    ctx.local = &local_thr ;
+    ctx.edge_x = edge_locations[0] ;
+    ctx.edge_y = edge_locations[1] ;
+    ctx.max_edges = MAX_EDGES ;
+    ctx.threshold = CONSECUTIVE_THRESHOLD ;
+    ctx.dither = DITHERING_NUMBER ;
+}
+
+static row_kernel kernelOf(int mode) {
+    switch (mode) {
+        case PF_BW_DARK: return modes<stage>::bw_dark::row ;
+        case PF_BW_BACKGROUND: return modes<stage>::bw_background::row ;
+        case PF_BW_AUTO: return modes<stage>::bw_auto::row ;
+        case PF_BW_LOCAL: return modes<stage>::bw_local::row ;
+        case PF_EDGE_SIMPLE: return edge_simple_mode::row ;
+        case PF_EDGE_LOOKBACK: return edge_lookback_mode::row ;
+        default: return modes<stage>::color::row ;
+    }
+}
+
+void pfFrame(int mode, const uint8_t *raw) {
+    row_kernel kernel = kernelOf(mode) ;
+    int edges = mode == PF_EDGE_SIMPLE || mode == PF_EDGE_LOOKBACK ;
+    if (mode != PF_BW_BACKGROUND && background.learned) bgReset(&background) ;
+    if (mode == PF_BW_LOCAL) ltBeginFrame(&local_thr) ;
+    lookbackBeginFrame(lookback_rows) ;
+    ctx.num_edges = 0 ;
+
+    for (int r = 0; r < PF_HEIGHT; r++) {
+        short y = PF_HEIGHT - 1 - r ;
+        kernel(ctx, y, &raw[r * PF_WIDTH]) ;
+        if (!edges) {
+            writeRowIfChanged(y, row_buffer) ;
+            clearDirtyRows(y, y) ;
+        }
+        else if (mode == PF_EDGE_LOOKBACK) {
+            lookbackRow(lookback_rows, ctx, mask_row, y) ;
+        }
+    }
+
+    if (mode == PF_BW_BACKGROUND) bgEndFrame(&background) ;
+    if (!edges) histEndFrame(&luma_hist) ;
+    if (edges) {
+        fillRect(0, 0, PF_WIDTH, PF_HEIGHT, BLACK) ;
+        for (int i = 0; i < MAX_EDGES; i++) drawPixel(edge_locations[0][i], edge_locations[1][i], WHITE) ;
+        memset(edge_locations, 0, sizeof(edge_locations)) ;
+    }
+}
+
+int pfEdges(void) {
+    return ctx.num_edges ;
+}
+
+const uint8_t *pfScreen(void) {
+    return vga_data_array ;
+}
+
+// Same frames on every host, unlike rand()
+static uint32_t synth_seed ;
+static int synthRandom(void) {
+    synth_seed = synth_seed * 1103515245u + 12345u ;
+    return (synth_seed >> 16) & 0x7fff ;
+}
+
+void pfSynthFrame(uint8_t *raw, int n) {
+    synth_seed = n + 1 ;
+    for (int y = 0; y < PF_HEIGHT; y++) {
+        for (int x = 0; x < PF_WIDTH; x++) {
+            int v = (x + y) * 255 / (PF_WIDTH + PF_HEIGHT) + synthRandom() % 16 ;
+            int dx = x - 200 - 4 * n, dy = y - 240 ;
+            if (dx * dx + dy * dy < 80 * 80) v = synthRandom() % 8 ;
+            if (x > 420 && x < 520 && y > 100 + 2 * n && y < 380) v = 255 - v ;
+            raw[(PF_HEIGHT - 1 - y) * PF_WIDTH + PF_WIDTH - 1 - x] = v > 255 ? 255 : v ;
+        }
+    }
+}
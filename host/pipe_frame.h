@@ -0,0 +1,50 @@
+/**
+ * pipe_frame: the camera thread's frame processing, on the host
+ *
+ * Runs 640x480 RAW frames (FIFO bytes in the order the sensor sends
+ * them, bottom row first and right to left) through the row kernels of
+ * cam_vga/pixel_pipeline.hpp and draws them into vga_data_array with
+ * vga_graphics.c built for the host (VGA_HOST), the way protothread_camera
+ * does: each finished row goes through writeRowIfChanged; in the edge
+ * modes the screen is cleared at the end of the frame and the edge
+ * points are drawn with drawPixel. Motion, blobs, morphology, overlays and
+ * streaming are left out. Settings are the firmware's defaults.
+ */
+
+#ifndef PIPE_FRAME_H
+#define PIPE_FRAME_H
+
+#include <stdint.h>
+
+#define PF_WIDTH 640
+#define PF_HEIGHT 480
+#define PF_FRAME_BYTES (PF_WIDTH * PF_HEIGHT)       // one RAW frame
+#define PF_SCREEN_BYTES (PF_WIDTH * PF_HEIGHT / 2)  // vga_data_array
+
+enum {
+    PF_COLOR,
+    PF_BW_DARK,
+    PF_BW_BACKGROUND,
+    PF_BW_AUTO,
+    PF_BW_LOCAL,
+    PF_EDGE_SIMPLE,
+    PF_EDGE_LOOKBACK,
+    PF_MODES
+} ;
+
+extern const char *const pf_mode_names[PF_MODES] ;
+
+// Blank the screen and forget everything learned from earlier frames
+void pfInit(void) ;
+// Process one frame of PF_FRAME_BYTES in the given mode
+void pfFrame(int mode, const uint8_t *raw) ;
+// Edge points found in the last frame (edge modes)
+int pfEdges(void) ;
+// The screen, PF_SCREEN_BYTES of packed pixels
+const uint8_t *pfScreen(void) ;
+
+// Synthetic frame n: a gradient with noise, a dark disc and an inverted
+// bar, both moving a little from frame to frame
+void pfSynthFrame(uint8_t *raw, int n) ;
+
+#endif
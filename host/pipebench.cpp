@@ -0,0 +1,250 @@
+/**
+ * pipebench: time the camera's per-mode pixel pipelines on the host
+ *
+ *   pipebench [-n frames] [-s pattern | -r frames.raw]
+ *
+ * Runs each mode's row kernel from cam_vga/pixel_pipeline.hpp over 640x480
+ * frames and prints ns and cycles per
+ * pixel, cycles from the time stamp counter on x86 only. The "branchy"
+ * rows run the per-pixel loop the camera thread used before the
+ * pipelines, mode flags reloaded from volatiles every pixel, for
+ * comparison. The "frame" rows time whole frames through pipe_frame.h,
+ * with the screen writes, lookback edges and edge drawing. The FIFO read
+ * is never timed.
+ *
+ * Frames are the synthetic ones of pipe_frame.h, or read through a
+ * cam_vga/frame_source.h source: a synthetic pattern (-s bars, gradient,
+ * checker or shapes) or the frames of a RAW file replayed (-r).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+#include "pixel_pipeline.hpp"
+#include "pipe_frame.h"
+#include "frame_source.h"
+
+using namespace pipeline ;
+
+#define FRAMES 4                // different synthetic frames, cycled
+#define MAX_EDGES 10000
+
+static uint8_t frames[FRAMES][PF_FRAME_BYTES] ;
+static uint8_t row[WIDTH / 2], mask[WIDTH / 8] ;
+static short edge_x[MAX_EDGES], edge_y[MAX_EDGES] ;
+static bg_cell cells[BG_W * BG_H] ;
+static uint8_t ring[16 * LT_WIDTH] ;
+static histogram hist ;
+static motion_detector motion ;
+static bg_model background ;
+static local_threshold local ;
+
+// The old loop's settings, volatile as they were in the firmware
+static volatile int color_enabled = 1 ;
+static volatile int edge_detection_en = 0 ;
+static volatile int consecutive_threshold = 7 ;
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-n frames] [-s pattern | -r frames.raw]\n", prog) ;
+    exit(2) ;
+}
+
+static double nowSec(void) {
+    struct timespec ts ;
+    clock_gettime(CLOCK_MONOTONIC, &ts) ;
+    return ts.tv_sec + ts.tv_nsec * 1e-9 ;
+}
+
+static uint64_t cycles(void) {
+#ifdef HAVE_TSC
+    return __rdtsc() ;
+#else
+    return 0 ;
+#endif
+}
+
+// The camera thread's pixel loop before the pipelines (color, B/W dark
+// and simple edges), with the histogram tap it had
+static void branchyRow(context &c, short y, const uint8_t *raw) {
+    for (int j = 0; j < WIDTH; j++) {
+        uint8_t color = raw[j] ;
+        uint8_t red = (int)(color>>6)>>1 ;
+        uint8_t green = (int)((color-(red<<6))>>4)>>1 ;
+        uint8_t blue = (int)((color>>2)%4)>>1 ;
+        int x = WIDTH - 1 - j ;
+        if (!edge_detection_en) histAdd(c.hist, color) ;
+        if (color_enabled) {
+            uint8_t v = (red<<2)+(green<<1)+blue ;
+            if (x & 1) c.row[x>>1] = (c.row[x>>1] & 0x07) | (v << 3) ;
+            else c.row[x>>1] = (c.row[x>>1] & 0x38) | v ;
+        }
+        else if (edge_detection_en == 1) {
+            if ((red<<2)+(green<<1)+blue == 0) {
+                if (c.consecutive == consecutive_threshold) {
+                    c.edge_x[c.num_edges] = x + 1 ;
+                    c.edge_y[c.num_edges] = y + 1 ;
+                    if (++c.num_edges >= c.max_edges) c.num_edges = 0 ;
+                }
+                if (++c.consecutive >= 9999) c.consecutive = 0 ;
+            }
+            else c.consecutive = 0 ;
+        }
+        else {
+            uint8_t v = (red<<2)+(green<<1)+blue == 0 ? PIX_WHITE : PIX_BLACK ;
+            if (x & 1) c.row[x>>1] = (c.row[x>>1] & 0x07) | (v << 3) ;
+            else c.row[x>>1] = (c.row[x>>1] & 0x38) | v ;
+        }
+    }
+}
+
+static void report(const char *name, int n, double t0, uint64_t c0) {
+    double pixels = (double)n * 480 * WIDTH ;
+    double ns = (nowSec() - t0) * 1e9 / pixels ;
+#ifdef HAVE_TSC
+    printf("%-22s %7.2f ns/pixel %7.2f cycles/pixel\n", name, ns, (cycles() - c0) / pixels) ;
+#else
+    (void)c0 ;
+    printf("%-22s %7.2f ns/pixel\n", name, ns) ;
+#endif
+}
+
+static void bench(const char *name, row_kernel kernel, int n, int color, int edges) {
+    context c ;
+    memset(&c, 0, sizeof(c)) ;
+    c.row = row ;
+    c.mask = mask ;
+    c.lut = hist.lut ;
+    c.hist = &hist ;
+    c.motion = &motion ;
+    c.background = &background ;
+    c.local = &local ;
+    c.edge_x = edge_x ;
+    c.edge_y = edge_y ;
+    c.max_edges = MAX_EDGES ;
+    c.threshold = consecutive_threshold ;
+    color_enabled = color ;
+    edge_detection_en = edges ;
+    bgReset(&background) ;
+    motionReset(&motion) ;
+
+    double t0 = 0 ;
+    uint64_t c0 = 0 ;
+    // one untimed frame to warm up and learn the background
+    for (int f = -1; f < n; f++) {
+        if (f == 0) {
+            t0 = nowSec() ;
+            c0 = cycles() ;
+        }
+        const uint8_t *frame = frames[(f + FRAMES) % FRAMES] ;
+        c.num_edges = 0 ;
+        ltBeginFrame(&local) ;
+        for (int r = 0; r < 480; r++) kernel(c, 479 - r, &frame[r * WIDTH]) ;
+        histEndFrame(&hist) ;
+        motionEndFrame(&motion) ;
+        bgEndFrame(&background) ;
+    }
+    report(name, n, t0, c0) ;
+}
+
+// Whole frames of a pipe_frame.h mode
+static void benchFrame(int mode, int n) {
+    char name[40] ;
+    snprintf(name, sizeof(name), "frame %s", pf_mode_names[mode]) ;
+    pfInit() ;
+    pfFrame(mode, frames[FRAMES - 1]) ;
+    double t0 = nowSec() ;
+    uint64_t c0 = cycles() ;
+    for (int f = 0; f < n; f++) pfFrame(mode, frames[f % FRAMES]) ;
+    report(name, n, t0, c0) ;
+}
+
+static uint8_t *readFile(const char *path, long *size) {
+    FILE *f = fopen(path, "rb") ;
+    if (!f) return NULL ;
+    fseek(f, 0, SEEK_END) ;
+    *size = ftell(f) ;
+    fseek(f, 0, SEEK_SET) ;
+    uint8_t *buf = (uint8_t *)malloc(*size > 0 ? *size : 1) ;
+    if (buf && fread(buf, 1, *size, f) != (size_t)*size) {
+        free(buf) ;
+        buf = NULL ;
+    }
+    fclose(f) ;
+    return buf ;
+}
+
+// The benchmark's frames from a frame source, read a row at a time as
+// the camera thread does
+static void sourceFrames(frame_source *s) {
+    for (int f = 0; f < FRAMES; f++) {
+        s->start(s) ;
+        for (int r = 0; r < 480; r++) s->read(s, &frames[f][r * WIDTH], WIDTH) ;
+    }
+}
+
+int main(int argc, char **argv) {
+    int n = 50, pattern = -1 ;
+    const char *replay = NULL ;
+    int opt ;
+    while ((opt = getopt(argc, argv, "n:s:r:")) != -1) {
+        switch (opt) {
+            case 'n': n = atoi(optarg) ; break ;
+            case 's':
+                for (pattern = 0; pattern < SRC_PATTERNS && strcmp(optarg, src_pattern_names[pattern]); pattern++) ;
+                if (pattern == SRC_PATTERNS) usage(argv[0]) ;
+                break ;
+            case 'r': replay = optarg ; break ;
+            default: usage(argv[0]) ;
+        }
+    }
+    if (n < 1 || optind != argc || (pattern >= 0 && replay)) usage(argv[0]) ;
+
+    initTables() ;
+    static frame_source source ;
+    if (pattern >= 0) {
+        srcSynthetic(&source, pattern) ;
+        sourceFrames(&source) ;
+        printf("frames: %s pattern\n", src_pattern_names[pattern]) ;
+    }
+    else if (replay) {
+        long size = 0 ;
+        uint8_t *data = readFile(replay, &size) ;
+        if (!data || size < PF_FRAME_BYTES) {
+            fprintf(stderr, "%s: not a RAW file of 640x480 frames\n", replay) ;
+            return 1 ;
+        }
+        srcReplay(&source, data, PF_FRAME_BYTES, size / PF_FRAME_BYTES) ;
+        sourceFrames(&source) ;
+        printf("frames: %s, %ld replayed\n", replay, size / PF_FRAME_BYTES) ;
+        free(data) ;
+    }
+    else {
+        for (int f = 0; f < FRAMES; f++) pfSynthFrame(frames[f], f) ;
+    }
+    histInit(&hist, 63) ;
+    motionInit(&motion, 6, 2, 10) ;
+    bgInit(&background, cells, 4, 10, 12) ;
+    ltInit(&local, ring, 16, 12, 15) ;
+
+    printf("%d frames of 640x480 per mode\n", n) ;
+    bench("color", modes<stage>::color::row, n, 1, 0) ;
+    bench("color + motion", modes<tap_motion>::color::row, n, 1, 0) ;
+    bench("bw dark", modes<stage>::bw_dark::row, n, 0, 0) ;
+    bench("bw dark + motion", modes<tap_motion>::bw_dark::row, n, 0, 0) ;
+    bench("bw background", modes<stage>::bw_background::row, n, 0, 0) ;
+    bench("bw auto threshold", modes<stage>::bw_auto::row, n, 0, 0) ;
+    bench("bw local threshold", modes<stage>::bw_local::row, n, 0, 0) ;
+    bench("edges simple", edge_simple_mode::row, n, 0, 1) ;
+    bench("edges lookback", edge_lookback_mode::row, n, 0, 2) ;
+    bench("branchy color", branchyRow, n, 1, 0) ;
+    bench("branchy bw dark", branchyRow, n, 0, 0) ;
+    bench("branchy edges simple", branchyRow, n, 0, 1) ;
+    for (int m = 0; m < PF_MODES; m++) benchFrame(m, n) ;
+    return 0 ;
+}
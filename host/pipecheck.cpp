@@ -0,0 +1,193 @@
+/**
+ * pipecheck: compare the host build of the camera pipeline with golden frames
+ *
+ *   pipecheck [-w] [-d dir] [-m mode] [-p] [frames.raw ...]
+ *
+ * Runs the synthetic frames (pipe_frame.h), then every RAW file given
+ * (any number of 640x480 frames of FIFO bytes, back to back), through
+ * each mode, or just -m mode, starting from a blank screen each time.
+ * The packed screen after every frame is compared with the golden file
+ * dir/<input>.<mode>.fb, which holds those screens back to back; -w
+ * writes the golden files instead. -p also writes the last screen as
+ * dir/<input>.<mode>.ppm to look at. Exits 1 on any difference or
+ * missing golden file.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "pipe_frame.h"
+
+#define SYNTH_FRAMES 4
+
+static uint8_t *golden ;
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-w] [-d dir] [-m mode] [-p] [frames.raw ...]\n", prog) ;
+    exit(2) ;
+}
+
+// The file name without directories or extension
+static void baseName(const char *path, char *out, int len) {
+    const char *slash = strrchr(path, '/') ;
+    snprintf(out, len, "%s", slash ? slash + 1 : path) ;
+    char *dot = strrchr(out, '.') ;
+    if (dot && dot != out) *dot = 0 ;
+}
+
+static uint8_t *readFile(const char *path, long *size) {
+    FILE *f = fopen(path, "rb") ;
+    if (!f) return NULL ;
+    fseek(f, 0, SEEK_END) ;
+    *size = ftell(f) ;
+    fseek(f, 0, SEEK_SET) ;
+    uint8_t *buf = (uint8_t *)malloc(*size > 0 ? *size : 1) ;
+    if (buf && fread(buf, 1, *size, f) != (size_t)*size) {
+        free(buf) ;
+        buf = NULL ;
+    }
+    fclose(f) ;
+    return buf ;
+}
+
+static void writePPM(const char *path, const uint8_t *screen) {
+    FILE *f = fopen(path, "wb") ;
+    if (!f) {
+        perror(path) ;
+        return ;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", PF_WIDTH, PF_HEIGHT) ;
+    for (int p = 0; p < PF_WIDTH * PF_HEIGHT; p++) {
+        uint8_t c = (p & 1) ? (screen[p >> 1] >> 3) & 7 : screen[p >> 1] & 7 ;
+        // enum colors: bit 0 red, bit 1 green, bit 2 blue
+        uint8_t rgb[3] = { (uint8_t)(c & 1 ? 255 : 0), (uint8_t)(c & 2 ? 255 : 0), (uint8_t)(c & 4 ? 255 : 0) } ;
+        fwrite(rgb, 1, 3, f) ;
+    }
+    fclose(f) ;
+}
+
+// Number of pixels that differ between two packed screens, and the first
+static int diffScreens(const uint8_t *a, const uint8_t *b, int *first) {
+    int n = 0 ;
+    *first = -1 ;
+    for (int i = 0; i < PF_SCREEN_BYTES; i++) {
+        if (a[i] == b[i]) continue ;
+        for (int k = 0; k < 2; k++) {
+            int shift = 3 * k ;
+            if (((a[i] >> shift) & 7) == ((b[i] >> shift) & 7)) continue ;
+            if (*first < 0) *first = 2 * i + k ;
+            n++ ;
+        }
+    }
+    return n ;
+}
+
+// Run one input through one mode. Returns 0 if it matches (or was written).
+static int check(const char *dir, const char *name, const uint8_t *frames, int n, int mode, int write, int ppm) {
+    char path[512] ;
+    snprintf(path, sizeof(path), "%s/%s.%s.fb", dir, name, pf_mode_names[mode]) ;
+    uint8_t *out = (uint8_t *)malloc((size_t)n * PF_SCREEN_BYTES) ;
+    if (!out) {
+        fprintf(stderr, "out of memory\n") ;
+        exit(1) ;
+    }
+    pfInit() ;
+    for (int f = 0; f < n; f++) {
+        pfFrame(mode, &frames[(size_t)f * PF_FRAME_BYTES]) ;
+        memcpy(&out[(size_t)f * PF_SCREEN_BYTES], pfScreen(), PF_SCREEN_BYTES) ;
+    }
+    if (ppm) {
+        char ppm_path[512] ;
+        snprintf(ppm_path, sizeof(ppm_path), "%s/%s.%s.ppm", dir, name, pf_mode_names[mode]) ;
+        writePPM(ppm_path, pfScreen()) ;
+    }
+
+    int result = 0 ;
+    if (write) {
+        FILE *f = fopen(path, "wb") ;
+        if (!f || fwrite(out, PF_SCREEN_BYTES, n, f) != (size_t)n) {
+            perror(path) ;
+            result = 1 ;
+        }
+        else printf("wrote %s, %d frames\n", path, n) ;
+        if (f) fclose(f) ;
+        free(out) ;
+        return result ;
+    }
+
+    long size = 0 ;
+    free(golden) ;
+    golden = readFile(path, &size) ;
+    if (!golden) {
+        printf("%-32s missing\n", path) ;
+        free(out) ;
+        return 1 ;
+    }
+    if (size != (long)n * PF_SCREEN_BYTES) {
+        printf("%-32s %ld bytes, expected %d frames\n", path, size, n) ;
+        free(out) ;
+        return 1 ;
+    }
+    for (int f = 0; f < n; f++) {
+        int first ;
+        int d = diffScreens(&out[(size_t)f * PF_SCREEN_BYTES], &golden[(size_t)f * PF_SCREEN_BYTES], &first) ;
+        if (!d) continue ;
+        printf("%-32s frame %d: %d pixels differ, first at %d,%d\n", path, f, d, first % PF_WIDTH, first / PF_WIDTH) ;
+        result = 1 ;
+    }
+    if (!result) printf("%-32s ok, %d frames\n", path, n) ;
+    free(out) ;
+    return result ;
+}
+
+int main(int argc, char **argv) {
+    const char *dir = "." ;
+    int write = 0, ppm = 0, only = -1 ;
+    int opt ;
+    while ((opt = getopt(argc, argv, "wd:m:p")) != -1) {
+        switch (opt) {
+            case 'w': write = 1 ; break ;
+            case 'd': dir = optarg ; break ;
+            case 'p': ppm = 1 ; break ;
+            case 'm':
+                for (only = 0; only < PF_MODES && strcmp(optarg, pf_mode_names[only]); only++) ;
+                if (only == PF_MODES) {
+                    fprintf(stderr, "modes:") ;
+                    for (int m = 0; m < PF_MODES; m++) fprintf(stderr, " %s", pf_mode_names[m]) ;
+                    fprintf(stderr, "\n") ;
+                    exit(2) ;
+                }
+                break ;
+            default: usage(argv[0]) ;
+        }
+    }
+
+    int failed = 0 ;
+    static uint8_t synth[SYNTH_FRAMES][PF_FRAME_BYTES] ;
+    for (int f = 0; f < SYNTH_FRAMES; f++) pfSynthFrame(synth[f], f) ;
+    for (int m = 0; m < PF_MODES; m++) {
+        if (only < 0 || only == m) failed |= check(dir, "synthetic", &synth[0][0], SYNTH_FRAMES, m, write, ppm) ;
+    }
+
+    for (int i = optind; i < argc; i++) {
+        long size = 0 ;
+        uint8_t *frames = readFile(argv[i], &size) ;
+        if (!frames || size < PF_FRAME_BYTES) {
+            fprintf(stderr, "%s: not a RAW file of 640x480 frames\n", argv[i]) ;
+            free(frames) ;
+            failed = 1 ;
+            continue ;
+        }
+        if (size % PF_FRAME_BYTES) {
+            fprintf(stderr, "%s: ignoring %ld bytes after the last whole frame\n", argv[i], size % PF_FRAME_BYTES) ;
+        }
+        char name[256] ;
+        baseName(argv[i], name, sizeof(name)) ;
+        for (int m = 0; m < PF_MODES; m++) {
+            if (only < 0 || only == m) failed |= check(dir, name, frames, size / PF_FRAME_BYTES, m, write, ppm) ;
+        }
+        free(frames) ;
+    }
+    return failed ;
+}
@@ -0,0 +1,240 @@
+/**
+ * rastercheck: compare the rasterisers of vga_graphics.c with the
+ * drawPixel versions they replaced
+ *
+ *   rastercheck [-n shapes] [-s seed]
+ *
+ * Draws random lines, circles, filled circles, rounded rectangles and
+ * horizontal and vertical lines, many of them partly or wholly off
+ * screen, with the host build of vga_graphics.c (VGA_HOST) and with the
+ * original Bresenham and midpoint code below, which went through
+ * drawPixel for every point. The packed screens must be pixel for pixel
+ * the same. drawPixel clamped off-screen points onto the screen edge;
+ * the rasterisers drop them instead, so the reference drops them too.
+ * Exits 1 on the first difference.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "vga_graphics.h"
+
+#define WIDTH 640
+#define HEIGHT 480
+#define SCREEN_BYTES (WIDTH * HEIGHT / 2)
+#define BATCH 500               // shapes drawn between comparisons
+
+static unsigned char ref_screen[SCREEN_BYTES] ;
+
+#define swap(a, b) { short t = a; a = b; b = t; }
+
+// The original drawing code, on ref_screen
+static void refPixel(short x, short y, char color) {
+    if (x > 639 || x < 0 || y < 0 || y > 479) return ;
+    int pixel = ((640 * y) + x) ;
+    if (pixel & 1) ref_screen[pixel >> 1] = (ref_screen[pixel >> 1] & 0xc7) | (color << 3) ;
+    else ref_screen[pixel >> 1] = (ref_screen[pixel >> 1] & 0xf8) | color ;
+}
+
+static void refVLine(short x, short y, short h, char color) {
+    for (short i = y; i < (y + h); i++) refPixel(x, i, color) ;
+}
+
+static void refHLine(short x, short y, short w, char color) {
+    for (short i = x; i < (x + w); i++) refPixel(i, y, color) ;
+}
+
+static void refLine(short x0, short y0, short x1, short y1, char color) {
+    short steep = abs(y1 - y0) > abs(x1 - x0) ;
+    if (steep) {
+        swap(x0, y0) ;
+        swap(x1, y1) ;
+    }
+    if (x0 > x1) {
+        swap(x0, x1) ;
+        swap(y0, y1) ;
+    }
+    short dx = x1 - x0, dy = abs(y1 - y0) ;
+    short err = dx / 2 ;
+    short ystep = y0 < y1 ? 1 : -1 ;
+    for (; x0 <= x1; x0++) {
+        if (steep) refPixel(y0, x0, color) ;
+        else refPixel(x0, y0, color) ;
+        err -= dy ;
+        if (err < 0) {
+            y0 += ystep ;
+            err += dx ;
+        }
+    }
+}
+
+static void refCircle(short x0, short y0, short r, char color) {
+    short f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0, y = r ;
+    refPixel(x0, y0 + r, color) ;
+    refPixel(x0, y0 - r, color) ;
+    refPixel(x0 + r, y0, color) ;
+    refPixel(x0 - r, y0, color) ;
+    while (x < y) {
+        if (f >= 0) {
+            y-- ;
+            ddF_y += 2 ;
+            f += ddF_y ;
+        }
+        x++ ;
+        ddF_x += 2 ;
+        f += ddF_x ;
+        refPixel(x0 + x, y0 + y, color) ;
+        refPixel(x0 - x, y0 + y, color) ;
+        refPixel(x0 + x, y0 - y, color) ;
+        refPixel(x0 - x, y0 - y, color) ;
+        refPixel(x0 + y, y0 + x, color) ;
+        refPixel(x0 - y, y0 + x, color) ;
+        refPixel(x0 + y, y0 - x, color) ;
+        refPixel(x0 - y, y0 - x, color) ;
+    }
+}
+
+static void refCircleHelper(short x0, short y0, short r, unsigned char cornername, char color) {
+    short f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0, y = r ;
+    while (x < y) {
+        if (f >= 0) {
+            y-- ;
+            ddF_y += 2 ;
+            f += ddF_y ;
+        }
+        x++ ;
+        ddF_x += 2 ;
+        f += ddF_x ;
+        if (cornername & 0x4) {
+            refPixel(x0 + x, y0 + y, color) ;
+            refPixel(x0 + y, y0 + x, color) ;
+        }
+        if (cornername & 0x2) {
+            refPixel(x0 + x, y0 - y, color) ;
+            refPixel(x0 + y, y0 - x, color) ;
+        }
+        if (cornername & 0x8) {
+            refPixel(x0 - y, y0 + x, color) ;
+            refPixel(x0 - x, y0 + y, color) ;
+        }
+        if (cornername & 0x1) {
+            refPixel(x0 - y, y0 - x, color) ;
+            refPixel(x0 - x, y0 - y, color) ;
+        }
+    }
+}
+
+static void refFillCircleHelper(short x0, short y0, short r, unsigned char cornername, short delta, char color) {
+    short f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0, y = r ;
+    while (x < y) {
+        if (f >= 0) {
+            y-- ;
+            ddF_y += 2 ;
+            f += ddF_y ;
+        }
+        x++ ;
+        ddF_x += 2 ;
+        f += ddF_x ;
+        if (cornername & 0x1) {
+            refVLine(x0 + x, y0 - y, 2 * y + 1 + delta, color) ;
+            refVLine(x0 + y, y0 - x, 2 * x + 1 + delta, color) ;
+        }
+        if (cornername & 0x2) {
+            refVLine(x0 - x, y0 - y, 2 * y + 1 + delta, color) ;
+            refVLine(x0 - y, y0 - x, 2 * x + 1 + delta, color) ;
+        }
+    }
+}
+
+static void refFillCircle(short x0, short y0, short r, char color) {
+    refVLine(x0, y0 - r, 2 * r + 1, color) ;
+    refFillCircleHelper(x0, y0, r, 3, 0, color) ;
+}
+
+static void refRoundRect(short x, short y, short w, short h, short r, char color) {
+    refHLine(x + r, y, w - 2 * r, color) ;
+    refHLine(x + r, y + h - 1, w - 2 * r, color) ;
+    refVLine(x, y + r, h - 2 * r, color) ;
+    refVLine(x + w - 1, y + r, h - 2 * r, color) ;
+    refCircleHelper(x + r, y + r, r, 1, color) ;
+    refCircleHelper(x + w - r - 1, y + r, r, 2, color) ;
+    refCircleHelper(x + w - r - 1, y + h - r - 1, r, 4, color) ;
+    refCircleHelper(x + r, y + h - r - 1, r, 8, color) ;
+}
+
+static const char *const shape_names[] = {
+    "line", "line", "circle", "filled circle", "rounded rectangle", "h/v lines"
+} ;
+
+// Draws shape number i both ways
+static void drawShape(int i) {
+    int kind = i % 6 ;
+    int big = rand() % 4 == 0 ;
+    int range = big ? 2000 : 700 ;              // beyond the screen on every side
+    short x0 = rand() % range - (range - WIDTH) / 2, y0 = rand() % range - (range - HEIGHT) / 2 ;
+    short x1 = rand() % range - (range - WIDTH) / 2, y1 = rand() % range - (range - HEIGHT) / 2 ;
+    short r = rand() % (big ? 400 : 120) - 2 ;
+    char c = rand() & 7 ;
+    switch (kind) {
+        case 0:
+        case 1:
+            drawLine(x0, y0, x1, y1, c) ;
+            refLine(x0, y0, x1, y1, c) ;
+            break ;
+        case 2:
+            drawCircle(x0, y0, r, c) ;
+            refCircle(x0, y0, r, c) ;
+            break ;
+        case 3:
+            fillCircle(x0, y0, r, c) ;
+            refFillCircle(x0, y0, r, c) ;
+            break ;
+        case 4: {
+            short w = rand() % 300, h = rand() % 300, rr = rand() % 40 ;
+            drawRoundRect(x0, y0, w, h, rr, c) ;
+            refRoundRect(x0, y0, w, h, rr, c) ;
+            break ;
+        }
+        default:
+            drawHLine(x0, y0, x1 - x0, c) ;
+            drawVLine(x0, y0, y1 - y0, c) ;
+            refHLine(x0, y0, x1 - x0, c) ;
+            refVLine(x0, y0, y1 - y0, c) ;
+            break ;
+    }
+}
+
+int main(int argc, char **argv) {
+    int n = 40000 ;
+    unsigned int seed = 3 ;
+    int opt ;
+    while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+        switch (opt) {
+            case 'n': n = atoi(optarg) ; break ;
+            case 's': seed = strtoul(optarg, NULL, 0) ; break ;
+            default:
+                fprintf(stderr, "usage: %s [-n shapes] [-s seed]\n", argv[0]) ;
+                return 2 ;
+        }
+    }
+
+    initVGA() ;
+    memset(ref_screen, 0, sizeof(ref_screen)) ;
+    srand(seed) ;
+    for (int i = 0; i < n; i++) {
+        drawShape(i) ;
+        if (i % BATCH != BATCH - 1 && i != n - 1) continue ;
+        for (int b = 0; b < SCREEN_BYTES; b++) {
+            if ((vga_data_array[b] & 0x3f) == (ref_screen[b] & 0x3f)) continue ;
+            int p = 2 * b + (((vga_data_array[b] ^ ref_screen[b]) & 7) == 0) ;
+            printf("shapes %d-%d (last a %s): pixel %d,%d differs\n", i - i % BATCH, i,
+                   shape_names[i % 6], p % WIDTH, p / WIDTH) ;
+            return 1 ;
+        }
+        memset(vga_data_array, 0, SCREEN_BYTES) ;
+        memset(ref_screen, 0, sizeof(ref_screen)) ;
+    }
+    printf("%d shapes, screens match\n", n) ;
+    return 0 ;
+}
@@ -0,0 +1,264 @@
+/**
+ * schedcheck: the protothread schedulers against a simulated clock
+ *
+ *   schedcheck
+ *
+ * Builds pt_cornell_rp2040_v1.h on the host with a fake timer_hw whose
+ * timerawl only moves when a thread spends time or a core sleeps in
+ * best_effort_wfe_or_timeout (the wait is skipped straight to its end).
+ * Every run starts just before the 32 bit microsecond timer wraps, at a
+ * different offset each time, so wake times and releases land on both
+ * sides of the wrap.
+ *
+ *  - sleepers: threads in PT_YIELD_usec and PT_YIELD_INTERVAL, under the
+ *    round-robin pass and the SCHED_RATE step. Each must run its body on
+ *    every call it gets (no re-parking), never before its wake time and
+ *    not much after it.
+ *  - deadlines: periodic threads of different periods and deadlines and
+ *    a background thread under SCHED_RATE. Every call must go to the
+ *    released periodic thread with the earliest deadline, the background
+ *    thread only when none is released, with no overruns and every
+ *    release served.
+ *
+ * Exits 1 on the first failure.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// === the pico-sdk calls the scheduler uses, on a simulated clock ===
+static struct { volatile uint32_t timerawl ; } sim_timer ;
+#define timer_hw (&sim_timer)
+typedef uint32_t absolute_time_t ;
+typedef volatile uint32_t spin_lock_t ;
+static inline int get_core_num(void) { return 0 ; }
+static inline absolute_time_t make_timeout_time_us(uint64_t us) { return sim_timer.timerawl + (uint32_t)us ; }
+static inline int best_effort_wfe_or_timeout(absolute_time_t t) {
+    if ((int32_t)(t - sim_timer.timerawl) > 0) sim_timer.timerawl = t ;
+    return 1 ;
+}
+// uart0, unused here
+#define uart0 0
+#define UART0_IRQ 20
+static inline int uart_is_readable(int u) { (void)u ; return 0 ; }
+static inline int uart_is_writable(int u) { (void)u ; return 1 ; }
+static inline char uart_getc(int u) { (void)u ; return 0 ; }
+static inline void uart_putc(int u, char c) { (void)u ; (void)c ; }
+static inline void uart_putc_raw(int u, char c) { (void)u ; (void)c ; }
+static inline void uart_set_irq_enables(int u, int rx, int tx) { (void)u ; (void)rx ; (void)tx ; }
+static inline void uart_set_baudrate(int u, unsigned int baud) { (void)u ; (void)baud ; }
+static inline void irq_set_exclusive_handler(int irq, void (*handler)(void)) { (void)irq ; (void)handler ; }
+static inline void irq_set_enabled(int irq, int on) { (void)irq ; (void)on ; }
+
+#include "pt_cornell_rp2040_v1.h"
+
+#define RUNS 64                 // start offsets before the wrap
+#define RUN_US 40000            // simulated time per run
+#define MAX_STEPS 1000000       // scheduler steps per run before giving up
+#define SLACK_US 200            // lateness allowed: the other threads' calls
+
+typedef struct {
+    const char *name ;
+    unsigned int delay ;        // sleep, interval, or period
+    unsigned int deadline ;     // periodic threads, 0 = the period
+    unsigned int cost ;         // usec spent per call
+    unsigned int calls, runs ;
+    uint32_t last ;             // when it last yielded (sleepers) or started (interval)
+    int started ;
+} sim_thread ;
+
+static sim_thread sim[MAX_THREADS] ;
+static int sim_count ;
+static int failures ;
+static int checking_deadlines ;
+
+static void fail(const char *what, const sim_thread *t) {
+    if (failures++ < 10) {
+        printf("%s: %s at %08x\n", t ? t->name : "scheduler", what, (unsigned int)sim_timer.timerawl) ;
+    }
+}
+
+static void spend(unsigned int us) {
+    sim_timer.timerawl += us ;
+}
+
+// Every call of a thread: in the deadline runs, check it is the one EDF picks
+static void threadCalled(int num) {
+    sim[num].calls++ ;
+    if (!checking_deadlines) return ;
+    struct ptx *called = &pt_thread_list[num] ;
+    uint32_t now = sim_timer.timerawl ;
+    for (int i = 0; i < pt_task_count; i++) {
+        struct ptx *p = &pt_thread_list[i] ;
+        if (p == called || p->sleeping || p->period == 0 || (int32_t)(p->release - now) > 0) continue ;
+        if (called->period == 0) fail("background thread called while a periodic one is released", &sim[num]) ;
+        else if ((int32_t)((p->release + p->deadline) - (called->release + called->deadline)) < 0) {
+            fail("called before a released thread with an earlier deadline", &sim[num]) ;
+        }
+    }
+}
+
+// Body of a sleeper, after it comes back from sleeping d usec
+static void sleeperRun(sim_thread *t) {
+    uint32_t now = sim_timer.timerawl ;
+    t->runs++ ;
+    if (t->started) {
+        int slept = (int32_t)(now - t->last) ;
+        if (slept < (int)t->delay) fail("woke early", t) ;
+        if (slept > (int)(t->delay + SLACK_US)) fail("woke late", t) ;
+    }
+    t->started = 1 ;
+    spend(t->cost) ;
+    t->last = sim_timer.timerawl ;
+}
+
+#define SLEEPER(name, n) \
+static PT_THREAD (name(struct pt *pt)) { \
+    PT_BEGIN(pt) ; \
+    while (1) { \
+        sleeperRun(&sim[n]) ; \
+        PT_YIELD_usec(sim[n].delay) ; \
+    } \
+    PT_END(pt) ; \
+}
+SLEEPER(sleeper0, 0)
+SLEEPER(sleeper1, 1)
+
+// Interval thread: starts every delay usec
+static PT_THREAD (interval2(struct pt *pt)) {
+    PT_BEGIN(pt) ;
+    PT_INTERVAL_INIT() ;
+    pt_interval_started = 0 ;
+    while (1) {
+        sim_thread *t = &sim[2] ;
+        uint32_t now = sim_timer.timerawl ;
+        t->runs++ ;
+        // the first interval starts at the first yield, which returns at once
+        if (t->runs > 2) {
+            int gap = (int32_t)(now - t->last) ;
+            if (gap < (int)t->delay) fail("interval short", t) ;
+            if (gap > (int)(t->delay + SLACK_US)) fail("interval long", t) ;
+        }
+        t->started = 1 ;
+        t->last = now ;
+        spend(t->cost) ;
+        PT_YIELD_INTERVAL(t->delay) ;
+    }
+    PT_END(pt) ;
+}
+
+// Periodic and background threads: spend their cost once per release
+#define WORKER(name, n) \
+static PT_THREAD (name(struct pt *pt)) { \
+    PT_BEGIN(pt) ; \
+    while (1) { \
+        sim[n].runs++ ; \
+        spend(sim[n].cost) ; \
+        PT_YIELD(pt) ; \
+    } \
+    PT_END(pt) ; \
+}
+WORKER(worker0, 0)
+WORKER(worker1, 1)
+WORKER(worker2, 2)
+WORKER(worker3, 3)
+
+// What the scheduler is given: the thread, counting its calls first
+#define CALLED(name, n) \
+static PT_THREAD (name##Called(struct pt *pt)) { \
+    threadCalled(n) ; \
+    return name(pt) ; \
+}
+CALLED(sleeper0, 0)
+CALLED(sleeper1, 1)
+CALLED(interval2, 2)
+CALLED(worker0, 0)
+CALLED(worker1, 1)
+CALLED(worker2, 2)
+CALLED(worker3, 3)
+
+static void reset(uint32_t start) {
+    sim_timer.timerawl = start ;
+    memset(pt_thread_list, 0, sizeof(pt_thread_list)) ;
+    memset(pt_sleepers, 0, sizeof(pt_sleepers)) ;
+    memset(sim, 0, sizeof(sim)) ;
+    pt_task_count = 0 ;
+    sim_count = 0 ;
+}
+
+static void addThread(char (*pf)(struct pt *pt), const char *name, unsigned int delay,
+                      unsigned int deadline, unsigned int cost, int periodic) {
+    sim_thread *t = &sim[sim_count++] ;
+    t->name = name ;
+    t->delay = delay ;
+    t->deadline = deadline ;
+    t->cost = cost ;
+    if (periodic) pt_add_rate(pf, delay, deadline) ;
+    else pt_add(pf) ;
+}
+
+// Run the scheduler for RUN_US of simulated time
+static void run(int method) {
+    uint32_t start = sim_timer.timerawl ;
+    int steps = 0 ;
+    while ((int32_t)(sim_timer.timerawl - start) < RUN_US) {
+        if (++steps > MAX_STEPS) {
+            fail("no progress", NULL) ;
+            return ;
+        }
+        if (method == SCHED_RATE) pt_sched_rate_step(pt_thread_list, pt_task_count, 0) ;
+        else pt_sched_rr_pass(pt_thread_list, pt_task_count, 0) ;
+    }
+}
+
+static void checkSleepers(int method, uint32_t start) {
+    reset(start) ;
+    addThread(sleeper0Called, "PT_YIELD_usec(1000)", 1000, 0, 40, 0) ;
+    addThread(sleeper1Called, "PT_YIELD_usec(3300)", 3300, 0, 60, 0) ;
+    addThread(interval2Called, "PT_YIELD_INTERVAL(700)", 700, 0, 30, 0) ;
+    run(method) ;
+    for (int i = 0; i < sim_count; i++) {
+        sim_thread *t = &sim[i] ;
+        // one call without a run is allowed: the first yield
+        if (t->calls > t->runs + 1) fail("called while still asleep", t) ;
+        if (t->runs < RUN_US / (t->delay + t->cost + SLACK_US)) fail("ran too few times", t) ;
+    }
+}
+
+static void checkDeadlines(uint32_t start) {
+    reset(start) ;
+    addThread(worker0Called, "period 1000", 1000, 0, 150, 1) ;
+    addThread(worker1Called, "period 2500 deadline 600", 2500, 600, 200, 1) ;
+    addThread(worker2Called, "period 4000", 4000, 0, 300, 1) ;
+    addThread(worker3Called, "background", 0, 0, 40, 0) ;
+    checking_deadlines = 1 ;
+    run(SCHED_RATE) ;
+    checking_deadlines = 0 ;
+    for (int i = 0; i < sim_count; i++) {
+        sim_thread *t = &sim[i] ;
+        if (pt_thread_list[i].overruns) fail("overran its deadline", t) ;
+        if (t->delay && (t->runs < RUN_US / t->delay || t->runs > RUN_US / t->delay + 1)) {
+            fail("missed releases", t) ;
+        }
+        if (!t->delay && !t->runs) fail("never ran", t) ;
+    }
+}
+
+int main(void) {
+    for (int r = 0; r < RUNS; r++) {
+        // from just before the wrap to a little over a run before it
+        uint32_t start = 0u - 1u - (uint32_t)r * (RUN_US / RUNS + 13) ;
+        checkSleepers(SCHED_ROUND_ROBIN, start) ;
+        checkSleepers(SCHED_RATE, start) ;
+        checkDeadlines(start) ;
+    }
+    if (failures) {
+        printf("%d failures\n", failures) ;
+        return 1 ;
+    }
+    printf("%d runs across the timer wrap ok\n", RUNS) ;
+    return 0 ;
+}
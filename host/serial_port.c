@@ -0,0 +1,51 @@
+/**
+ * Serial port helpers for the host tools, see serial_port.h
+ */
+
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include "serial_port.h"
+
+static speed_t baudToSpeed(int baud) {
+    switch (baud) {
+        case 9600: return B9600 ;
+        case 19200: return B19200 ;
+        case 38400: return B38400 ;
+        case 57600: return B57600 ;
+        case 115200: return B115200 ;
+        case 230400: return B230400 ;
+        case 460800: return B460800 ;
+        case 921600: return B921600 ;
+        default: return 0 ;
+    }
+}
+
+int serialOpen(const char *path, int baud) {
+    struct termios tio ;
+    speed_t speed = baudToSpeed(baud) ;
+    if (!speed) {
+        errno = EINVAL ;
+        return -1 ;
+    }
+    int fd = open(path, O_RDWR | O_NOCTTY) ;
+    if (fd < 0) return -1 ;
+    if (tcgetattr(fd, &tio) < 0) {
+        close(fd) ;
+        return -1 ;
+    }
+    cfmakeraw(&tio) ;
+    cfsetispeed(&tio, speed) ;
+    cfsetospeed(&tio, speed) ;
+    tio.c_cflag |= CLOCAL | CREAD ;
+    tio.c_cc[VMIN] = 0 ;
+    tio.c_cc[VTIME] = 0 ;
+    if (tcsetattr(fd, TCSANOW, &tio) < 0) {
+        close(fd) ;
+        return -1 ;
+    }
+    tcflush(fd, TCIOFLUSH) ;
+    return fd ;
+}
@@ -0,0 +1,12 @@
+/**
+ * Serial port helpers for the host tools
+ */
+
+#ifndef SERIAL_PORT_H
+#define SERIAL_PORT_H
+
+// Open a tty in raw 8N1 mode at baud (ignored by USB CDC ports).
+// Returns the descriptor, or -1 with errno set
+int serialOpen(const char *path, int baud) ;
+
+#endif
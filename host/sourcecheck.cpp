@@ -0,0 +1,181 @@
+/**
+ * sourcecheck: the synthetic and replay frame sources
+ *
+ *   sourcecheck
+ *
+ * Reads frames from frame_source.c in pieces of many sizes, the way the
+ * camera thread and the host tools do, and checks them in screen
+ * coordinates (bytes come bottom row first, right to left), decoded with
+ * the pipeline's color table:
+ *
+ *  - every piece size gives the same bytes, and reads past the end zeros
+ *  - bars: the 8 display colors in order, 80 pixels each, on every row
+ *  - gradient: rising to the right and downwards, from 0 to 255
+ *  - checker: 40 pixel squares alternating black and white
+ *  - shapes: a whole dark disc moving 4 pixels right and a yellow square
+ *    moving 3 pixels down every frame, on white
+ *  - replay: the frames given, in turn and round again, and an empty
+ *    list gives empty frames
+ *
+ * Exits 1 on the first failure.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pixel_pipeline.hpp"
+extern "C" {
+#include "frame_source.h"
+}
+
+static uint8_t frame[SRC_FRAME_BYTES], again[SRC_FRAME_BYTES] ;
+
+static void fail(const char *pattern, const char *what, int x, int y) {
+    printf("%s: %s at %d,%d\n", pattern, what, x, y) ;
+    exit(1) ;
+}
+
+// FIFO byte at screen x, y
+static uint8_t at(const uint8_t *f, int x, int y) {
+    return f[(SRC_HEIGHT - 1 - y) * SRC_WIDTH + (SRC_WIDTH - 1 - x)] ;
+}
+
+static uint8_t colorAt(const uint8_t *f, int x, int y) {
+    return pipeline::tables<>::color_of[at(f, x, y)] ;
+}
+
+// Read a frame in pieces of the given size
+static void readFrame(frame_source *s, uint8_t *out, uint32_t piece) {
+    s->start(s) ;
+    uint32_t len = s->length(s) ;
+    for (uint32_t pos = 0; pos < len; pos += piece) s->read(s, &out[pos], piece < len - pos ? piece : len - pos) ;
+}
+
+// The same frame read whole and in odd pieces, then a read past its end
+static void checkPieces(uint8_t pattern) {
+    static const uint32_t pieces[] = { 1, 7, SRC_WIDTH - 1, SRC_WIDTH, 1000, SRC_FRAME_BYTES } ;
+    const char *name = src_pattern_names[pattern] ;
+    for (unsigned int p = 0; p < sizeof(pieces) / sizeof(pieces[0]); p++) {
+        frame_source s ;
+        srcSynthetic(&s, pattern) ;
+        if (s.length(&s) != SRC_FRAME_BYTES) fail(name, "wrong length", 0, 0) ;
+        readFrame(&s, again, pieces[p]) ;
+        if (p == 0) memcpy(frame, again, sizeof(frame)) ;
+        else if (memcmp(frame, again, sizeof(frame))) fail(name, "read in pieces differs", pieces[p], 0) ;
+        uint8_t past[16] ;
+        memset(past, 0xff, sizeof(past)) ;
+        s.read(&s, past, sizeof(past)) ;
+        for (unsigned int i = 0; i < sizeof(past); i++) {
+            if (past[i]) fail(name, "read past the end not zero", i, 0) ;
+        }
+    }
+}
+
+static void checkBars(void) {
+    for (int y = 0; y < SRC_HEIGHT; y++) {
+        for (int x = 0; x < SRC_WIDTH; x++) {
+            if (colorAt(frame, x, y) != x / (SRC_WIDTH / 8)) fail("bars", "wrong color", x, y) ;
+        }
+    }
+}
+
+static void checkGradient(void) {
+    if (at(frame, 0, 0) != 0 || at(frame, SRC_WIDTH - 1, SRC_HEIGHT - 1) != 255) fail("gradient", "ends not 0 and 255", 0, 0) ;
+    for (int y = 0; y < SRC_HEIGHT; y++) {
+        for (int x = 0; x < SRC_WIDTH; x++) {
+            if (x && at(frame, x, y) < at(frame, x - 1, y)) fail("gradient", "falls to the right", x, y) ;
+            if (y && at(frame, x, y) < at(frame, x, y - 1)) fail("gradient", "falls downwards", x, y) ;
+        }
+    }
+}
+
+static void checkChecker(void) {
+    for (int y = 0; y < SRC_HEIGHT; y++) {
+        for (int x = 0; x < SRC_WIDTH; x++) {
+            int white = ((x / 40 + y / 40) & 1) ;
+            if (colorAt(frame, x, y) != (white ? pipeline::PIX_WHITE : pipeline::PIX_BLACK)) fail("checker", "wrong square", x, y) ;
+        }
+    }
+}
+
+// Disc and square of one shapes frame: pixel counts and positions
+struct shapes {
+    int disc, square ;          // pixels
+    long disc_x ;               // sum of x over the disc
+    int square_top ;
+} ;
+
+static shapes findShapes(const uint8_t *f) {
+    shapes s = { 0, 0, 0, -1 } ;
+    for (int y = 0; y < SRC_HEIGHT; y++) {
+        for (int x = 0; x < SRC_WIDTH; x++) {
+            switch (colorAt(f, x, y)) {
+                case pipeline::PIX_BLACK:
+                    s.disc++ ;
+                    s.disc_x += x ;
+                    break ;
+                case 3:                 // yellow
+                    if (s.square_top < 0) s.square_top = y ;
+                    s.square++ ;
+                    break ;
+                case pipeline::PIX_WHITE: break ;
+                default: fail("shapes", "color not white, black or yellow", x, y) ;
+            }
+        }
+    }
+    return s ;
+}
+
+static void checkShapes(void) {
+    frame_source s ;
+    srcSynthetic(&s, SRC_SHAPES) ;
+    shapes last = { 0, 0, 0, 0 } ;
+    for (int f = 0; f < 20; f++) {
+        readFrame(&s, frame, 4096) ;
+        shapes now = findShapes(frame) ;
+        if (now.square != 80 * 80) fail("shapes", "square not 80x80", now.square, f) ;
+        if (now.disc < 11000 || now.disc > 11400) fail("shapes", "disc not whole", now.disc, f) ;
+        if (f) {
+            if (now.disc != last.disc) fail("shapes", "disc changed size", now.disc, f) ;
+            // the centroid moves 4 pixels right
+            if (now.disc_x - last.disc_x != 4L * now.disc) fail("shapes", "disc did not move 4 right", (int)(now.disc_x / now.disc), f) ;
+            if (now.square_top - last.square_top != 3) fail("shapes", "square did not move 3 down", now.square_top, f) ;
+        }
+        last = now ;
+    }
+}
+
+static void checkReplay(void) {
+    const int n = 3 ;
+    uint8_t *frames = (uint8_t *)malloc((size_t)n * SRC_FRAME_BYTES) ;
+    for (int f = 0; f < n; f++) {
+        for (int i = 0; i < SRC_FRAME_BYTES; i++) frames[(size_t)f * SRC_FRAME_BYTES + i] = (uint8_t)(i * (f + 3) + f) ;
+    }
+    frame_source s ;
+    srcReplay(&s, frames, SRC_FRAME_BYTES, n) ;
+    for (int f = 0; f < 2 * n + 1; f++) {
+        readFrame(&s, frame, 777) ;
+        if (memcmp(frame, &frames[(size_t)(f % n) * SRC_FRAME_BYTES], SRC_FRAME_BYTES)) fail("replay", "wrong frame", f, 0) ;
+    }
+    srcReplay(&s, frames, SRC_FRAME_BYTES, 0) ;
+    s.start(&s) ;
+    if (s.length(&s) != 0) fail("replay", "empty list has frames", 0, 0) ;
+    free(frames) ;
+}
+
+int main(void) {
+    pipeline::initTables() ;
+    for (int p = 0; p < SRC_PATTERNS; p++) {
+        checkPieces(p) ;
+        switch (p) {
+            case SRC_BARS: checkBars() ; break ;
+            case SRC_GRADIENT: checkGradient() ; break ;
+            case SRC_CHECKER: checkChecker() ; break ;
+            default: break ;
+        }
+    }
+    checkShapes() ;
+    checkReplay() ;
+    printf("%d patterns and replay ok\n", SRC_PATTERNS) ;
+    return 0 ;
+}
@@ -0,0 +1,196 @@
+/**
+ * streamcheck: round trips through the frame streaming codec
+ *
+ *   streamcheck [-s seed]
+ *
+ * - PackBits: rows of runs, noise and both mixed, with runs and literals
+ *   at the 128 byte limits, decode back to themselves; the coded length
+ *   stays within n + n/3 + 1 (the worst case is a one byte literal
+ *   before every run of two), a cap one byte short of it is refused, and
+ *   malformed input is rejected.
+ * - packets: frames of a changing synthetic scene go through fs_encoder
+ *   into a byte stream with text between the packets (as printed on a
+ *   shared port), some packets refused by a full sink, and a few bytes
+ *   corrupted. fsParserFeed and the decoding camstream does must rebuild
+ *   every frame the sink took whole, and catch up after the refused and
+ *   corrupt ones by the next keyframe.
+ *
+ * Exits 1 on the first failure.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "frame_stream.h"
+
+#define FRAMES 60
+#define KEYFRAME_INTERVAL 8
+#define STREAM_BYTES (4 << 20)
+
+static uint8_t src[FS_HEIGHT][FS_ROW_BYTES] ;
+static uint8_t image[FS_HEIGHT][FS_ROW_BYTES] ;
+static uint8_t stream[STREAM_BYTES] ;
+static int stream_len ;
+static int refuse_every ;       // sink refuses every nth packet, 0 = none
+static int packets ;
+
+static void fail(const char *what, int a, int b) {
+    printf("%s (%d, %d)\n", what, a, b) ;
+    exit(1) ;
+}
+
+// ==================================================
+// === PackBits
+// ==================================================
+
+static void fillRow(uint8_t *row, int n, int kind) {
+    int i = 0 ;
+    while (i < n) {
+        int len = 1 + rand() % 300 ;
+        if (kind == 3) len = (rand() & 1) ? 127 + rand() % 4 : 1 + rand() % 3 ;
+        int run = kind == 0 || (kind != 1 && rand() % 2) ;
+        uint8_t v = rand() ;
+        for (int k = 0; k < len && i < n; k++, i++) row[i] = run ? v : (uint8_t)rand() ;
+    }
+}
+
+static void checkRle(void) {
+    uint8_t row[4 * FS_ROW_BYTES], coded[5 * FS_ROW_BYTES], back[4 * FS_ROW_BYTES] ;
+    for (int t = 0; t < 20000; t++) {
+        int n = t < 4 ? t : 1 + rand() % (int)sizeof(row) ;
+        int kind = t % 4 ;      // runs, noise, mixed, at the limits
+        fillRow(row, n, kind) ;
+        int len = fsRleEncode(row, n, coded, sizeof(coded)) ;
+        if (len < 0 || len > n + n / 3 + 1) fail("coded length out of bounds", n, len) ;
+        if (fsRleDecode(coded, len, back, sizeof(back)) != n || memcmp(row, back, n)) fail("round trip differs", t, n) ;
+        if (len > 0 && fsRleEncode(row, n, coded, len - 1) != -1) fail("cap not kept", n, len) ;
+        if (len > 0 && fsRleDecode(coded, len, back, n - 1) != -1) fail("decode cap not kept", n, len) ;
+    }
+    static const uint8_t unused_code[] = { 0x80, 0x00 } ;
+    static const uint8_t short_literal[] = { 0x03, 0x01, 0x02 } ;
+    static const uint8_t missing_value[] = { 0x00, 0x11, 0xfe } ;
+    uint8_t out[16] ;
+    if (fsRleDecode(unused_code, 2, out, sizeof(out)) != -1) fail("control byte 128 accepted", 0, 0) ;
+    if (fsRleDecode(short_literal, 3, out, sizeof(out)) != -1) fail("short literal accepted", 0, 0) ;
+    if (fsRleDecode(missing_value, 3, out, sizeof(out)) != -1) fail("run without value accepted", 0, 0) ;
+}
+
+// ==================================================
+// === Packets
+// ==================================================
+
+static int sink(const uint8_t *buf, int len) {
+    packets++ ;
+    if (refuse_every && packets % refuse_every == 0) return 0 ;
+    if (stream_len + len + 64 > STREAM_BYTES) fail("stream buffer full", stream_len, len) ;
+    memcpy(&stream[stream_len], buf, len) ;
+    stream_len += len ;
+    // text printed between packets
+    if (rand() % 8 == 0) stream_len += sprintf((char *)&stream[stream_len], "frame %d edges %d\n\r", packets, rand() % 5000) ;
+    return 1 ;
+}
+
+// Still stripes, a band of moving bars and a noisy patch moving down:
+// some rows change each frame, most don't
+static void drawScene(int f) {
+    for (int y = 0; y < FS_HEIGHT; y++) {
+        for (int x = 0; x < FS_ROW_BYTES; x++) {
+            uint8_t c = (y / 60) & 7 ;
+            if (y >= 200 && y < 300) c = ((x + f * 3) / 20) & 7 ;
+            src[y][x] = c | (c << 3) ;
+        }
+    }
+    int py = (f * 37) % (FS_HEIGHT - 40) ;
+    for (int y = py; y < py + 40; y++) {
+        for (int x = 100; x < 160; x++) src[y][x] = rand() & 0x3f ;
+    }
+}
+
+// Decodes the stream as camstream does. Returns the number of frames
+// ended, comparing each with the scene if check is set.
+static int decode(int from, int to, int check, int *bad) {
+    fs_parser p ;
+    int ended = 0 ;
+    fsParserReset(&p) ;
+    for (int i = from; i < to; i++) {
+        int result = fsParserFeed(&p, stream[i]) ;
+        if (result == FS_PARSE_ERROR) (*bad)++ ;
+        if (result != FS_PARSE_PACKET) continue ;
+        switch (p.type) {
+            case FS_PKT_ROW_RAW:
+                if (p.row >= FS_HEIGHT || p.len != FS_ROW_BYTES) fail("bad raw row", p.row, p.len) ;
+                memcpy(image[p.row], p.payload, FS_ROW_BYTES) ;
+                break ;
+            case FS_PKT_ROW_RLE:
+                if (p.row >= FS_HEIGHT || fsRleDecode(p.payload, p.len, image[p.row], FS_ROW_BYTES) != FS_ROW_BYTES) {
+                    fail("bad coded row", p.row, p.len) ;
+                }
+                break ;
+            case FS_PKT_END:
+                ended++ ;
+                if (check && memcmp(image, src, sizeof(image))) fail("frame rebuilt wrong", p.frame, 0) ;
+                break ;
+        }
+    }
+    return ended ;
+}
+
+// Streams FRAMES frames, decoding each as it is sent
+static void checkStream(int refuse, int corrupt) {
+    fs_encoder *e = (fs_encoder *)malloc(sizeof(fs_encoder)) ;
+    fsEncoderInit(e, sink, KEYFRAME_INTERVAL) ;
+    memset(image, 0, sizeof(image)) ;
+    stream_len = 0 ;
+    packets = 0 ;
+    int bad = 0, lost = 0, behind = 0, rows = 0 ;
+    for (int f = 0; f < FRAMES; f++) {
+        drawScene(f) ;
+        int start = stream_len ;
+        // every few frames the sink fills up part way through
+        refuse_every = (f % 6 == 4) ? refuse : 0 ;
+        uint32_t deferred = e->rows_deferred, dropped = e->frames_dropped ;
+        if (fsBeginFrame(e)) {
+            for (int y = 0; y < FS_HEIGHT; y++) rows += fsStreamRow(e, y, src[y]) == 1 ;
+            fsEndFrame(e) ;
+        }
+        int whole = e->rows_deferred == deferred && e->frames_dropped == dropped ;
+        // refused rows go out in the next whole frame, a packet lost on
+        // the way is only replaced by the next keyframe
+        if (whole) behind = 0 ;
+        else behind = 1 ;
+        if (whole && e->frame % KEYFRAME_INTERVAL == 1) lost = 0 ;
+        if (corrupt && f % 5 == 3 && stream_len > start) {
+            stream[start + rand() % (stream_len - start)] ^= 1 << (rand() % 8) ;
+            lost = 1 ;
+        }
+        int ended = decode(start, stream_len, !lost && !behind, &bad) ;
+        if (whole && !corrupt && ended != 1) fail("frame end lost", f, ended) ;
+    }
+    if (corrupt && !bad) fail("corruption not seen", 0, 0) ;
+    if (!corrupt && bad) fail("packets failed their crc", bad, 0) ;
+    if (rows >= FRAMES * FS_HEIGHT / 2) fail("unchanged rows sent again", rows, 0) ;
+    if (refuse && !e->rows_deferred) fail("no rows deferred", refuse, 0) ;
+    free(e) ;
+}
+
+int main(int argc, char **argv) {
+    unsigned int seed = 1 ;
+    int opt ;
+    while ((opt = getopt(argc, argv, "s:")) != -1) {
+        switch (opt) {
+            case 's': seed = strtoul(optarg, NULL, 0) ; break ;
+            default:
+                fprintf(stderr, "usage: %s [-s seed]\n", argv[0]) ;
+                return 2 ;
+        }
+    }
+    srand(seed) ;
+    checkRle() ;
+    checkStream(0, 0) ;
+    checkStream(37, 0) ;
+    checkStream(0, 1) ;
+    checkStream(53, 1) ;
+    printf("PackBits and %d frame streams ok\n", 4) ;
+    return 0 ;
+}
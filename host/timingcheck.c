@@ -0,0 +1,149 @@
+/**
+ * timingcheck: the frame timing ring and its summaries
+ *
+ *   timingcheck [-s seed]
+ *
+ * Stamps frames through frame_timing.c the way the camera thread does,
+ * drain, convert and redraw taking turns row by row, with random phase
+ * lengths and gaps between frames, on a clock that passes the 32 bit
+ * microsecond timer's wrap. Keeps its own list of every frame and, after
+ * each one, checks:
+ *
+ *  - each phase is the sum of its stamps, and the phases add up to the
+ *    total
+ *  - the period is the time from the last frame's start, none for the
+ *    first frame
+ *  - ftCount, and min, avg and p99 (nearest rank) of every phase, the
+ *    total and the period over the last FT_FRAMES frames, worked out
+ *    from a sorted copy; before, at and after the ring wraps
+ *
+ * Exits 1 on the first failure.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "frame_timing.h"
+
+#define FRAMES (3 * FT_FRAMES + 5)
+#define ROWS 48
+
+static frame_timing timing ;
+static ft_record want[FRAMES] ;
+
+static int fail(int frame, const char *what, int p, uint32_t got, uint32_t should) {
+    printf("frame %d %s %s: %u, should be %u\n", frame, ft_phase_names[p], what, got, should) ;
+    return -1 ;
+}
+
+static uint32_t value(const ft_record *r, int p) {
+    if (p == FT_TOTAL) return r->total ;
+    if (p == FT_PERIOD) return r->period ;
+    return r->phase[p] ;
+}
+
+static int compare(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b ;
+    return x < y ? -1 : x > y ;
+}
+
+// Summaries over the frames the ring holds after want[last]
+static int checkSummaries(int last) {
+    int n = last + 1 < FT_FRAMES ? last + 1 : FT_FRAMES ;
+    if (ftCount(&timing) != n) return fail(last, "count", FT_TOTAL, ftCount(&timing), n) ;
+    for (int p = 0; p < FT_PHASES + 2; p++) {
+        uint32_t v[FT_FRAMES] ;
+        uint64_t sum = 0 ;
+        int m = 0 ;
+        for (int f = last + 1 - n; f <= last; f++) {
+            if (p == FT_PERIOD && f == 0) continue ;
+            v[m] = value(&want[f], p) ;
+            sum += v[m++] ;
+        }
+        ft_summary s ;
+        if (ftSummarize(&timing, p, &s) != (m > 0)) return fail(last, "summary present", p, !m, !!m) ;
+        if (!m) continue ;
+        qsort(v, m, sizeof(v[0]), compare) ;
+        int rank = (99 * m + 99) / 100 ;        // smallest with at least 99% at or below
+        if (s.min != v[0]) return fail(last, "min", p, s.min, v[0]) ;
+        if (s.avg != (uint32_t)(sum / m)) return fail(last, "avg", p, s.avg, (uint32_t)(sum / m)) ;
+        if (s.p99 != v[rank - 1]) return fail(last, "p99", p, s.p99, v[rank - 1]) ;
+    }
+    return 0 ;
+}
+
+int main(int argc, char **argv) {
+    unsigned int seed = 1 ;
+    int opt ;
+    while ((opt = getopt(argc, argv, "s:")) != -1) {
+        switch (opt) {
+            case 's': seed = strtoul(optarg, NULL, 0) ; break ;
+            default:
+                fprintf(stderr, "usage: %s [-s seed]\n", argv[0]) ;
+                return 2 ;
+        }
+    }
+    srand(seed) ;
+    ftInit(&timing) ;
+    // frames take about 20 ms here, so the timer wraps a third of the way in
+    uint32_t now = 0u - FT_FRAMES * 20000u, start = 0 ;
+    int wrapped = 0 ;
+    for (int f = 0; f < FRAMES; f++) {
+        ft_record *w = &want[f] ;
+        memset(w, 0, sizeof(*w)) ;
+        uint32_t begin = now ;
+        ftBeginFrame(&timing, now) ;
+        w->period = f ? now - start : 0 ;
+        start = now ;
+
+        static const int order[] = { FT_CAPTURE, FT_LENGTH } ;
+        for (int i = 0; i < 2; i++) {
+            uint32_t d = rand() % 5000 ;
+            now += d ;
+            w->phase[order[i]] += d ;
+            ftMark(&timing, order[i], now) ;
+        }
+        for (int r = 0; r < ROWS; r++) {
+            static const int row_phases[] = { FT_DRAIN, FT_CONVERT, FT_EDGES, FT_REDRAW } ;
+            for (int i = 0; i < 4; i++) {
+                // some phases take no time on some rows
+                uint32_t d = rand() % 3 ? rand() % 300 : 0 ;
+                now += d ;
+                w->phase[row_phases[i]] += d ;
+                ftMark(&timing, row_phases[i], now) ;
+            }
+        }
+        for (int p = FT_CLEAR; p <= FT_OTHER; p++) {
+            uint32_t d = rand() % 2000 ;
+            now += d ;
+            w->phase[p] += d ;
+            ftMark(&timing, p, now) ;
+        }
+        w->total = now - begin ;
+        w->edges = rand() % 10000 ;
+        ftEndFrame(&timing, now, w->edges) ;
+        if (now < begin) wrapped = 1 ;
+
+        const ft_record *got = &timing.ring[f % FT_FRAMES] ;
+        uint32_t phases = 0 ;
+        for (int p = 0; p < FT_PHASES; p++) {
+            if (got->phase[p] != w->phase[p]) return fail(f, "time", p, got->phase[p], w->phase[p]) ;
+            phases += got->phase[p] ;
+        }
+        if (phases != got->total) return fail(f, "sum of the phases", FT_TOTAL, phases, got->total) ;
+        if (got->total != w->total) return fail(f, "time", FT_TOTAL, got->total, w->total) ;
+        if (got->period != w->period) return fail(f, "time", FT_PERIOD, got->period, w->period) ;
+        if (got->edges != w->edges) return fail(f, "edges", FT_TOTAL, got->edges, w->edges) ;
+        if (checkSummaries(f) < 0) return 1 ;
+
+        // a gap before the next frame, counted in its period only
+        now += rand() % 10000 ;
+    }
+    if (!wrapped) {
+        printf("the clock never wrapped\n") ;
+        return 1 ;
+    }
+    printf("%d frames in a ring of %d, summaries match\n", FRAMES, FT_FRAMES) ;
+    return 0 ;
+}
@@ -0,0 +1,245 @@
+/**
+ * trace2json: turn the camera's event trace dump into a Chrome trace
+ *
+ *   trace2json [dump.txt] > trace.json
+ *
+ * The dump is what 'T' in the serial menu prints (format in trace.h),
+ * captured from the terminal; other lines around it are skipped. The
+ * JSON opens in chrome://tracing or ui.perfetto.dev with a process per
+ * core and a track per protothread, each scheduler call of a thread a
+ * slice with the camera's captures nested in it, and the interrupt
+ * events (scanout, command frames) on a track of their own. The rest
+ * are instant events carrying their argument.
+ *
+ * Times are the RP2040's 32 bit microsecond timer, unwrapped against the
+ * first event and shifted so the trace starts at 0. Slices cut off by
+ * the ends of the rings are dropped or closed at the last event.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+
+#define IRQ_TID 100             // track of the interrupt rings
+#define OTHER_TID 101           // thread code events outside any thread call
+#define MAX_THREADS 16
+
+typedef struct {
+    trace_event *events ;
+    int n, held ;
+    unsigned long lost ;
+    int seen ;
+} ring_dump ;
+
+static ring_dump rings[TRACE_RINGS] ;
+static char thread_names[TRACE_CORES][MAX_THREADS][32] ;
+static int first_out = 1 ;
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [dump.txt]\n", prog) ;
+    exit(2) ;
+}
+
+static void addEvents(ring_dump *r, const trace_event *e, int n) {
+    if (n <= 0) return ;
+    trace_event *grown = (trace_event *)realloc(r->events, (r->n + n) * sizeof(*grown)) ;
+    if (!grown) {
+        fprintf(stderr, "out of memory\n") ;
+        exit(1) ;
+    }
+    r->events = grown ;
+    memcpy(&r->events[r->n], e, n * sizeof(*e)) ;
+    r->n += n ;
+}
+
+// Reads the dump. Returns 1 if a complete one ("trace end") was found.
+static int readDump(FILE *f) {
+    char line[512] ;
+    int ring = -1 ;
+    while (fgets(line, sizeof(line), f)) {
+        // the dump may follow the menu prompt on the same line
+        char *p = strstr(line, "trace ") ;
+        int a, b ;
+        unsigned long held, lost ;
+        char name[32] ;
+        if (p && sscanf(p, "trace ring %d %lu %lu", &a, &held, &lost) == 3) {
+            if (a < 0 || a >= TRACE_RINGS) {
+                ring = -1 ;
+                continue ;
+            }
+            ring = a ;
+            // a later dump replaces an earlier one
+            rings[ring].n = 0 ;
+            rings[ring].held = held ;
+            rings[ring].lost = lost ;
+            rings[ring].seen = 1 ;
+        }
+        else if (p && sscanf(p, "trace thread %d %d %31s", &a, &b, name) == 3) {
+            if (a >= 0 && a < TRACE_CORES && b >= 0 && b < MAX_THREADS) strcpy(thread_names[a][b], name) ;
+            ring = -1 ;
+        }
+        else if (p && strncmp(p, "trace end", 9) == 0) {
+            return 1 ;
+        }
+        else if (ring >= 0) {
+            trace_event e[TRACE_PER_LINE] ;
+            int n = traceParseEvents(line, ring / 2, e, TRACE_PER_LINE) ;
+            if (n == 0) ring = -1 ;
+            else addEvents(&rings[ring], e, n) ;
+        }
+    }
+    return 0 ;
+}
+
+static void beginEvent(void) {
+    printf(first_out ? "\n  " : ",\n  ") ;
+    first_out = 0 ;
+}
+
+static void slice(const char *ph, const char *name, int pid, int tid, long long ts) {
+    beginEvent() ;
+    printf("{\"name\":\"%s\",\"ph\":\"%s\",\"pid\":%d,\"tid\":%d,\"ts\":%lld}", name, ph, pid, tid, ts) ;
+}
+
+static void instant(const trace_event *e, int tid, long long ts) {
+    beginEvent() ;
+    printf("{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%d,\"tid\":%d,\"ts\":%lld,\"args\":{",
+           trace_event_names[e->id], e->core, tid, ts) ;
+    switch (e->id) {
+        case TR_COMMAND: printf("\"opcode\":%d,\"value\":%d", e->arg >> 8, e->arg & 0xff) ; break ;
+        case TR_MENU:
+            if (e->arg > ' ' && e->arg < 127 && e->arg != '"' && e->arg != '\\') printf("\"key\":\"%c\"", e->arg) ;
+            else printf("\"key\":%d", e->arg) ;
+            break ;
+        case TR_FRAME_END: printf("\"edges\":%d", e->arg) ; break ;
+        case TR_SCANOUT: printf("\"scanout\":%d", e->arg) ; break ;
+        case TR_BLIT: printf("\"words\":%d", e->arg) ; break ;
+        case TR_CMD_FRAME: printf("\"seq\":%d", e->arg) ; break ;
+        default: printf("\"arg\":%d", e->arg) ; break ;
+    }
+    printf("}}") ;
+}
+
+static const char *threadName(int core, int num, char *buf) {
+    if (num < MAX_THREADS && thread_names[core][num][0]) return thread_names[core][num] ;
+    sprintf(buf, "thread %d", num) ;
+    return buf ;
+}
+
+// A thread ring as slices: scheduler calls, captures nested in them
+static void threadRing(const ring_dump *r, int core, uint32_t ref, long long shift) {
+    int running = -1, capturing = 0 ;
+    long long ts = 0 ;
+    char buf[32] ;
+    for (int i = 0; i < r->n; i++) {
+        const trace_event *e = &r->events[i] ;
+        ts = (long long)(int32_t)(e->time - ref) - shift ;
+        switch (e->id) {
+            case TR_THREAD_CALL:
+                if (running >= 0) {
+                    if (capturing) slice("E", "capture", core, running, ts) ;
+                    slice("E", threadName(core, running, buf), core, running, ts) ;
+                }
+                running = e->arg ;
+                capturing = 0 ;
+                slice("B", threadName(core, running, buf), core, running, ts) ;
+                break ;
+            case TR_THREAD_RETURN:
+                // a return whose call was overwritten has nothing to close
+                if (running != e->arg) break ;
+                if (capturing) slice("E", "capture", core, running, ts) ;
+                slice("E", threadName(core, running, buf), core, running, ts) ;
+                running = -1 ;
+                capturing = 0 ;
+                break ;
+            case TR_CAPTURE_START:
+                if (running < 0 || capturing) break ;
+                slice("B", "capture", core, running, ts) ;
+                capturing = 1 ;
+                break ;
+            case TR_CAPTURE_DONE:
+                if (!capturing) break ;
+                slice("E", "capture", core, running, ts) ;
+                capturing = 0 ;
+                break ;
+            default:
+                instant(e, running >= 0 ? running : OTHER_TID, ts) ;
+                break ;
+        }
+    }
+    // the thread that made the dump is still running
+    if (running >= 0) {
+        if (capturing) slice("E", "capture", core, running, ts) ;
+        slice("E", threadName(core, running, buf), core, running, ts) ;
+    }
+}
+
+static void metadata(const char *what, int pid, int tid, const char *name) {
+    beginEvent() ;
+    printf("{\"name\":\"%s\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", what, pid, tid, name) ;
+}
+
+int main(int argc, char **argv) {
+    FILE *f = stdin ;
+    if (argc > 2 || (argc == 2 && argv[1][0] == '-' && argv[1][1])) usage(argv[0]) ;
+    if (argc == 2 && strcmp(argv[1], "-")) {
+        f = fopen(argv[1], "r") ;
+        if (!f) {
+            perror(argv[1]) ;
+            return 1 ;
+        }
+    }
+    int complete = readDump(f) ;
+    if (f != stdin) fclose(f) ;
+
+    // unwrap against the first event, then start at 0
+    int have = 0 ;
+    uint32_t ref = 0 ;
+    long long shift = 0 ;
+    for (int r = 0; r < TRACE_RINGS; r++) {
+        for (int i = 0; i < rings[r].n; i++) {
+            if (!have) ref = rings[r].events[i].time ;
+            long long t = (int32_t)(rings[r].events[i].time - ref) ;
+            if (!have || t < shift) shift = t ;
+            have = 1 ;
+        }
+    }
+    if (!have) {
+        fprintf(stderr, "no trace events found%s\n", complete ? "" : " (no \"trace end\" line)") ;
+        return 1 ;
+    }
+    if (!complete) fprintf(stderr, "warning: dump cut off before \"trace end\"\n") ;
+
+    printf("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[") ;
+    char buf[32] ;
+    for (int core = 0; core < TRACE_CORES; core++) {
+        if (!rings[2 * core].n && !rings[2 * core + 1].n) continue ;
+        sprintf(buf, "core %d", core) ;
+        metadata("process_name", core, 0, buf) ;
+        for (int t = 0; t < MAX_THREADS; t++) {
+            if (thread_names[core][t][0]) metadata("thread_name", core, t, thread_names[core][t]) ;
+        }
+        metadata("thread_name", core, IRQ_TID, "interrupts") ;
+        metadata("thread_name", core, OTHER_TID, "scheduler") ;
+    }
+    for (int r = 0; r < TRACE_RINGS; r++) {
+        const ring_dump *d = &rings[r] ;
+        if (r & 1) {
+            for (int i = 0; i < d->n; i++) {
+                instant(&d->events[i], IRQ_TID, (long long)(int32_t)(d->events[i].time - ref) - shift) ;
+            }
+        }
+        else threadRing(d, r / 2, ref, shift) ;
+        if (d->seen) {
+            fprintf(stderr, "ring %d (core %d %s): %d events", r, r / 2, r & 1 ? "interrupts" : "threads", d->n) ;
+            if (d->n != d->held) fprintf(stderr, " of %d", d->held) ;
+            if (d->lost) fprintf(stderr, ", %lu older ones overwritten", d->lost) ;
+            fprintf(stderr, "\n") ;
+        }
+    }
+    printf("\n]}\n") ;
+    for (int r = 0; r < TRACE_RINGS; r++) free(rings[r].events) ;
+    return 0 ;
+}
@@ -0,0 +1,124 @@
+/**
+ * tracecheck: the event trace rings and their dump format
+ *
+ *   tracecheck
+ *
+ * Records events into trace.c's rings the way the firmware does, thread
+ * and interrupt rings on both cores, until every ring has wrapped many
+ * times, on a clock that passes the 32 bit microsecond timer's wrap
+ * among the events the rings still hold. Then dumps each ring as 'T' in
+ * the serial menu does (same buffer size, "\n\r" line ends split at
+ * '\n' as a terminal capture would be) and parses it back as trace2json
+ * does. Checks:
+ *
+ *  - held and lost counts
+ *  - the parsed events are the newest ones recorded, in order, with
+ *    time, id, core and argument intact
+ *  - times unwrapped against the first event, as trace2json does, keep
+ *    rising across the timer wrap
+ *  - nothing is recorded while the trace is disabled, and traceClear
+ *    empties the rings
+ *
+ * Exits 1 on the first failure.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+
+#define PT_BUFFER_SIZE 100      // pt_buffer_size in pt_cornell_rp2040_v1.h
+#define RECORDS 20000           // per ring
+
+static trace_log trace ;
+static trace_event recorded[TRACE_RINGS][RECORDS] ;
+static int n_recorded[TRACE_RINGS] ;
+
+static void fail(const char *what, int ring, int i) {
+    printf("ring %d: %s (event %d)\n", ring, what, i) ;
+    exit(1) ;
+}
+
+static void record(int core, int irq, uint32_t time, uint8_t id, uint16_t arg) {
+    int r = 2 * core + irq ;
+    traceRecord(&trace, core, irq, time, id, arg) ;
+    if (!trace.enabled) return ;
+    trace_event *e = &recorded[r][n_recorded[r]++] ;
+    e->time = time ;
+    e->id = id ;
+    e->core = core ;
+    e->arg = arg ;
+}
+
+// Dump ring r as the firmware does and parse it back. Returns the count.
+static int dumpAndParse(int r, trace_event *out, int max) {
+    static char text[64 * 1024] ;
+    char buf[PT_BUFFER_SIZE] ;
+    int used = 0 ;
+    text[0] = 0 ;
+    for (uint32_t pos = 0; ; pos += TRACE_PER_LINE) {
+        if (!traceFormatEvents(&trace.ring[r], pos, buf, PT_BUFFER_SIZE - 2)) break ;
+        strcat(buf, "\n\r") ;
+        used += snprintf(text + used, sizeof(text) - used, "%s", buf) ;
+    }
+    // lines as a capture splits them: each after the first starts with '\r'
+    int n = 0 ;
+    for (char *line = strtok(text, "\n"); line; line = strtok(NULL, "\n")) {
+        n += traceParseEvents(line, r / 2, &out[n], max - n < TRACE_PER_LINE ? max - n : TRACE_PER_LINE) ;
+    }
+    return n ;
+}
+
+static void checkRing(int r) {
+    static trace_event parsed[TRACE_EVENTS] ;
+    const trace_ring *ring = &trace.ring[r] ;
+    uint32_t held = traceHeld(ring) ;
+    int total = n_recorded[r] ;
+    if (held != (total < (int)ring->size ? (uint32_t)total : ring->size)) fail("wrong held count", r, total) ;
+    if (traceLost(ring) != total - held) fail("wrong lost count", r, total) ;
+    int n = dumpAndParse(r, parsed, TRACE_EVENTS) ;
+    if (n != (int)held) fail("dump does not hold every event", r, n) ;
+    const trace_event *want = &recorded[r][total - held] ;
+    int64_t last = 0 ;
+    for (int i = 0; i < n; i++) {
+        if (parsed[i].time != want[i].time || parsed[i].id != want[i].id ||
+            parsed[i].core != want[i].core || parsed[i].arg != want[i].arg) fail("event changed", r, i) ;
+        int64_t t = (int32_t)(parsed[i].time - parsed[0].time) ;
+        if (i && t <= last) fail("time not rising after unwrapping", r, i) ;
+        last = t ;
+    }
+}
+
+int main(void) {
+    traceInit(&trace) ;
+    // steps average 7 usec, so the timer wraps 100 records before the
+    // end, inside what every ring still holds
+    uint32_t now = 0u - 7u * (RECORDS - 100) ;
+    int wrapped = 0 ;
+    for (int i = 0; i < RECORDS; i++) {
+        for (int core = 0; core < TRACE_CORES; core++) {
+            record(core, 0, now, i & 1 ? TR_THREAD_RETURN : TR_THREAD_CALL, (i / 2) % 3) ;
+            record(core, 1, now + 1, i & 1 ? TR_SCANOUT : TR_CMD_FRAME, (uint16_t)(i * 7919)) ;
+        }
+        uint32_t next = now + 1 + (i % 5) * 3 ;
+        if (next < now) wrapped = 1 ;
+        now = next ;
+    }
+    if (!wrapped) fail("clock never wrapped", 0, 0) ;
+    for (int r = 0; r < TRACE_RINGS; r++) checkRing(r) ;
+
+    // the last few events around the wrap, before any ring has wrapped
+    traceClear(&trace) ;
+    memset(n_recorded, 0, sizeof(n_recorded)) ;
+    now = 0xffffffffu - 20 ;
+    for (int i = 0; i < 40; i++) record(0, 0, now++, TR_MENU, 'a' + i % 26) ;
+    for (int r = 0; r < TRACE_RINGS; r++) checkRing(r) ;
+
+    trace.enabled = 0 ;
+    record(1, 0, now, TR_MENU, 'x') ;
+    if (trace.ring[2].count) fail("recorded while disabled", 2, 0) ;
+    trace.enabled = 1 ;
+
+    printf("%d rings of %d events across the timer wrap ok\n", TRACE_RINGS, RECORDS) ;
+    return 0 ;
+}